@@ -0,0 +1,192 @@
+/*
+ * DbLoadGen – closed-loop load generator for DbServer (Linux).
+ *
+ *   DbLoadGen [connections=1000] [seconds=5] [pipeline=1] [keys=1e5] [port]
+ *
+ * Opens `connections` TCP connections to 127.0.0.1:port (or, without a
+ * port, to a DbServer started in this process), keeps `pipeline` RESP
+ * requests (90 % GET / 10 % SET) in flight on each, and reports the
+ * request rate and latency percentiles measured from send to reply.
+ */
+#include "DbServer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+
+/* ───────────────────────── helpers ───────────────────────── */
+
+static std::size_t argOr(int argc, char** argv, int i, std::size_t dflt) {
+    return argc > i ? static_cast<std::size_t>(std::strtoull(argv[i], nullptr, 10)) : dflt;
+}
+
+/* p in [0,1]; sorts in place */
+static double percentile(std::vector<double>& v, double p) {
+    if (v.empty()) return 0;
+    std::size_t k = static_cast<std::size_t>(p * double(v.size() - 1));
+    std::nth_element(v.begin(), v.begin() + static_cast<std::ptrdiff_t>(k), v.end());
+    return v[k];
+}
+
+static std::string resp(std::initializer_list<std::string_view> args) {
+    std::string s = "*" + std::to_string(args.size()) + "\r\n";
+    for (auto a : args) {
+        s += "$" + std::to_string(a.size()) + "\r\n";
+        s += a;
+        s += "\r\n";
+    }
+    return s;
+}
+
+/* length of the first complete reply in buf, 0 if incomplete */
+static std::size_t replyLength(std::string_view buf) {
+    auto eol = buf.find("\r\n");
+    if (eol == std::string_view::npos) return 0;
+    if (buf[0] != '$') return eol + 2;                  // +OK / :n / -ERR
+    long len = std::strtol(buf.data() + 1, nullptr, 10);
+    if (len < 0) return eol + 2;                        // $-1
+    std::size_t total = eol + 2 + static_cast<std::size_t>(len) + 2;
+    return buf.size() >= total ? total : 0;
+}
+
+struct Client {
+    int                           fd;
+    std::string                   in;
+    std::deque<Clock::time_point> sent;                 // one per outstanding request
+};
+
+/* ───────────────────────── driver ───────────────────────── */
+
+int main(int argc, char** argv) {
+    std::size_t nConns   = argOr(argc, argv, 1, 1000);
+    std::size_t seconds  = argOr(argc, argv, 2, 5);
+    std::size_t pipeline = std::max<std::size_t>(1, argOr(argc, argv, 3, 1));
+    std::size_t nKeys    = argOr(argc, argv, 4, 100'000);
+    auto        port     = static_cast<std::uint16_t>(argOr(argc, argv, 5, 0));
+
+    rlimit lim{};                                       // client + server fds
+    if (::getrlimit(RLIMIT_NOFILE, &lim) == 0 && lim.rlim_cur < lim.rlim_max) {
+        lim.rlim_cur = lim.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &lim);
+    }
+
+    InMemoryDB                db;
+    std::unique_ptr<DbServer> server;
+    std::thread               loop;
+    if (!port) {
+        for (std::size_t k = 0; k < nKeys; ++k) db.set("key:" + std::to_string(k), "value");
+        server = std::make_unique<DbServer>(db);
+        port   = server->port();
+        loop   = std::thread([&] { server->run(); });
+    }
+
+    std::vector<std::string> gets, sets;
+    for (std::size_t k = 0; k < nKeys; ++k) {
+        std::string key = "key:" + std::to_string(k);
+        gets.push_back(resp({ "GET", key }));
+        sets.push_back(resp({ "SET", key, "value" }));
+    }
+
+    int ep = ::epoll_create1(EPOLL_CLOEXEC);
+    std::vector<Client> clients(nConns);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port   = htons(port);
+    ::inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    for (std::size_t i = 0; i < nConns; ++i) {
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) < 0) {
+            std::cerr << "connect #" << i << " failed: " << std::strerror(errno) << '\n';
+            return 1;
+        }
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+        clients[i].fd = fd;
+        epoll_event ev{};
+        ev.events   = EPOLLIN;
+        ev.data.u64 = i;
+        ::epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev);
+    }
+
+    std::mt19937_64 rng(3);
+    std::string     batch;
+    auto fire = [&](Client& c) {                        // refill the pipeline
+        batch.clear();
+        auto now = Clock::now();
+        while (c.sent.size() < pipeline) {
+            std::size_t k = rng() % nKeys;
+            batch += (rng() % 10 == 0) ? sets[k] : gets[k];
+            c.sent.push_back(now);
+        }
+        if (::send(c.fd, batch.data(), batch.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(batch.size()))
+            std::cerr << "short send\n";
+    };
+
+    std::vector<double> latUs;
+    latUs.reserve(1 << 22);
+    std::size_t done = 0;
+    char        buf[1 << 16];
+    epoll_event evs[512];
+
+    for (auto& c : clients) fire(c);
+    const auto t0       = Clock::now();
+    const auto deadline = t0 + std::chrono::seconds(seconds);
+    while (Clock::now() < deadline) {
+        int n = ::epoll_wait(ep, evs, 512, 100);
+        auto now = Clock::now();
+        for (int e = 0; e < n; ++e) {
+            Client& c = clients[evs[e].data.u64];
+            ssize_t r = ::recv(c.fd, buf, sizeof buf, 0);
+            if (r <= 0) { std::cerr << "connection lost\n"; return 1; }
+            c.in.append(buf, static_cast<std::size_t>(r));
+            std::size_t off = 0;
+            while (std::size_t len = replyLength(std::string_view(c.in).substr(off))) {
+                latUs.push_back(std::chrono::duration<double, std::micro>(now - c.sent.front()).count());
+                c.sent.pop_front();
+                off += len;
+                ++done;
+            }
+            c.in.erase(0, off);
+            if (c.sent.empty()) fire(c);
+        }
+    }
+    double secs = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    std::cout << "DbLoadGen: " << nConns << " connections, pipeline " << pipeline << ", "
+              << nKeys << " keys, " << secs << " s\n"
+              << std::fixed << std::setprecision(0)
+              << "  requests/s   " << double(done) / secs << '\n'
+              << std::setprecision(1)
+              << "  p50  (us)    " << percentile(latUs, 0.50)  << '\n'
+              << "  p90  (us)    " << percentile(latUs, 0.90)  << '\n'
+              << "  p99  (us)    " << percentile(latUs, 0.99)  << '\n'
+              << "  p99.9 (us)   " << percentile(latUs, 0.999) << '\n'
+              << "  max  (us)    " << percentile(latUs, 1.0)   << '\n';
+
+    for (auto& c : clients) ::close(c.fd);
+    ::close(ep);
+    if (server) {
+        server->stop();
+        loop.join();
+    }
+    return 0;
+}
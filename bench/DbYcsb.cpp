@@ -0,0 +1,313 @@
+/*
+ * DbYcsb – YCSB-style workload driver for InMemoryDB; prints one JSON object.
+ *
+ *   DbYcsb [--keys N=1e6] [--ops N=1e6] [--dist zipfian|uniform|latest]
+ *          [--theta T=0.99] [--value-size B=100] [--values N=1e4]
+ *          [--read W=95] [--update W=5] [--insert W=0] [--delete W=0] [--count W=0]
+ *          [--txn-depth D=0] [--txn-ops N=10] [--abort P=0]
+ *          [--mode undo|overlay] [--ordered-index] [--value-index]
+ *          [--maxmemory MB=0] [--seed S=1]
+ *
+ * Load phase: --keys SETs of user:0 … user:N-1.  Run phase: --ops
+ * operations, each drawn by the weights (read = GET, update = SET of an
+ * existing key, insert = SET of the next new key, delete = DELETE,
+ * count = COUNT of a pool value).  Values come from a pool of --values
+ * distinct strings of --value-size bytes, so COUNT has something to find.
+ *
+ *  Key choice for read / update / delete:
+ *    uniform : every loaded or inserted key alike
+ *    zipfian : Zipf(theta) over ranks, ranks scattered over the key space
+ *              by a hash (YCSB's scrambled zipfian)
+ *    latest  : Zipf(theta) over recency – the newest inserts are hottest
+ *
+ * With --txn-depth D > 0 the run is split into transactions of --txn-ops
+ * operations; a BEGIN opens a new level every txn-ops / D operations.  At
+ * the end each level, innermost first, is rolled back with probability
+ * --abort until one survives; a COMMIT then commits whatever is left.
+ *
+ * Every operation is timed (two clock reads, ~tens of ns, are included in
+ * the latencies).  Peak RSS is the process high-water mark, so it covers
+ * the load phase and the driver's own key strings too.
+ */
+#include "DbStats.h"
+#include "inMemoryDb.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#  define WIN32_LEAN_AND_MEAN
+#  define NOMINMAX
+#  include <windows.h>
+#  include <psapi.h>
+#else
+#  include <sys/resource.h>
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+/* ───────────────────────── key choosers ───────────────────────── */
+
+/* Zipf(theta) over [0, n), Gray et al. "Quickly generating billion-record
+   synthetic databases" – the generator YCSB uses.  grow() extends n
+   without recomputing zeta from scratch. */
+class Zipfian {
+    double        theta_, alpha_, zeta2_, zetan_ = 0, eta_ = 0;
+    std::uint64_t n_ = 0;
+
+    static double zeta(std::uint64_t from, std::uint64_t to, double theta) {
+        double s = 0;
+        for (std::uint64_t i = from + 1; i <= to; ++i) s += 1.0 / std::pow(double(i), theta);
+        return s;
+    }
+
+public:
+    Zipfian(std::uint64_t n, double theta)
+        : theta_(theta), alpha_(1.0 / (1.0 - theta)), zeta2_(zeta(0, 2, theta)) { grow(n); }
+
+    void grow(std::uint64_t n) {
+        if (n <= n_) return;
+        zetan_ += zeta(n_, n, theta_);
+        n_      = n;
+        eta_    = (1 - std::pow(2.0 / double(n_), 1 - theta_)) / (1 - zeta2_ / zetan_);
+    }
+
+    template <class Rng>
+    std::uint64_t next(Rng& rng) {
+        const double u  = std::uniform_real_distribution<double>(0, 1)(rng);
+        const double uz = u * zetan_;
+        if (uz < 1.0)                            return 0;
+        if (uz < 1.0 + std::pow(0.5, theta_))    return std::min<std::uint64_t>(1, n_ - 1);
+        auto r = static_cast<std::uint64_t>(double(n_) * std::pow(eta_ * u - eta_ + 1, alpha_));
+        return std::min(r, n_ - 1);
+    }
+};
+
+static std::uint64_t fnv64(std::uint64_t v) {
+    std::uint64_t h = 0xcbf29ce484222325ull;
+    for (int i = 0; i < 8; ++i, v >>= 8) h = (h ^ (v & 0xff)) * 0x100000001b3ull;
+    return h;
+}
+
+enum class Dist { Uniform, Zipfian, Latest };
+
+/* ───────────────────────── options ───────────────────────── */
+
+struct Options {
+    std::size_t keys = 1'000'000, ops = 1'000'000;
+    Dist        dist = Dist::Zipfian;
+    double      theta = 0.99;
+    std::size_t valueSize = 100, values = 10'000;
+    std::array<double, 5> weights = { 95, 5, 0, 0, 0 };   // indexed by Op
+    std::size_t txnDepth = 0, txnOps = 10;
+    double      abort = 0;
+    TxnMode     mode = TxnMode::UndoLog;
+    bool        orderedIndex = false, valueIndex = false;
+    std::size_t maxMemoryMb = 0;
+    std::uint64_t seed = 1;
+};
+
+enum Op { Read, Update, Insert, Delete, Count, Begin, Commit, Rollback, kOps };
+static constexpr std::array<const char*, kOps> kOpNames = {
+    "read", "update", "insert", "delete", "count", "begin", "commit", "rollback"
+};
+static constexpr std::array<const char*, 3> kDistNames = { "uniform", "zipfian", "latest" };
+
+static Options parse(int argc, char** argv) {
+    Options o;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::runtime_error("missing value for " + a);
+            return argv[++i];
+        };
+        auto count = [&] { return static_cast<std::size_t>(std::stod(next())); };   // accepts 1e6
+        if      (a == "--keys")          o.keys = count();
+        else if (a == "--ops")           o.ops = count();
+        else if (a == "--theta")         o.theta = std::stod(next());
+        else if (a == "--value-size")    o.valueSize = count();
+        else if (a == "--values")        o.values = std::max<std::size_t>(1, count());
+        else if (a == "--read")          o.weights[Read] = std::stod(next());
+        else if (a == "--update")        o.weights[Update] = std::stod(next());
+        else if (a == "--insert")        o.weights[Insert] = std::stod(next());
+        else if (a == "--delete")        o.weights[Delete] = std::stod(next());
+        else if (a == "--count")         o.weights[Count] = std::stod(next());
+        else if (a == "--txn-depth")     o.txnDepth = count();
+        else if (a == "--txn-ops")       o.txnOps = std::max<std::size_t>(1, count());
+        else if (a == "--abort")         o.abort = std::stod(next());
+        else if (a == "--ordered-index") o.orderedIndex = true;
+        else if (a == "--value-index")   o.valueIndex = true;
+        else if (a == "--maxmemory")     o.maxMemoryMb = count();
+        else if (a == "--seed")          o.seed = std::stoull(next());
+        else if (a == "--dist") {
+            std::string d = next();
+            auto it = std::find(kDistNames.begin(), kDistNames.end(), d);
+            if (it == kDistNames.end()) throw std::runtime_error("unknown distribution " + d);
+            o.dist = static_cast<Dist>(it - kDistNames.begin());
+        } else if (a == "--mode") {
+            std::string m = next();
+            if      (m == "undo")    o.mode = TxnMode::UndoLog;
+            else if (m == "overlay") o.mode = TxnMode::Overlay;
+            else throw std::runtime_error("unknown mode " + m);
+        } else throw std::runtime_error("unknown option " + a);
+    }
+    if (o.keys == 0) throw std::runtime_error("--keys must be positive");
+    if (o.theta <= 0 || o.theta >= 1) throw std::runtime_error("--theta must be in (0, 1)");
+    double sum = 0;
+    for (double w : o.weights) {
+        if (w < 0) throw std::runtime_error("operation weights must not be negative");
+        sum += w;
+    }
+    if (sum <= 0) throw std::runtime_error("all operation weights are zero");
+    if (o.txnDepth > o.txnOps) throw std::runtime_error("--txn-depth exceeds --txn-ops");
+    return o;
+}
+
+static std::size_t peakRssBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc{};
+    return K32GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof pmc) ? pmc.PeakWorkingSetSize : 0;
+#else
+    rusage ru{};
+    if (::getrusage(RUSAGE_SELF, &ru) != 0) return 0;
+#  ifdef __APPLE__
+    return static_cast<std::size_t>(ru.ru_maxrss);            // bytes
+#  else
+    return static_cast<std::size_t>(ru.ru_maxrss) * 1024;     // KiB
+#  endif
+#endif
+}
+
+static std::string keyOf(std::uint64_t i) { return "user:" + std::to_string(i); }
+
+/* ───────────────────────── driver ───────────────────────── */
+
+int main(int argc, char** argv) try {
+    const Options o = parse(argc, argv);
+
+    std::mt19937_64 rng(o.seed);
+    std::vector<std::string> pool(o.values);
+    for (auto& v : pool) {
+        v.resize(o.valueSize);
+        for (auto& c : v) c = static_cast<char>('a' + rng() % 26);
+    }
+    auto value = [&] { return std::string_view(pool[rng() % pool.size()]); };
+
+    InMemoryDB db(o.mode);
+    db.setOrderedIndex(o.orderedIndex);
+    db.setValueIndex(o.valueIndex);
+    db.setMemoryLimit(o.maxMemoryMb << 20);
+
+    auto t0 = Clock::now();
+    for (std::size_t i = 0; i < o.keys; ++i) db.set(keyOf(i), value());
+    const double loadSecs = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    std::uint64_t inserted = o.keys;                  // next new key
+    Zipfian       zipf(o.keys, o.theta);
+    auto pick = [&]() -> std::uint64_t {
+        switch (o.dist) {
+        case Dist::Uniform: return rng() % inserted;
+        case Dist::Zipfian: return fnv64(zipf.next(rng)) % inserted;
+        case Dist::Latest:  return inserted - 1 - zipf.next(rng);
+        }
+        return 0;
+    };
+    std::discrete_distribution<int> mix(o.weights.begin(), o.weights.end());
+    std::bernoulli_distribution     aborts(std::clamp(o.abort, 0.0, 1.0));
+
+    std::array<LatencyHistogram, kOps> lat;
+    std::array<std::uint64_t, kOps>    calls{};
+    std::string key;
+    auto timed = [&](Op op, auto&& f) {
+        auto t = Clock::now();
+        f();
+        lat[op].record(static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t).count()));
+        ++calls[op];
+    };
+
+    std::size_t hits = 0, found = 0, open = 0;
+    const std::size_t levelEvery = o.txnDepth ? o.txnOps / o.txnDepth : 0;
+    auto finishTxn = [&] {
+        while (open && aborts(rng)) { timed(Rollback, [&] { db.rollback(); }); --open; }
+        if (open) { timed(Commit, [&] { db.commit(); }); open = 0; }
+    };
+
+    t0 = Clock::now();
+    for (std::size_t i = 0; i < o.ops; ++i) {
+        if (o.txnDepth) {
+            const std::size_t pos = i % o.txnOps;
+            if (pos == 0 && open) finishTxn();
+            if (pos % levelEvery == 0 && open < o.txnDepth) { timed(Begin, [&] { db.begin(); }); ++open; }
+        }
+        const Op op = static_cast<Op>(mix(rng));
+        if (op == Insert) key = keyOf(inserted);
+        else if (op != Count) key = keyOf(pick());
+        switch (op) {
+        case Read:   timed(op, [&] { hits += db.getView(key).has_value(); }); break;
+        case Update:
+        case Insert: timed(op, [&] { db.set(key, value()); }); break;
+        case Delete: timed(op, [&] { db.del(key); }); break;
+        case Count:  timed(op, [&] { found += db.count(value()); }); break;
+        default:     break;
+        }
+        if (op == Insert) zipf.grow(++inserted);
+    }
+    finishTxn();
+    const double runSecs = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    std::uint64_t total = 0;
+    for (auto c : calls) total += c;
+
+    std::ostringstream js;
+    js << "{\n  \"config\": {"
+       << "\"keys\": " << o.keys << ", \"ops\": " << o.ops
+       << ", \"dist\": \"" << kDistNames[static_cast<int>(o.dist)] << "\", \"theta\": " << o.theta
+       << ", \"value_size\": " << o.valueSize << ", \"values\": " << o.values
+       << ", \"mix\": {";
+    for (int op = Read; op <= Count; ++op)
+        js << (op ? ", " : "") << '"' << kOpNames[op] << "\": " << o.weights[op];
+    js << "}, \"txn_depth\": " << o.txnDepth << ", \"txn_ops\": " << o.txnOps
+       << ", \"abort\": " << o.abort
+       << ", \"mode\": \"" << (o.mode == TxnMode::UndoLog ? "undo" : "overlay") << '"'
+       << ", \"ordered_index\": " << (o.orderedIndex ? "true" : "false")
+       << ", \"value_index\": " << (o.valueIndex ? "true" : "false")
+       << ", \"maxmemory_mb\": " << o.maxMemoryMb << ", \"seed\": " << o.seed << "},\n"
+       << "  \"load\": {\"keys\": " << o.keys << ", \"seconds\": " << loadSecs
+       << ", \"ops_per_sec\": " << double(o.keys) / std::max(loadSecs, 1e-9) << "},\n"
+       << "  \"run\": {\"ops\": " << total << ", \"seconds\": " << runSecs
+       << ", \"ops_per_sec\": " << double(total) / std::max(runSecs, 1e-9)
+       << ", \"read_hits\": " << hits << ", \"count_sum\": " << found << ",\n"
+       << "    \"latency_ns\": {";
+    bool first = true;
+    for (int op = 0; op < kOps; ++op) {
+        if (!calls[op]) continue;
+        const LatencyHistogram& h = lat[op];
+        js << (first ? "\n" : ",\n") << "      \"" << kOpNames[op] << "\": {"
+           << "\"count\": " << calls[op] << ", \"mean\": " << std::llround(h.mean())
+           << ", \"p50\": " << h.percentile(0.50) << ", \"p90\": " << h.percentile(0.90)
+           << ", \"p99\": " << h.percentile(0.99) << ", \"p999\": " << h.percentile(0.999)
+           << ", \"max\": " << h.max() << '}';
+        first = false;
+    }
+    js << (first ? "}},\n" : "\n    }},\n")
+       << "  \"db_keys\": " << db.stats().keys
+       << ", \"db_memory_bytes\": " << db.memoryUsage()
+       << ", \"peak_rss_bytes\": " << peakRssBytes() << "\n}\n";
+    std::cout << js.str();
+    return 0;
+} catch (const std::exception& e) {
+    std::cerr << "DbYcsb: " << e.what() << '\n';
+    return 1;
+}
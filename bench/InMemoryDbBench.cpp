@@ -0,0 +1,1038 @@
+/*
+ * InMemoryDbBench – micro-benchmarks for the in-memory KV-store exercise.
+ *
+ *   InMemoryDbBench <benchmark> [args…]
+ *
+ * Every benchmark prints a small table to stdout.  Sizes default to values
+ * that finish in seconds; pass larger counts for the “real” numbers
+ * (e.g. `InMemoryDbBench map-get 10000000`).
+ */
+#include "FlatHashMap.h"
+#include "IncrementalHashMap.h"
+#include "inMemoryDb.h"
+#include "ShardedInMemoryDB.h"
+#include "WriteAheadLog.h"
+#include "ChangeStream.h"
+#include "Checkpoint.h"
+#include "BackgroundSnapshot.h"
+#include "CommandProcessor.h"
+#include "AllocCounter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __linux__
+#  include <linux/perf_event.h>
+#  include <sys/ioctl.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+/* ───────────────────────── helpers ───────────────────────── */
+
+static double nsSince(Clock::time_point t0) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+}
+
+/* p in [0,1]; sorts in place */
+static double percentile(std::vector<double>& v, double p) {
+    if (v.empty()) return 0;
+    std::size_t k = static_cast<std::size_t>(p * double(v.size() - 1));
+    std::nth_element(v.begin(), v.begin() + static_cast<std::ptrdiff_t>(k), v.end());
+    return v[k];
+}
+
+static std::size_t argOr(int argc, char** argv, int i, std::size_t dflt) {
+    return argc > i ? static_cast<std::size_t>(std::strtoull(argv[i], nullptr, 10)) : dflt;
+}
+
+/* Hardware cache-miss counter (Linux perf_event); reads -1 when the
+   kernel or container does not expose PMU events. */
+class CacheMissCounter {
+#ifdef __linux__
+    int fd_ = -1;
+public:
+    CacheMissCounter() {
+        perf_event_attr pe{};
+        pe.type           = PERF_TYPE_HARDWARE;
+        pe.size           = sizeof(pe);
+        pe.config         = PERF_COUNT_HW_CACHE_MISSES;
+        pe.disabled       = 1;
+        pe.exclude_kernel = 1;
+        pe.exclude_hv     = 1;
+        fd_ = static_cast<int>(syscall(__NR_perf_event_open, &pe, 0, -1, -1, 0));
+    }
+    ~CacheMissCounter() { if (fd_ >= 0) close(fd_); }
+    void start() {
+        if (fd_ < 0) return;
+        ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    long long stop() {
+        if (fd_ < 0) return -1;
+        ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+        long long n = 0;
+        return read(fd_, &n, sizeof(n)) == sizeof(n) ? n : -1;
+    }
+#else
+public:
+    void      start() {}
+    long long stop()  { return -1; }
+#endif
+};
+
+/* heap allocations of the calling thread (see AllocCounter.h);
+   thread-local, so the multi-threaded benchmarks share no counter line */
+static thread_local std::size_t t_allocs = 0;
+
+void onHeapAllocation() noexcept { ++t_allocs; }
+
+/* results of timed loops land here so the optimiser cannot drop them */
+static std::atomic<std::size_t> g_sink{0};
+
+static std::vector<std::string> makeKeys(std::size_t n) {
+    std::vector<std::string> keys;
+    keys.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) keys.push_back("user:" + std::to_string(i) + ":profile");
+    return keys;
+}
+
+/* ───────────────────── map-get: flat vs node ───────────────────── */
+
+template <class Map>
+static void benchMapGet(const char* name,
+                        const std::vector<std::string>& keys,
+                        const std::vector<std::uint32_t>& order) {
+    Map m;
+    auto t0 = Clock::now();
+    for (std::size_t i = 0; i < keys.size(); ++i) m[keys[i]] = "v" + std::to_string(i % 16);
+    double buildMs = nsSince(t0) / 1e6;
+
+    std::vector<double> lat;
+    lat.reserve(order.size());
+    std::size_t hits = 0;
+
+    CacheMissCounter misses;
+    misses.start();
+    for (std::uint32_t k : order) {
+        auto t = Clock::now();
+        auto it = m.find(keys[k]);
+        hits += (it != m.end() && !it->second.empty());
+        lat.push_back(nsSince(t));
+    }
+    long long cm = misses.stop();
+
+    double p50  = percentile(lat, 0.50);
+    double p99  = percentile(lat, 0.99);
+    double p999 = percentile(lat, 0.999);
+
+    std::cout << std::left  << std::setw(20) << name << std::right
+              << std::setw(12) << keys.size()
+              << std::setw(12) << std::fixed << std::setprecision(1) << buildMs
+              << std::setw(10) << p50
+              << std::setw(10) << p99
+              << std::setw(10) << p999;
+    if (cm >= 0) std::cout << std::setw(14) << std::setprecision(3) << double(cm) / double(order.size());
+    else         std::cout << std::setw(14) << "n/a";
+    std::cout << (hits == order.size() ? "" : "  (lookup mismatch!)") << '\n';
+}
+
+static int runMapGet(int argc, char** argv) {
+    std::size_t nKeys    = argOr(argc, argv, 2, 1'000'000);
+    std::size_t nLookups = argOr(argc, argv, 3, 1'000'000);
+
+    auto keys = makeKeys(nKeys);
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<std::uint32_t> pick(0, static_cast<std::uint32_t>(nKeys - 1));
+    std::vector<std::uint32_t> order(nLookups);
+    for (auto& o : order) o = pick(rng);
+
+    std::cout << "map-get: random hits, per-lookup latency (ns)\n"
+              << std::left  << std::setw(20) << "map" << std::right
+              << std::setw(12) << "keys" << std::setw(12) << "build ms"
+              << std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(10) << "p99.9"
+              << std::setw(14) << "misses/get" << '\n';
+    benchMapGet<std::unordered_map<std::string, std::string>>("std::unordered_map", keys, order);
+    benchMapGet<FlatHashMap<std::string, std::string>>("FlatHashMap", keys, order);
+    return 0;
+}
+
+/* ─────────────── txn-log: undo logging vs txn size ─────────────── */
+
+/* BEGIN; SET each of N distinct keys twice (the second write must hit the
+   “already logged” fast path); then ROLLBACK or COMMIT.  ns/write should
+   stay flat as N grows. */
+static int runTxnLog(int argc, char** argv) {
+    std::size_t maxKeys = argOr(argc, argv, 2, 1'000'000);
+
+    std::cout << "txn-log: BEGIN, 2 x SET per distinct key, ROLLBACK\n"
+              << std::setw(10) << "txn keys" << std::setw(14) << "ns/write"
+              << std::setw(16) << "rollback ms" << '\n';
+    for (std::size_t n = 10; n <= maxKeys; n *= 10) {
+        auto keys = makeKeys(n);
+        InMemoryDB db;
+        for (const auto& k : keys) db.set(k, "base");      // pre-existing keys
+
+        std::size_t rounds = std::max<std::size_t>(1, 1'000'000 / n);
+        double writeNs = 0, rollbackNs = 0;
+        for (std::size_t r = 0; r < rounds; ++r) {
+            db.begin();
+            auto t0 = Clock::now();
+            for (const auto& k : keys) db.set(k, "v1");
+            for (const auto& k : keys) db.set(k, "v2");
+            writeNs += nsSince(t0);
+            t0 = Clock::now();
+            db.rollback();
+            rollbackNs += nsSince(t0);
+        }
+        std::cout << std::setw(10) << n
+                  << std::setw(14) << std::fixed << std::setprecision(1)
+                  << writeNs / double(2 * n * rounds)
+                  << std::setw(16) << std::setprecision(3)
+                  << rollbackNs / double(rounds) / 1e6 << '\n';
+    }
+    return 0;
+}
+
+/* ─────────────── txn-churn: short nested transactions ─────────────── */
+
+/* depth × (BEGIN, SET ×8 on random existing keys), then depth × ROLLBACK –
+   the short, aborted transactions of a speculative workload.  Reports ns
+   and heap allocations per BEGIN…ROLLBACK level, for both TxnModes. */
+static int runTxnChurn(int argc, char** argv) {
+    std::size_t rounds = argOr(argc, argv, 2, 1'000'000);
+    std::size_t nKeys  = std::max<std::size_t>(1, argOr(argc, argv, 3, 100'000));
+
+    auto keys = makeKeys(nKeys);
+    std::cout << "txn-churn: BEGIN, SET x8, ROLLBACK per level; " << nKeys << " keys\n"
+              << std::setw(10) << "mode" << std::setw(8) << "depth" << std::setw(14) << "ns/level"
+              << std::setw(16) << "allocs/level" << '\n';
+    for (TxnMode mode : { TxnMode::UndoLog, TxnMode::Overlay })
+        for (std::size_t depth : { 1, 4, 16 }) {
+            InMemoryDB db(mode);
+            for (const auto& k : keys) db.set(k, "base");
+            std::mt19937_64 rng(13);
+            const std::size_t levels = std::max<std::size_t>(1, rounds / depth);
+            const std::size_t allocs0 = t_allocs;
+            auto t0 = Clock::now();
+            for (std::size_t r = 0; r < levels; ++r) {
+                for (std::size_t d = 0; d < depth; ++d) {
+                    db.begin();
+                    for (int i = 0; i < 8; ++i) db.set(keys[rng() % nKeys], (i & 1) ? "odd" : "even");
+                }
+                for (std::size_t d = 0; d < depth; ++d) db.rollback();
+            }
+            const double n = double(levels * depth);
+            std::cout << std::setw(10) << (mode == TxnMode::UndoLog ? "undo-log" : "overlay")
+                      << std::setw(8) << depth << std::fixed << std::setprecision(1)
+                      << std::setw(14) << nsSince(t0) / n
+                      << std::setw(16) << std::setprecision(2) << double(t_allocs - allocs0) / n << '\n';
+        }
+    return 0;
+}
+
+/* ORM-style units of work inside one outer transaction: each unit is
+   BEGIN, SET x8, RELEASE.  "flat" writes the same SETs straight into the
+   outer level; the gap is what a RELEASE costs.  The outer level first
+   logs `preload` keys – the merge must not get slower with its size. */
+static int runRelease(int argc, char** argv) {
+    std::size_t units = argOr(argc, argv, 2, 100'000);
+    std::size_t nKeys = std::max<std::size_t>(1, argOr(argc, argv, 3, 100'000));
+
+    auto keys = makeKeys(nKeys);
+    std::cout << "release: " << units << " units of 8 SETs in one outer txn; " << nKeys << " keys\n"
+              << std::setw(10) << "mode" << std::setw(10) << "preload" << std::setw(8) << "units"
+              << std::setw(12) << "ns/unit" << std::setw(14) << "undo KiB" << '\n';
+    for (TxnMode mode : { TxnMode::UndoLog, TxnMode::Overlay })
+        for (std::size_t preload : { std::size_t(0), nKeys })
+            for (bool nested : { false, true }) {
+                InMemoryDB db(mode);
+                for (const auto& k : keys) db.set(k, "base");
+                db.begin();
+                for (std::size_t i = 0; i < preload; ++i) db.set(keys[i], "outer");
+                std::mt19937_64 rng(17);
+                auto t0 = Clock::now();
+                for (std::size_t u = 0; u < units; ++u) {
+                    if (nested) db.begin();
+                    for (int i = 0; i < 8; ++i) db.set(keys[rng() % nKeys], (i & 1) ? "odd" : "even");
+                    if (nested) db.release();
+                }
+                const double ns = nsSince(t0) / double(units);
+                std::cout << std::setw(10) << (mode == TxnMode::UndoLog ? "undo-log" : "overlay")
+                          << std::setw(10) << preload << std::setw(8) << (nested ? "nested" : "flat")
+                          << std::fixed << std::setprecision(1) << std::setw(12) << ns
+                          << std::setw(14) << double(db.stats().undoBytes) / 1024 << '\n';
+                db.rollback();
+            }
+    return 0;
+}
+
+/* ─────────────── sharded: multi-threaded throughput ─────────────── */
+
+/* Each thread runs a 90 % GET / 10 % SET mix over a preloaded key space
+   for a fixed number of ops; reports aggregate Mops/s per thread count. */
+static double shardedRun(ShardedInMemoryDB& db, const std::vector<std::string>& keys,
+                         unsigned threads, std::size_t opsPerThread) {
+    std::vector<std::thread> pool;
+    auto t0 = Clock::now();
+    for (unsigned t = 0; t < threads; ++t) {
+        pool.emplace_back([&, t] {
+            std::mt19937_64 rng(t + 1);
+            std::size_t sink = 0;
+            for (std::size_t i = 0; i < opsPerThread; ++i) {
+                const auto& k = keys[rng() % keys.size()];
+                if (i % 10 == 0) db.set(k, (i & 16) ? "a" : "b");
+                else             sink += db.get(k).has_value();
+            }
+            g_sink.fetch_add(sink, std::memory_order_relaxed);
+        });
+    }
+    for (auto& th : pool) th.join();
+    return double(threads) * double(opsPerThread) / (nsSince(t0) / 1e9) / 1e6;
+}
+
+static int runSharded(int argc, char** argv) {
+    std::size_t nKeys      = argOr(argc, argv, 2, 1'000'000);
+    unsigned    maxThreads = static_cast<unsigned>(argOr(argc, argv, 3, 32));
+    std::size_t ops        = argOr(argc, argv, 4, 500'000);
+
+    auto keys = makeKeys(nKeys);
+    std::cout << "sharded: 90% GET / 10% SET, Mops/s (hardware threads: "
+              << std::thread::hardware_concurrency() << ")\n"
+              << std::setw(10) << "threads" << std::setw(14) << "1 shard"
+              << std::setw(14) << "64 shards" << '\n';
+
+    ShardedInMemoryDB single(1), sharded(64);
+    for (const auto& k : keys) { single.set(k, "a"); sharded.set(k, "a"); }
+
+    for (unsigned th = 1; th <= maxThreads; th *= 2) {
+        std::cout << std::setw(10) << th << std::fixed << std::setprecision(2)
+                  << std::setw(14) << shardedRun(single,  keys, th, ops)
+                  << std::setw(14) << shardedRun(sharded, keys, th, ops) << '\n';
+    }
+    return 0;
+}
+
+/* ─────────────── batch: MGET / MSET vs scalar loop ─────────────── */
+
+/* Random keys over a table far larger than the caches; ns per key for the
+   scalar loop and for mgetView / mset at several batch sizes. */
+static int runBatch(int argc, char** argv) {
+    std::size_t nKeys = argOr(argc, argv, 2, 4'000'000);
+    std::size_t ops   = argOr(argc, argv, 3, 2'000'000);
+
+    auto keys = makeKeys(nKeys);
+    InMemoryDB db;
+    for (const auto& k : keys) db.set(k, "a");
+
+    std::mt19937_64 rng(11);
+    std::vector<std::string_view> order(ops);
+    for (auto& v : order) v = keys[rng() % keys.size()];
+
+    std::size_t sink = 0;
+    auto t0 = Clock::now();
+    for (auto k : order) sink += db.getView(k)->size();
+    double scalarGet = nsSince(t0) / double(ops);
+    t0 = Clock::now();
+    for (auto k : order) db.set(k, "b");
+    double scalarSet = nsSince(t0) / double(ops);
+
+    std::cout << "batch: " << nKeys << " keys, " << ops << " random ops, ns/key\n"
+              << std::setw(8) << "batch" << std::setw(10) << "get" << std::setw(10) << "set" << '\n'
+              << std::fixed << std::setprecision(1) << std::setw(8) << "scalar"
+              << std::setw(10) << scalarGet << std::setw(10) << scalarSet << '\n';
+
+    std::vector<std::optional<std::string_view>>               out;
+    std::vector<std::pair<std::string_view, std::string_view>> kvs;
+    for (std::size_t b : { 1, 8, 64, 512 }) {
+        out.resize(b);
+        t0 = Clock::now();
+        for (std::size_t i = 0; i + b <= ops; i += b) {
+            db.mgetView(std::span(order).subspan(i, b), out);
+            for (auto& v : out) sink += v->size();
+        }
+        double get = nsSince(t0) / double(ops / b * b);
+
+        const char* val = (b & 64) ? "a" : "b";
+        t0 = Clock::now();
+        for (std::size_t i = 0; i + b <= ops; i += b) {
+            kvs.clear();
+            for (std::size_t j = i; j < i + b; ++j) kvs.emplace_back(order[j], val);
+            db.mset(kvs);
+        }
+        double set = nsSince(t0) / double(ops / b * b);
+        std::cout << std::setw(8) << b << std::setw(10) << get << std::setw(10) << set << '\n';
+    }
+    g_sink.fetch_add(sink, std::memory_order_relaxed);
+    return 0;
+}
+
+/* ─────────────── commands: text protocol replay ─────────────── */
+
+/* Replays a generated command log (70 % GET, 20 % SET, 5 % COUNT, 5 %
+   small BEGIN…COMMIT/ROLLBACK blocks) through CommandProcessor from an
+   mmap'ed file and from a file descriptor, against a getline + string
+   compare loop as the iostream baseline. */
+static int runCommands(int argc, char** argv) {
+    std::size_t nCmds = argOr(argc, argv, 2, 5'000'000);
+    std::size_t nKeys = argOr(argc, argv, 3, 100'000);
+
+    const std::string path =
+        (std::filesystem::temp_directory_path() / "InMemoryDbBench.cmds").string();
+    {
+        std::ofstream f(path, std::ios::binary);
+        std::mt19937_64 rng(5);
+        for (std::size_t i = 0; i < nCmds;) {
+            auto k = rng() % nKeys;
+            switch (rng() % 20) {
+            case 0:  f << "COUNT v" << k % 100 << '\n'; ++i; break;
+            case 1:  f << "BEGIN\nSET key:" << k << " v" << k % 7 << "\nGET key:" << k
+                       << ((rng() & 1) ? "\nCOMMIT\n" : "\nROLLBACK\n");
+                     i += 4; break;
+            case 2: case 3: case 4: case 5:
+                     f << "SET key:" << k << " v" << k % 100 << '\n'; ++i; break;
+            default: f << "GET key:" << k << '\n'; ++i; break;
+            }
+        }
+    }
+    auto mb = double(std::filesystem::file_size(path)) / (1 << 20);
+    std::cout << "commands: " << nCmds << " commands, " << std::fixed << std::setprecision(1)
+              << mb << " MiB\n";
+    auto row = [&](const char* name, std::size_t n, double ns) {
+        std::cout << "  " << std::left << std::setw(20) << name << std::right << std::setw(10)
+                  << double(n) / (ns / 1e9) / 1e6 << " Mcmd/s" << std::setw(10)
+                  << mb / (ns / 1e9) << " MiB/s\n";
+    };
+
+    {
+        InMemoryDB db;
+        CommandProcessor cp(db);
+        auto t0 = Clock::now();
+        std::size_t n = cp.runFile(path);
+        row("mmap", n, nsSince(t0));
+        g_sink.fetch_add(cp.output().size(), std::memory_order_relaxed);
+    }
+    {
+        InMemoryDB db;
+        CommandProcessor cp(db);
+        std::FILE* f = std::fopen(path.c_str(), "rb");
+        auto t0 = Clock::now();
+#ifdef _WIN32
+        std::size_t n = cp.runFd(_fileno(f));
+#else
+        std::size_t n = cp.runFd(fileno(f));
+#endif
+        row("fd read", n, nsSince(t0));
+        std::fclose(f);
+        g_sink.fetch_add(cp.output().size(), std::memory_order_relaxed);
+    }
+    {
+        InMemoryDB db;
+        std::ifstream in(path);
+        std::ostringstream out;
+        std::string line, op, a, b;
+        std::size_t n = 0;
+        auto t0 = Clock::now();
+        while (std::getline(in, line)) {
+            std::istringstream ss(line);
+            ss >> op >> a >> b;
+            ++n;
+            if      (op == "SET")      db.set(a, b);
+            else if (op == "GET")      out << db.get(a).value_or("NULL") << '\n';
+            else if (op == "COUNT")    out << db.count(a) << '\n';
+            else if (op == "BEGIN")    db.begin();
+            else if (op == "ROLLBACK") db.rollback();
+            else if (op == "COMMIT")   db.commit();
+        }
+        row("iostream baseline", n, nsSince(t0));
+        g_sink.fetch_add(out.str().size(), std::memory_order_relaxed);
+    }
+    std::filesystem::remove(path);
+    return 0;
+}
+
+/* ─────────────── wal: commit throughput per durability level ─────────────── */
+
+/* T threads, each with its own InMemoryDB, share one log and commit
+   small transactions; reports commits/s and how many fsyncs they cost. */
+static int runWal(int argc, char** argv) {
+    unsigned    threads = static_cast<unsigned>(argOr(argc, argv, 2, 8));
+    std::size_t commits = argOr(argc, argv, 3, 2'000);          // per thread
+    std::size_t txnKeys = argOr(argc, argv, 4, 4);
+
+    const std::string path =
+        (std::filesystem::temp_directory_path() / "InMemoryDbBench.wal").string();
+    std::cout << "wal: " << threads << " threads × " << commits << " commits of "
+              << txnKeys << " keys\n"
+              << std::setw(12) << "durability" << std::setw(14) << "commits/s"
+              << std::setw(10) << "fsyncs" << std::setw(16) << "commits/fsync" << '\n';
+
+    static const char* names[] = { "none", "async", "group", "per-commit" };
+    for (Durability d : { Durability::None, Durability::Async, Durability::Group,
+                          Durability::PerCommit }) {
+        std::filesystem::remove(path);
+        double secs;
+        std::uint64_t fsyncs;
+        {
+            // Group batches whatever arrives during the previous fsync
+            WriteAheadLog wal(path, { d, d == Durability::Async ? std::chrono::milliseconds(1)
+                                                                 : std::chrono::milliseconds(0) });
+            std::vector<std::thread> pool;
+            auto t0 = Clock::now();
+            for (unsigned t = 0; t < threads; ++t) {
+                pool.emplace_back([&, t] {
+                    InMemoryDB db;
+                    db.setCommitObserver(&wal);
+                    std::string key = "t" + std::to_string(t) + ":";
+                    for (std::size_t i = 0; i < commits; ++i) {
+                        db.begin();
+                        for (std::size_t k = 0; k < txnKeys; ++k)
+                            db.set(key + std::to_string(k), std::to_string(i));
+                        db.commit();
+                    }
+                    db.setCommitObserver(nullptr);
+                });
+            }
+            for (auto& th : pool) th.join();
+            wal.sync();
+            secs   = nsSince(t0) / 1e9;
+            fsyncs = wal.fsyncs();
+        }
+        double total = double(threads) * double(commits);
+        std::cout << std::setw(12) << names[static_cast<int>(d)] << std::fixed
+                  << std::setprecision(0) << std::setw(14) << total / secs
+                  << std::setw(10) << fsyncs << std::setprecision(1) << std::setw(16)
+                  << (fsyncs ? total / double(fsyncs) : 0.0) << '\n';
+    }
+    std::filesystem::remove(path);
+    return 0;
+}
+
+/* ─────────────── checkpoint: warm start from a mapped image ─────────────── */
+
+/* Compares rebuilding a store with N SETs against writing a checkpoint
+   once and opening it; "first get" includes open() + one lookup. */
+static int runCheckpoint(int argc, char** argv) {
+    std::size_t nKeys   = argOr(argc, argv, 2, 1'000'000);
+    std::size_t lookups = argOr(argc, argv, 3, 1'000'000);
+
+    const std::string path =
+        (std::filesystem::temp_directory_path() / "InMemoryDbBench.ckpt").string();
+    auto keys = makeKeys(nKeys);
+
+    auto t0 = Clock::now();
+    InMemoryDB src;
+    for (std::size_t i = 0; i < keys.size(); ++i) src.set(keys[i], std::to_string(i % 1000));
+    double rebuildMs = nsSince(t0) / 1e6;
+
+    t0 = Clock::now();
+    Checkpoint::write(path, src);
+    double writeMs = nsSince(t0) / 1e6;
+
+    t0 = Clock::now();
+    InMemoryDB db(Checkpoint::open(path));
+    auto first = db.getView(keys[keys.size() / 2]);
+    double firstGetUs = nsSince(t0) / 1e3;
+
+    std::mt19937_64 rng(7);
+    std::size_t sink = first ? first->size() : 0;
+    t0 = Clock::now();
+    for (std::size_t i = 0; i < lookups; ++i) sink += db.getView(keys[rng() % keys.size()])->size();
+    double imageNs = nsSince(t0) / double(lookups);
+    t0 = Clock::now();
+    for (std::size_t i = 0; i < lookups; ++i) sink += src.getView(keys[rng() % keys.size()])->size();
+    double heapNs = nsSince(t0) / double(lookups);
+    g_sink.fetch_add(sink, std::memory_order_relaxed);
+
+    std::cout << "checkpoint: " << nKeys << " keys, "
+              << std::filesystem::file_size(path) / (1 << 20) << " MiB image\n"
+              << std::fixed << std::setprecision(1)
+              << "  rebuild via SET     " << std::setw(10) << rebuildMs  << " ms\n"
+              << "  write checkpoint    " << std::setw(10) << writeMs    << " ms\n"
+              << "  open + first get    " << std::setw(10) << firstGetUs << " us\n"
+              << "  get (image)         " << std::setw(10) << imageNs    << " ns\n"
+              << "  get (in memory)     " << std::setw(10) << heapNs     << " ns\n";
+    std::filesystem::remove(path);
+    return 0;
+}
+
+/* ───────────────────────── driver ───────────────────────── */
+
+/* SET cost of maintaining the ordered index, and prefix-scan latency with
+   and without it (the unindexed scan sorts every key first). */
+static int runScan(int argc, char** argv) {
+    std::size_t nKeys = argOr(argc, argv, 2, 1'000'000);
+    std::size_t scans = argOr(argc, argv, 3, 100'000);
+    std::size_t page  = argOr(argc, argv, 4, 100);
+    auto keys = makeKeys(nKeys);
+
+    auto load = [&](InMemoryDB& db) {
+        auto t0 = Clock::now();
+        for (std::size_t i = 0; i < keys.size(); ++i) db.set(keys[i], std::to_string(i % 1000));
+        return nsSince(t0) / double(keys.size());
+    };
+    InMemoryDB plain, indexed;
+    indexed.setOrderedIndex(true);
+    double plainSetNs   = load(plain);
+    double indexedSetNs = load(indexed);
+
+    std::mt19937_64 rng(11);
+    std::size_t sink = 0;
+    auto t0 = Clock::now();
+    for (std::size_t i = 0; i < scans; ++i) {
+        std::string prefix = "user:" + std::to_string(rng() % nKeys);
+        sink += indexed.scan(prefix, page).items.size();
+    }
+    double indexedUs = nsSince(t0) / 1e3 / double(scans);
+
+    const std::size_t slowScans = std::max<std::size_t>(1, scans / 10000);
+    t0 = Clock::now();
+    for (std::size_t i = 0; i < slowScans; ++i)
+        sink += plain.scan("user:" + std::to_string(rng() % nKeys), page).items.size();
+    double plainUs = nsSince(t0) / 1e3 / double(slowScans);
+    g_sink.fetch_add(sink, std::memory_order_relaxed);
+
+    std::cout << "scan: " << nKeys << " keys, page " << page << "\n"
+              << std::fixed << std::setprecision(1)
+              << "  set (no index)      " << std::setw(10) << plainSetNs   << " ns\n"
+              << "  set (ordered index) " << std::setw(10) << indexedSetNs << " ns\n"
+              << "  scan (index)        " << std::setw(10) << indexedUs    << " us\n"
+              << "  scan (no index)     " << std::setw(10) << plainUs      << " us\n";
+    return 0;
+}
+
+/* Every key gets a random TTL; the clock then moves 1 ms per tick and each
+   tick runs one budgeted expire().  The spec run is 50M keys
+   (`InMemoryDbBench ttl 50000000`, needs ~10 GB). */
+static int runTtl(int argc, char** argv) {
+    std::size_t nKeys  = argOr(argc, argv, 2, 5'000'000);
+    std::size_t maxTtl = argOr(argc, argv, 3, 60'000);
+    std::size_t budget = argOr(argc, argv, 4, 1000);
+
+    std::uint64_t clock = 0;
+    InMemoryDB db;
+    db.setClock([&] { return clock; });
+    std::mt19937_64 rng(13);
+
+    auto t0 = Clock::now();
+    for (std::size_t i = 0; i < nKeys; ++i)
+        db.set("user:" + std::to_string(i) + ":session", std::to_string(i % 1000),
+               std::chrono::milliseconds(1 + rng() % maxTtl));
+    double setNs = nsSince(t0) / double(nKeys);
+
+    std::vector<double> tickUs;
+    tickUs.reserve(maxTtl + 1);
+    std::size_t expired = 0;
+    t0 = Clock::now();
+    while (db.expiringKeys()) {
+        ++clock;
+        auto t1 = Clock::now();
+        expired += db.expire(budget);
+        tickUs.push_back(nsSince(t1) / 1e3);
+    }
+    double totalMs = nsSince(t0) / 1e6;
+    std::size_t lagTicks = tickUs.size() > maxTtl ? tickUs.size() - maxTtl : 0;
+
+    std::cout << "ttl: " << nKeys << " keys, ttl 1.." << maxTtl << " ms, budget " << budget << "\n"
+              << std::fixed << std::setprecision(1)
+              << "  set with ttl        " << std::setw(10) << setNs << " ns\n"
+              << "  expired             " << std::setw(10) << expired << " keys in " << tickUs.size()
+              << " ticks (" << lagTicks << " behind)\n"
+              << "  per expired key     " << std::setw(10) << totalMs * 1e6 / double(std::max<std::size_t>(expired, 1)) << " ns\n"
+              << "  tick p50            " << std::setw(10) << percentile(tickUs, 0.50) << " us\n"
+              << "  tick p99            " << std::setw(10) << percentile(tickUs, 0.99) << " us\n"
+              << "  tick max            " << std::setw(10) << percentile(tickUs, 1.0)  << " us\n";
+    return db.count("0") == 0 ? 0 : 1;
+}
+
+/* read-through cache: GET, SET on a miss; 90 % of requests go to 10 % of keys */
+static int runEvict(int argc, char** argv) {
+    std::size_t nKeys   = argOr(argc, argv, 2, 1'000'000);
+    std::size_t ops     = argOr(argc, argv, 3, 5'000'000);
+    std::size_t limitMb = argOr(argc, argv, 4, 16);
+
+    std::vector<std::string> keys(nKeys);
+    for (std::size_t i = 0; i < nKeys; ++i) keys[i] = "user:" + std::to_string(i) + ":profile";
+    const std::string value(100, 'v');
+    const std::size_t hot = std::max<std::size_t>(1, nKeys / 10);
+
+    std::cout << "evict: " << nKeys << " keys, " << ops << " ops, 90/10 skew, 100 B values\n"
+              << std::fixed << std::setprecision(1);
+    for (std::size_t mb : { std::size_t(0), limitMb }) {
+        InMemoryDB db;
+        db.setMemoryLimit(mb << 20);
+        std::mt19937_64 rng(17);
+        auto t0 = Clock::now();
+        for (std::size_t i = 0; i < ops; ++i) {
+            std::size_t k = rng() % 10 ? rng() % hot : rng() % nKeys;
+            if (!db.getView(keys[k])) db.set(keys[k], value);
+        }
+        double secs = nsSince(t0) / 1e9;
+        CacheStats st = db.cacheStats();
+        std::cout << "  limit " << std::setw(5) << (mb ? std::to_string(mb) + " MB" : "none")
+                  << "   " << std::setw(6) << secs * 1e9 / double(ops) << " ns/op"
+                  << "   hit ratio " << std::setw(5) << 100.0 * st.hitRatio() << " %"
+                  << "   " << std::setw(10) << double(st.evictions) / secs << " evictions/s"
+                  << "   used " << std::setw(6) << double(db.memoryUsage()) / double(1 << 20) << " MB\n";
+    }
+    return 0;
+}
+
+/* SET upkeep of the value → keys index, and keysWithValue with / without it */
+static int runByValue(int argc, char** argv) {
+    std::size_t nKeys   = argOr(argc, argv, 2, 1'000'000);
+    std::size_t nValues = std::max<std::size_t>(1, argOr(argc, argv, 3, 1000));
+    std::size_t queries = argOr(argc, argv, 4, 100);
+
+    std::cout << "by-value: " << nKeys << " keys, " << nValues << " values, "
+              << queries << " queries\n" << std::fixed << std::setprecision(1);
+    for (bool on : { false, true }) {
+        InMemoryDB db;
+        db.setValueIndex(on);
+        std::mt19937_64 rng(19);
+        auto t0 = Clock::now();
+        for (std::size_t i = 0; i < nKeys; ++i)
+            db.set("key:" + std::to_string(i), "val:" + std::to_string(rng() % nValues));
+        for (std::size_t i = 0; i < nKeys; ++i)          // move every key once
+            db.set("key:" + std::to_string(i), "val:" + std::to_string(rng() % nValues));
+        double setNs = nsSince(t0) / double(2 * nKeys);
+
+        std::size_t found = 0;
+        t0 = Clock::now();
+        for (std::size_t q = 0; q < queries; ++q)
+            found += db.keysWithValue("val:" + std::to_string(q % nValues), std::size_t(-1),
+                                      [](std::string_view) {});
+        double queryUs = nsSince(t0) / 1e3 / double(std::max<std::size_t>(queries, 1));
+        std::cout << "  index " << (on ? "on " : "off") << "   set " << std::setw(7) << setNs << " ns"
+                  << "   keysWithValue " << std::setw(10) << queryUs << " us ("
+                  << found / std::max<std::size_t>(queries, 1) << " keys)"
+                  << "   memory " << std::setw(7) << double(db.memoryUsage()) / double(1 << 20) << " MB\n";
+    }
+    return 0;
+}
+
+/* ─────────── resize: worst-case insert while the table grows ─────────── */
+
+/* max insert latency (ns) over each window of inserts [2^k, 2^(k+1)) */
+template <class Insert>
+static std::vector<double> worstPerWindow(std::size_t nKeys, Insert insert) {
+    std::vector<double> worst;
+    std::string key;
+    for (std::size_t i = 0; i < nKeys; ++i) {
+        key = "user:" + std::to_string(i) + ":profile";   // built outside the timer
+        auto t = Clock::now();
+        insert(key);
+        double ns = nsSince(t);
+        std::size_t w = std::bit_width(i);
+        if (worst.size() <= w) worst.resize(w + 1, 0);
+        worst[w] = std::max(worst[w], ns);
+    }
+    return worst;
+}
+
+static int runResize(int argc, char** argv) {
+    std::size_t nKeys = argOr(argc, argv, 2, 4'000'000);
+
+    auto flat = worstPerWindow(nKeys, [m = FlatHashMap<std::string, std::uint64_t>()](const std::string& k) mutable {
+        m.try_emplace(k, 1);
+    });
+    auto inc = worstPerWindow(nKeys, [m = IncrementalHashMap<std::string, std::uint64_t, StringHash, std::equal_to<>>()](const std::string& k) mutable {
+        m.try_emplace(k, 1);
+    });
+    InMemoryDB db;
+    auto set = worstPerWindow(nKeys, [&db](const std::string& k) { db.set(k, "v"); });
+
+    std::cout << "resize: " << nKeys << " inserts, worst insert per window (us)\n"
+              << std::right << std::setw(14) << "keys up to" << std::setw(14) << "FlatHashMap"
+              << std::setw(14) << "Incremental" << std::setw(16) << "InMemoryDB::set" << '\n'
+              << std::fixed << std::setprecision(1);
+    for (std::size_t w = 10; w < flat.size(); ++w)     // below 1024 keys both rehash at once
+        std::cout << std::setw(14) << std::min(nKeys, std::size_t(1) << w)
+                  << std::setw(14) << flat[w] / 1e3 << std::setw(14) << inc[w] / 1e3
+                  << std::setw(16) << set[w] / 1e3 << '\n';
+    return 0;
+}
+
+/* ───────── snapshot: write latency while a snapshot is written ───────── */
+
+/* Distinct values of `value bytes` each, so the store is as large as it
+   looks.  SETs at a fixed rate (0 ⇒ as fast as possible) on random keys:
+   first without a snapshot, then while a BackgroundSnapshot writes the
+   store out.  Latency is lock wait + SET.  The last line is what a
+   blocking Checkpoint::write costs: every write waits that long. */
+static int runSnapshot(int argc, char** argv) {
+    std::size_t nKeys  = std::max<std::size_t>(1, argOr(argc, argv, 2, 1'000'000));
+    std::size_t valLen = argOr(argc, argv, 3, 256);
+    std::size_t rate   = argOr(argc, argv, 4, 100'000);
+
+    namespace fs = std::filesystem;
+    const std::string path = (fs::temp_directory_path() / "InMemoryDbBench.snap").string();
+    auto keys = makeKeys(nKeys);
+    InMemoryDB db;
+    std::mutex mu;
+    for (const auto& k : keys) {
+        std::string v = k;
+        v.resize(std::max(valLen, k.size()), '.');
+        db.set(k, v);
+    }
+    const double dataMiB = double(db.memoryUsage()) / (1 << 20);
+
+    std::mt19937_64 rng(5);
+    std::string val(valLen, 'w');
+    std::size_t peakSaved = 0;
+    /* SETs until done() (or n of them); latencies in ns */
+    auto writes = [&](auto&& done, std::size_t n) {
+        std::vector<double> lat;
+        const auto t0 = Clock::now();
+        for (std::size_t i = 0; i < n && !done(); ++i) {
+            if (rate) std::this_thread::sleep_until(t0 + std::chrono::nanoseconds(i * 1'000'000'000 / rate));
+            const std::string& k = keys[rng() % nKeys];
+            val[0] = static_cast<char>('a' + i % 26);
+            const auto t = Clock::now();
+            std::lock_guard lock(mu);
+            db.set(k, val);
+            lat.push_back(nsSince(t));
+            if (i % 256 == 0) peakSaved = std::max(peakSaved, db.snapshotBytes());
+        }
+        return lat;
+    };
+    auto row = [](const char* name, std::vector<double>& lat) {
+        std::cout << std::left << std::setw(22) << name << std::right << std::setw(10) << lat.size()
+                  << std::fixed << std::setprecision(1)
+                  << std::setw(10) << percentile(lat, 0.50) / 1e3
+                  << std::setw(10) << percentile(lat, 0.99) / 1e3
+                  << std::setw(10) << percentile(lat, 0.999) / 1e3
+                  << std::setw(12) << percentile(lat, 1.0) / 1e3 << '\n';
+    };
+
+    auto t0 = Clock::now();
+    std::vector<double> during;
+    std::uint64_t snapKeys = 0;
+    {
+        BackgroundSnapshot snap(db, mu, path);
+        during = writes([&] { return snap.done(); }, std::size_t(-1));
+        snap.wait();
+        snapKeys = snap.keys();
+    }
+    const double snapMs = nsSince(t0) / 1e6;
+    const double fileMiB = double(fs::file_size(path)) / (1 << 20);
+    auto quiet = writes([] { return false; }, during.size());
+
+    t0 = Clock::now();
+    Checkpoint::write(path, db);
+    const double blockingMs = nsSince(t0) / 1e6;
+    fs::remove(path);
+
+    std::cout << "snapshot: " << nKeys << " keys, " << std::fixed << std::setprecision(1)
+              << dataMiB << " MiB, SET rate " << (rate ? std::to_string(rate) + "/s" : "unlimited") << '\n'
+              << "  background snapshot " << std::setw(10) << snapMs << " ms, " << snapKeys
+              << " keys, " << fileMiB << " MiB file\n"
+              << "  peak pre-images     " << std::setw(10) << double(peakSaved) / (1 << 20)
+              << " MiB (" << std::setprecision(2) << 100.0 * double(peakSaved) / (dataMiB * (1 << 20))
+              << " % of the store)\n" << std::setprecision(1)
+              << "  blocking checkpoint " << std::setw(10) << blockingMs << " ms\n\n"
+              << std::left << std::setw(22) << "SET latency (us)" << std::right << std::setw(10) << "writes"
+              << std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(10) << "p999"
+              << std::setw(12) << "max" << '\n';
+    row("  no snapshot", quiet);
+    row("  during snapshot", during);
+    return 0;
+}
+
+/* ───────── stats: cost of the operation counters (compare builds) ───────── */
+
+/* counter updates: GET + parse + add + format + SET against incr(), outside
+   a transaction and inside one long one (every key logged once, then
+   incremented in place) */
+static int runIncr(int argc, char** argv) {
+    std::size_t nKeys = std::max<std::size_t>(1, argOr(argc, argv, 2, 100'000));
+    std::size_t ops   = std::max<std::size_t>(1, argOr(argc, argv, 3, 5'000'000));
+
+    auto keys = makeKeys(nKeys);
+    std::cout << "incr: " << nKeys << " counters, " << ops << " increments\n"
+              << std::setw(14) << "path" << std::setw(8) << "txn" << std::setw(12) << "ns/op"
+              << std::setw(14) << "allocs/op" << '\n';
+    for (bool txn : { false, true })
+        for (bool native : { false, true }) {
+            InMemoryDB db;
+            for (std::size_t i = 0; i < nKeys; ++i)   // distinct starting points
+                db.set(keys[i], std::to_string(1'000'000 * i));
+            if (txn) {
+                db.begin();
+                for (const auto& k : keys) db.incr(k);
+            }
+            std::mt19937_64 rng(29);
+            const std::size_t allocs0 = t_allocs;
+            auto t0 = Clock::now();
+            for (std::size_t i = 0; i < ops; ++i) {
+                const std::string& k = keys[rng() % nKeys];
+                if (native) { db.incr(k); continue; }
+                std::int64_t n = 0;
+                auto v = db.getView(k);
+                std::from_chars(v->data(), v->data() + v->size(), n);
+                char buf[24];
+                db.set(k, std::string_view(buf, std::to_chars(buf, buf + sizeof buf, n + 1).ptr));
+            }
+            const double ns = nsSince(t0) / double(ops);
+            std::cout << std::setw(14) << (native ? "incr" : "get+set") << std::setw(8) << (txn ? "yes" : "no")
+                      << std::fixed << std::setprecision(1) << std::setw(12) << ns
+                      << std::setw(14) << std::setprecision(4) << double(t_allocs - allocs0) / double(ops) << '\n';
+            if (txn) db.commit();
+        }
+    return 0;
+}
+
+/* autocommit SETs with no observer, then with a ChangeStream attached –
+   alone, with a reader polling in another thread, and with Block
+   back-pressure; the ns/op difference is the cost of publishing */
+static int runCdc(int argc, char** argv) {
+    std::size_t nKeys  = std::max<std::size_t>(1, argOr(argc, argv, 2, 100'000));
+    std::size_t ops    = std::max<std::size_t>(1, argOr(argc, argv, 3, 5'000'000));
+    std::size_t ringKB = std::max<std::size_t>(1, argOr(argc, argv, 4, 64));
+
+    auto keys = makeKeys(nKeys);
+    std::vector<std::string> vals;
+    for (int i = 0; i < 64; ++i) vals.push_back("value-" + std::to_string(i * 7919));
+    std::cout << "cdc: " << nKeys << " keys, " << ops << " sets, " << ringKB << " KB ring\n";
+    {
+        ChangeStream stream(ringKB * 1024);
+        auto t0 = Clock::now();
+        for (std::size_t i = 0; i < ops; ++i) {
+            CommittedChange c{ keys[i % nKeys], std::string_view(vals[i % vals.size()]) };
+            stream.onCommit({ &c, 1 });
+        }
+        std::cout << "onCommit alone: " << std::fixed << std::setprecision(1)
+                  << nsSince(t0) / double(ops) << " ns/record\n";
+    }
+    std::cout << std::setw(18) << "stream" << std::setw(12) << "ns/op" << std::setw(14) << "allocs/op"
+              << std::setw(12) << "read" << std::setw(12) << "lost" << '\n';
+    enum { None, Alone, Reader, Block };
+    static const char* names[] = { "none", "overwrite", "overwrite+reader", "block+reader" };
+    for (int mode : { None, Alone, Reader, Block }) {
+        ChangeStream stream(ringKB * 1024, mode == Block ? ChangeStream::Overflow::Block
+                                                         : ChangeStream::Overflow::Overwrite);
+        InMemoryDB db;
+        for (std::size_t i = 0; i < nKeys; ++i) db.set(keys[i], vals[i % vals.size()]);
+        if (mode != None) db.setCommitObserver(&stream);
+
+        std::atomic<bool> done{ false };
+        std::uint64_t read = 0, lost = 0;
+        std::thread consumer;
+        if (mode == Reader || mode == Block)
+            consumer = std::thread([&, r = stream.subscribe()]() mutable {
+                for (;;) {
+                    const bool last = done.load(std::memory_order_acquire);
+                    std::size_t n = r.poll([&](std::uint64_t, std::span<const CommittedChange> cs) {
+                        g_sink += cs.size();
+                    });
+                    read += n;
+                    if (!n && last) break;
+                    if (!n) std::this_thread::yield();
+                }
+                lost = r.lost();
+            });
+
+        std::mt19937_64 rng(31);
+        const std::size_t allocs0 = t_allocs;
+        auto t0 = Clock::now();
+        for (std::size_t i = 0; i < ops; ++i) db.set(keys[rng() % nKeys], vals[i % vals.size()]);
+        const double ns = nsSince(t0) / double(ops);
+        const std::size_t allocs = t_allocs - allocs0;
+        done.store(true, std::memory_order_release);
+        if (consumer.joinable()) consumer.join();
+        db.setCommitObserver(nullptr);
+
+        std::cout << std::setw(18) << names[mode] << std::fixed << std::setprecision(1)
+                  << std::setw(12) << ns << std::setw(14) << std::setprecision(4)
+                  << double(allocs) / double(ops) << std::setw(12) << read << std::setw(12) << lost << '\n';
+    }
+    return 0;
+}
+
+/* the same GET/SET mix in a build with INMEMORYDB_STATS on and one with it
+   off; the ns/op difference is the instrumentation overhead */
+static int runStats(int argc, char** argv) {
+    std::size_t nKeys = std::max<std::size_t>(1, argOr(argc, argv, 2, 1'000'000));
+    std::size_t ops   = argOr(argc, argv, 3, 10'000'000);
+
+    auto keys = makeKeys(nKeys);
+    InMemoryDB db;
+    for (auto& k : keys) db.set(k, "v");
+    db.resetStats();
+
+    std::mt19937_64 rng(23);
+    std::size_t found = 0;
+    auto t0 = Clock::now();
+    for (std::size_t i = 0; i < ops; ++i) {
+        const std::string& k = keys[rng() % nKeys];
+        if (i % 8) found += db.getView(k).has_value();   // 7 GET : 1 SET
+        else       db.set(k, i % 16 ? "v" : "w");
+    }
+    double ns = nsSince(t0) / double(std::max<std::size_t>(ops, 1));
+    g_sink += found;
+
+    std::cout << "stats: " << nKeys << " keys, " << ops << " ops (7 GET : 1 SET), instrumentation "
+              << (DbStats::enabled ? "ON" : "OFF") << '\n'
+              << std::fixed << std::setprecision(1) << "  " << ns << " ns/op\n\n"
+              << db.stats().text();
+    return 0;
+}
+
+struct Benchmark {
+    const char* name;
+    const char* usage;
+    int (*run)(int, char**);
+};
+
+static const Benchmark kBenchmarks[] = {
+    { "map-get", "[keys=1e6] [lookups=1e6]", runMapGet },
+    { "txn-log", "[max txn keys=1e6]",       runTxnLog },
+    { "txn-churn", "[levels=1e6] [keys=1e5]", runTxnChurn },
+    { "release",   "[units=1e5] [keys=1e5]",  runRelease },
+    { "sharded", "[keys=1e6] [max threads=32] [ops/thread=5e5]", runSharded },
+    { "batch",   "[keys=4e6] [ops=2e6]", runBatch },
+    { "wal",     "[threads=8] [commits/thread=2000] [keys/txn=4]", runWal },
+    { "commands",   "[commands=5e6] [keys=1e5]", runCommands },
+    { "checkpoint", "[keys=1e6] [lookups=1e6]", runCheckpoint },
+    { "scan",       "[keys=1e6] [scans=1e5] [page=100]", runScan },
+    { "ttl",        "[keys=5e6] [max ttl ms=60000] [budget=1000]", runTtl },
+    { "evict",      "[keys=1e6] [ops=5e6] [limit MB=16]", runEvict },
+    { "by-value",   "[keys=1e6] [values=1000] [queries=100]", runByValue },
+    { "resize",     "[keys=4e6]", runResize },
+    { "incr",       "[keys=1e5] [ops=5e6]", runIncr },
+    { "cdc",        "[keys=1e5] [ops=5e6] [ring KB=64]", runCdc },
+    { "stats",      "[keys=1e6] [ops=1e7]", runStats },
+    { "snapshot",   "[keys=1e6] [value bytes=256] [sets/s=1e5, 0 = unlimited]", runSnapshot },
+};
+
+int main(int argc, char** argv) {
+    if (argc >= 2) {
+        for (const auto& b : kBenchmarks)
+            if (std::strcmp(argv[1], b.name) == 0) return b.run(argc, argv);
+    }
+    std::cerr << "usage: InMemoryDbBench <benchmark> [args]\n";
+    for (const auto& b : kBenchmarks)
+        std::cerr << "  " << std::left << std::setw(14) << b.name << b.usage << '\n';
+    return 1;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+/*
+ * AllocCounter – global operator new / delete replacements that report
+ * every heap allocation, for the test runner and the benchmarks.
+ *
+ * Every replaceable form is defined – scalar and array, sized, aligned
+ * and nothrow – so no allocation escapes the count and each delete pairs
+ * with the allocator of its new.  Each allocation calls
+ *
+ *   void onHeapAllocation() noexcept;
+ *
+ * which the including program defines (a process-wide atomic in the test
+ * runner, a thread-local tally in the benchmarks).  Replacement functions
+ * must be defined once per program, so include this header in exactly one
+ * translation unit of an executable and never in the library.
+ */
+
+void onHeapAllocation() noexcept;
+
+/* GCC inlines a replaced delete into code that got the pointer from new
+   and then reports free() on it as mismatched; keep the frees out of line */
+#if defined(__GNUC__) || defined(__clang__)
+#  define ALLOC_COUNTER_NOINLINE __attribute__((noinline))
+#else
+#  define ALLOC_COUNTER_NOINLINE
+#endif
+
+namespace alloc_counter {
+
+inline void* allocate(std::size_t n) noexcept {
+    onHeapAllocation();
+    return std::malloc(n ? n : 1);
+}
+
+inline void* allocate(std::size_t n, std::align_val_t al) noexcept {
+    onHeapAllocation();
+    const std::size_t a = static_cast<std::size_t>(al);
+#ifdef _WIN32
+    return _aligned_malloc(n ? n : 1, a);
+#else
+    return std::aligned_alloc(a, n ? (n + a - 1) / a * a : a);   // size: multiple of a
+#endif
+}
+
+ALLOC_COUNTER_NOINLINE inline void release(void* p) noexcept { std::free(p); }
+
+ALLOC_COUNTER_NOINLINE inline void release(void* p, std::align_val_t) noexcept {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+inline void* orThrow(void* p) {
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+} // namespace alloc_counter
+
+void* operator new  (std::size_t n)                      { return alloc_counter::orThrow(alloc_counter::allocate(n)); }
+void* operator new[](std::size_t n)                      { return alloc_counter::orThrow(alloc_counter::allocate(n)); }
+void* operator new  (std::size_t n, std::align_val_t a)  { return alloc_counter::orThrow(alloc_counter::allocate(n, a)); }
+void* operator new[](std::size_t n, std::align_val_t a)  { return alloc_counter::orThrow(alloc_counter::allocate(n, a)); }
+void* operator new  (std::size_t n, const std::nothrow_t&) noexcept { return alloc_counter::allocate(n); }
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept { return alloc_counter::allocate(n); }
+void* operator new  (std::size_t n, std::align_val_t a, const std::nothrow_t&) noexcept { return alloc_counter::allocate(n, a); }
+void* operator new[](std::size_t n, std::align_val_t a, const std::nothrow_t&) noexcept { return alloc_counter::allocate(n, a); }
+
+void operator delete  (void* p) noexcept                                  { alloc_counter::release(p); }
+void operator delete[](void* p) noexcept                                  { alloc_counter::release(p); }
+void operator delete  (void* p, std::size_t) noexcept                     { alloc_counter::release(p); }
+void operator delete[](void* p, std::size_t) noexcept                     { alloc_counter::release(p); }
+void operator delete  (void* p, const std::nothrow_t&) noexcept           { alloc_counter::release(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept           { alloc_counter::release(p); }
+void operator delete  (void* p, std::align_val_t a) noexcept              { alloc_counter::release(p, a); }
+void operator delete[](void* p, std::align_val_t a) noexcept              { alloc_counter::release(p, a); }
+void operator delete  (void* p, std::size_t, std::align_val_t a) noexcept { alloc_counter::release(p, a); }
+void operator delete[](void* p, std::size_t, std::align_val_t a) noexcept { alloc_counter::release(p, a); }
+void operator delete  (void* p, std::align_val_t a, const std::nothrow_t&) noexcept { alloc_counter::release(p, a); }
+void operator delete[](void* p, std::align_val_t a, const std::nothrow_t&) noexcept { alloc_counter::release(p, a); }
@@ -0,0 +1,351 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <utility>
+
+/*
+ * BPlusTreeSet – ordered set of keys kept in a B+tree whose leaves form a
+ * doubly linked list.
+ *
+ * ────────────────────────────────────────────────────────────────
+ *  Layout
+ * ────────────────────────────────────────────────────────────────
+ *
+ *  Leaf   : up to Order sorted keys + prev / next leaf
+ *  Inner  : n separator keys + n+1 children; every key in child[i] is
+ *           < keys[i] and every key in child[i+1] is ≥ keys[i]
+ *
+ *  All leaves are on the same depth.  Every node except the root holds
+ *  at least Order/2 keys: insert splits a full node in two halves, erase
+ *  borrows from a sibling with spare keys or merges with it.  A node is
+ *  one allocation with its keys inline, so a lookup touches depth nodes
+ *  (≈ log_{Order/2} N) and an in-order walk reads whole leaves in
+ *  sequence – lower_bound plus k increments costs O(log N + k).
+ *
+ *  Separators are copies of keys that may since have been erased; they
+ *  only route lookups and never have to match a stored key.
+ *
+ *  Lookups are transparent when Compare is (std::less<> by default), so
+ *  a BPlusTreeSet<std::string> can be probed with a std::string_view.
+ *
+ *  Iterators stay valid until the next insert or erase.
+ */
+template <class Key, class Compare = std::less<>, std::size_t Order = 64>
+class BPlusTreeSet {
+    static_assert(Order >= 4, "nodes must be able to split into two non-trivial halves");
+    static constexpr std::size_t kMin = Order / 2;
+
+    struct Node {
+        bool          leaf;
+        std::uint32_t n = 0;                     // #keys
+        explicit Node(bool l) : leaf(l) {}
+    };
+    struct Leaf : Node {
+        Key   keys[Order + 1];                   // +1: room to overflow before a split
+        Leaf* prev = nullptr;
+        Leaf* next = nullptr;
+        Leaf() : Node(true) {}
+    };
+    struct Inner : Node {
+        Key   keys[Order + 1];
+        Node* child[Order + 2];
+        Inner() : Node(false) {}
+    };
+
+    Node*       root_ = nullptr;
+    Leaf*       head_ = nullptr;                 // leftmost leaf
+    std::size_t size_ = 0;
+    std::size_t leaves_ = 0, inners_ = 0;        // allocated nodes
+    Compare     cmp_;
+
+public:
+    class const_iterator {
+        friend class BPlusTreeSet;
+        const Leaf*   leaf_ = nullptr;
+        std::uint32_t idx_  = 0;
+
+        const_iterator(const Leaf* l, std::uint32_t i) : leaf_(l), idx_(i) { skip(); }
+        void skip() {
+            while (leaf_ && idx_ == leaf_->n) { leaf_ = leaf_->next; idx_ = 0; }
+        }
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = Key;
+        using difference_type   = std::ptrdiff_t;
+        using reference         = const Key&;
+        using pointer           = const Key*;
+
+        const_iterator() = default;
+        reference operator*()  const { return leaf_->keys[idx_]; }
+        pointer   operator->() const { return &leaf_->keys[idx_]; }
+        const_iterator& operator++()    { ++idx_; skip(); return *this; }
+        const_iterator  operator++(int) { const_iterator t = *this; ++*this; return t; }
+        bool operator==(const const_iterator& o) const { return leaf_ == o.leaf_ && idx_ == o.idx_; }
+    };
+    using iterator = const_iterator;             // keys are immutable
+
+    BPlusTreeSet() = default;
+    ~BPlusTreeSet() { clear(); }
+
+    BPlusTreeSet(const BPlusTreeSet& o) : cmp_(o.cmp_) {
+        for (const auto& k : o) insert(k);
+    }
+    BPlusTreeSet& operator=(const BPlusTreeSet& o) {
+        if (this != &o) { BPlusTreeSet tmp(o); swap(tmp); }
+        return *this;
+    }
+    BPlusTreeSet(BPlusTreeSet&& o) noexcept { swap(o); }
+    BPlusTreeSet& operator=(BPlusTreeSet&& o) noexcept {
+        if (this != &o) { BPlusTreeSet tmp(std::move(o)); swap(tmp); }
+        return *this;
+    }
+    void swap(BPlusTreeSet& o) noexcept {
+        std::swap(root_, o.root_);
+        std::swap(head_, o.head_);
+        std::swap(size_, o.size_);
+        std::swap(leaves_, o.leaves_);
+        std::swap(inners_, o.inners_);
+        std::swap(cmp_,  o.cmp_);
+    }
+
+    std::size_t size()  const { return size_; }
+    bool        empty() const { return size_ == 0; }
+    /* bytes of the nodes themselves; heap owned by the keys is not included */
+    std::size_t memoryBytes() const { return leaves_ * sizeof(Leaf) + inners_ * sizeof(Inner); }
+
+    const_iterator begin() const { return const_iterator(head_, 0); }
+    const_iterator end()   const { return const_iterator(); }
+
+    void clear() {
+        destroy(root_);
+        root_ = nullptr;
+        head_ = nullptr;
+        size_ = leaves_ = inners_ = 0;
+    }
+
+    /* first key not less than k */
+    template <class K>
+    const_iterator lower_bound(const K& k) const {
+        if (!root_) return end();
+        const Node* x = root_;
+        while (!x->leaf) {
+            auto* in = static_cast<const Inner*>(x);
+            x = in->child[upper(in->keys, in->n, k)];
+        }
+        auto* l = static_cast<const Leaf*>(x);
+        return const_iterator(l, lower(l->keys, l->n, k));
+    }
+
+    template <class K>
+    bool contains(const K& k) const {
+        auto it = lower_bound(k);
+        return it != end() && !cmp_(k, *it);
+    }
+
+    /* true ⇒ k was not present */
+    template <class K>
+    bool insert(K&& k) {
+        if (!root_) { root_ = head_ = new Leaf(); ++leaves_; }
+        Key   sep;
+        Node* right = nullptr;
+        bool  added = false;
+        insertAt(root_, std::forward<K>(k), added, sep, right);
+        if (right) {                             // root split: grow one level
+            auto* r = new Inner();
+            ++inners_;
+            r->keys[0]  = std::move(sep);
+            r->child[0] = root_;
+            r->child[1] = right;
+            r->n        = 1;
+            root_       = r;
+        }
+        size_ += added;
+        return added;
+    }
+
+    /* true ⇒ k was present */
+    template <class K>
+    bool erase(const K& k) {
+        if (!root_ || !eraseAt(root_, k)) return false;
+        --size_;
+        if (!root_->leaf && root_->n == 0) {     // root lost its last separator
+            Node* old = root_;
+            root_ = static_cast<Inner*>(old)->child[0];
+            delete static_cast<Inner*>(old);
+            --inners_;
+        }
+        return true;
+    }
+
+private:
+    /* #keys[i] ≤ k, i.e. the child that routes k */
+    template <class K>
+    std::uint32_t upper(const Key* keys, std::uint32_t n, const K& k) const {
+        return static_cast<std::uint32_t>(
+            std::upper_bound(keys, keys + n, k, [&](const K& a, const Key& b) { return cmp_(a, b); }) - keys);
+    }
+    template <class K>
+    std::uint32_t lower(const Key* keys, std::uint32_t n, const K& k) const {
+        return static_cast<std::uint32_t>(
+            std::lower_bound(keys, keys + n, k, [&](const Key& a, const K& b) { return cmp_(a, b); }) - keys);
+    }
+
+    static void destroy(Node* x) {
+        if (!x) return;
+        if (x->leaf) { delete static_cast<Leaf*>(x); return; }
+        auto* in = static_cast<Inner*>(x);
+        for (std::uint32_t i = 0; i <= in->n; ++i) destroy(in->child[i]);
+        delete in;
+    }
+
+    /* on overflow, x keeps the left half and (sep, right) go to the parent */
+    template <class K>
+    void insertAt(Node* x, K&& k, bool& added, Key& sep, Node*& right) {
+        if (x->leaf) {
+            auto* l = static_cast<Leaf*>(x);
+            std::uint32_t i = lower(l->keys, l->n, k);
+            if (i < l->n && !cmp_(k, l->keys[i])) return;
+            std::move_backward(l->keys + i, l->keys + l->n, l->keys + l->n + 1);
+            l->keys[i] = Key(std::forward<K>(k));
+            ++l->n;
+            added = true;
+            if (l->n <= Order) return;
+
+            auto* r = new Leaf();
+            ++leaves_;
+            const std::uint32_t keep = l->n / 2;
+            std::move(l->keys + keep, l->keys + l->n, r->keys);
+            r->n = l->n - keep;
+            l->n = keep;
+            r->prev = l;
+            r->next = l->next;
+            if (l->next) l->next->prev = r;
+            l->next = r;
+            sep   = r->keys[0];
+            right = r;
+            return;
+        }
+
+        auto* in = static_cast<Inner*>(x);
+        std::uint32_t c = upper(in->keys, in->n, k);
+        Key   childSep;
+        Node* childRight = nullptr;
+        insertAt(in->child[c], std::forward<K>(k), added, childSep, childRight);
+        if (!childRight) return;
+
+        std::move_backward(in->keys + c, in->keys + in->n, in->keys + in->n + 1);
+        std::move_backward(in->child + c + 1, in->child + in->n + 1, in->child + in->n + 2);
+        in->keys[c]      = std::move(childSep);
+        in->child[c + 1] = childRight;
+        ++in->n;
+        if (in->n <= Order) return;
+
+        auto* r = new Inner();                   // keys[mid] moves up
+        ++inners_;
+        const std::uint32_t mid = in->n / 2;
+        std::move(in->keys + mid + 1, in->keys + in->n, r->keys);
+        std::copy(in->child + mid + 1, in->child + in->n + 1, r->child);
+        r->n  = in->n - mid - 1;
+        sep   = std::move(in->keys[mid]);
+        in->n = mid;
+        right = r;
+    }
+
+    template <class K>
+    bool eraseAt(Node* x, const K& k) {
+        if (x->leaf) {
+            auto* l = static_cast<Leaf*>(x);
+            std::uint32_t i = lower(l->keys, l->n, k);
+            if (i == l->n || cmp_(k, l->keys[i])) return false;
+            std::move(l->keys + i + 1, l->keys + l->n, l->keys + i);
+            --l->n;
+            return true;
+        }
+        auto* in = static_cast<Inner*>(x);
+        std::uint32_t c = upper(in->keys, in->n, k);
+        if (!eraseAt(in->child[c], k)) return false;
+        if (in->child[c]->n < kMin) rebalance(in, c);
+        return true;
+    }
+
+    /* child c of p is one key short: borrow from a sibling or merge */
+    void rebalance(Inner* p, std::uint32_t c) {
+        Node* x = p->child[c];
+        if (c > 0 && p->child[c - 1]->n > kMin) {
+            Node* s = p->child[c - 1];
+            if (x->leaf) {
+                auto* l = static_cast<Leaf*>(x);
+                auto* L = static_cast<Leaf*>(s);
+                std::move_backward(l->keys, l->keys + l->n, l->keys + l->n + 1);
+                l->keys[0] = std::move(L->keys[L->n - 1]);
+                p->keys[c - 1] = l->keys[0];
+            } else {
+                auto* in = static_cast<Inner*>(x);
+                auto* L  = static_cast<Inner*>(s);
+                std::move_backward(in->keys, in->keys + in->n, in->keys + in->n + 1);
+                std::move_backward(in->child, in->child + in->n + 1, in->child + in->n + 2);
+                in->keys[0]    = std::move(p->keys[c - 1]);
+                in->child[0]   = L->child[L->n];
+                p->keys[c - 1] = std::move(L->keys[L->n - 1]);
+            }
+            ++x->n;
+            --s->n;
+            return;
+        }
+        if (c < p->n && p->child[c + 1]->n > kMin) {
+            Node* s = p->child[c + 1];
+            if (x->leaf) {
+                auto* l = static_cast<Leaf*>(x);
+                auto* R = static_cast<Leaf*>(s);
+                l->keys[l->n] = std::move(R->keys[0]);
+                std::move(R->keys + 1, R->keys + R->n, R->keys);
+                p->keys[c] = R->keys[0];
+            } else {
+                auto* in = static_cast<Inner*>(x);
+                auto* R  = static_cast<Inner*>(s);
+                in->keys[in->n]      = std::move(p->keys[c]);
+                in->child[in->n + 1] = R->child[0];
+                p->keys[c] = std::move(R->keys[0]);
+                std::move(R->keys + 1, R->keys + R->n, R->keys);
+                std::copy(R->child + 1, R->child + R->n + 1, R->child);
+            }
+            ++x->n;
+            --s->n;
+            return;
+        }
+        if (c > 0) merge(p, c - 1);
+        else       merge(p, c);
+    }
+
+    /* fold child[s+1] into child[s] and drop separator s */
+    void merge(Inner* p, std::uint32_t s) {
+        Node* a = p->child[s];
+        Node* b = p->child[s + 1];
+        if (a->leaf) {
+            auto* L = static_cast<Leaf*>(a);
+            auto* R = static_cast<Leaf*>(b);
+            std::move(R->keys, R->keys + R->n, L->keys + L->n);
+            L->n += R->n;
+            L->next = R->next;
+            if (R->next) R->next->prev = L;
+            delete R;
+            --leaves_;
+        } else {
+            auto* L = static_cast<Inner*>(a);
+            auto* R = static_cast<Inner*>(b);
+            L->keys[L->n] = std::move(p->keys[s]);
+            std::move(R->keys, R->keys + R->n, L->keys + L->n + 1);
+            std::copy(R->child, R->child + R->n + 1, L->child + L->n + 1);
+            L->n += R->n + 1;
+            delete R;
+            --inners_;
+        }
+        std::move(p->keys + s + 1, p->keys + p->n, p->keys + s);
+        std::copy(p->child + s + 2, p->child + p->n + 1, p->child + s + 1);
+        --p->n;
+    }
+};
@@ -0,0 +1,60 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "inMemoryDb.h"
+
+/*
+ * BackgroundSnapshot – writes a point-in-time copy of an InMemoryDB from
+ * its own thread while the database keeps taking writes (see "Snapshots"
+ * in inMemoryDb.cpp for the copy-on-write walk underneath).
+ *
+ * The constructor calls beginSnapshot() under the lock that guards the
+ * database and returns.  From then on the thread alternates:
+ *
+ *    mu held : snapshotStep(batch) – copy at most `batch` pairs out
+ *    mu free : encode them as one WAL record and append it to the file
+ *
+ * A writer therefore waits for at most one batch copy.  File I/O never
+ * happens under the lock.
+ *
+ * The file uses the WriteAheadLog record format, so
+ * WriteAheadLog::replay(path, db) loads it into an empty database.  It is
+ * written to "<path>.tmp", fsync'ed and renamed over <path> once complete,
+ * so a crash never leaves a partial snapshot behind.
+ *
+ * db and mu must outlive the object, and db must only be used under mu
+ * until the snapshot is done.  The destructor waits for the thread.
+ */
+class BackgroundSnapshot {
+public:
+    BackgroundSnapshot(InMemoryDB& db, std::mutex& mu, std::string path,
+                       std::size_t batch = 256);
+    ~BackgroundSnapshot();
+
+    BackgroundSnapshot(const BackgroundSnapshot&)            = delete;
+    BackgroundSnapshot& operator=(const BackgroundSnapshot&) = delete;
+
+    /* until the file is in place; rethrows the thread's error (the
+       snapshot is abandoned then and <path> left untouched) */
+    void wait();
+
+    bool          done() const { return done_.load(std::memory_order_acquire); }
+    std::uint64_t keys() const { return keys_.load(std::memory_order_relaxed); }   // written so far
+
+private:
+    InMemoryDB&                db_;
+    std::mutex&                mu_;
+    std::string                path_;
+    std::size_t                batch_;
+    std::atomic<std::uint64_t> keys_{0};
+    std::atomic<bool>          done_{false};
+    std::exception_ptr         error_;
+    std::thread                thread_;
+
+    void run();
+};
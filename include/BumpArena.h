@@ -0,0 +1,71 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+/*
+ * BumpArena – stack-ordered bump allocator for byte strings.
+ *
+ * copy() appends the bytes to the current chunk and returns a view of
+ * them; a string that does not fit the rest of the chunk moves on to the
+ * next one (the tail stays unused).  mark() / release(mark) roll the
+ * arena back to an earlier point, so scopes that nest – transaction
+ * levels – free their strings in O(1) without touching them.
+ *
+ * Chunks are never freed: release() only moves the cursor back, so once
+ * the arena has grown to the working set, copy() stops allocating.  A view
+ * stays valid until the arena is released to a mark taken before it.
+ */
+class BumpArena {
+public:
+    struct Mark {
+        std::size_t chunk = 0;
+        std::size_t used  = 0;
+    };
+
+    static constexpr std::size_t kChunkBytes = 4096;
+
+    Mark mark() const { return { cur_, used_ }; }
+    void release(Mark m) { cur_ = m.chunk; used_ = m.used; }   // m must not lie ahead
+
+    std::string_view copy(std::string_view s) {
+        if (s.empty()) return {};
+        if (chunks_.empty() || used_ + s.size() > chunks_[cur_].size) {
+            if (!chunks_.empty()) ++cur_;
+            if (cur_ == chunks_.size() || chunks_[cur_].size < s.size())   // grow, keep order
+                chunks_.insert(chunks_.begin() + static_cast<std::ptrdiff_t>(cur_),
+                               Chunk{ std::make_unique<char[]>(std::max(kChunkBytes, s.size())),
+                                      std::max(kChunkBytes, s.size()) });
+            used_ = 0;
+        }
+        char* p = chunks_[cur_].bytes.get() + used_;
+        std::memcpy(p, s.data(), s.size());
+        used_ += s.size();
+        return { p, s.size() };
+    }
+
+    /* bytes below the cursor (tails skipped over included) / allocated */
+    std::size_t used() const {
+        std::size_t n = used_;
+        for (std::size_t i = 0; i < cur_ && i < chunks_.size(); ++i) n += chunks_[i].size;
+        return n;
+    }
+    std::size_t capacity() const {
+        std::size_t n = 0;
+        for (const auto& c : chunks_) n += c.size;
+        return n;
+    }
+
+private:
+    struct Chunk {
+        std::unique_ptr<char[]> bytes;
+        std::size_t             size;
+    };
+    std::vector<Chunk> chunks_;
+    std::size_t        cur_  = 0;                 // chunk being filled
+    std::size_t        used_ = 0;                 // bytes of it in use
+};
@@ -0,0 +1,148 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+#include "inMemoryDb.h"
+
+/*
+ * ChangeStream – change-data-capture feed of one InMemoryDB.
+ *
+ * Attach it as the database's CommitObserver: every committed change set
+ * (autocommit SET / DELETE, the net result of a top-level COMMIT, expiry
+ * and eviction) becomes one record with the next sequence number, 1, 2, …
+ * Rolled-back work never reaches the observer, so it never reaches the
+ * stream.  Readers subscribe() and poll() at their own pace from any
+ * thread; the writer never waits for them unless asked to (Overflow::Block).
+ *
+ * ────────────────────────────────────────────────────────────────
+ *  Ring
+ * ────────────────────────────────────────────────────────────────
+ *
+ *  A power-of-two array of atomic 64-bit words.  Positions are word
+ *  offsets that only grow; a record occupies
+ *
+ *    seq | bytes + (#changes << 32) | payload words … | seq
+ *    payload = #changes × { u8 op (0 del, 1 set), u32 klen, key,
+ *                           [u32 vlen, value] }
+ *
+ *    head_ : end of the last published record (release store)
+ *    tail_ : start of the oldest record still intact
+ *
+ *  Publishing (one writer – the database's): encode into a reused buffer,
+ *  move tail_ past the records the new one will overwrite and publish it,
+ *  release fence, store the words with relaxed stores, then head_.
+ *  Cost is the encode and one store per 8 bytes – no lock, no allocation
+ *  once the buffer has grown to the largest record.  A ring that stays in
+ *  cache (the 64 KiB default) keeps it cheapest; a bigger one gives slow
+ *  readers more slack at the price of evicting the database's own lines.
+ *
+ *  Reading is a seqlock: copy the record's words out, acquire fence,
+ *  re-read tail_.  If tail_ has passed the record's start the copy may be
+ *  torn – the reader has been lapped – so it skips to tail_ and counts
+ *  the sequence numbers it missed in lost().  The words are atomics, so a
+ *  racing copy is never undefined behaviour, only discarded.
+ *
+ * ────────────────────────────────────────────────────────────────
+ *  Overflow
+ * ────────────────────────────────────────────────────────────────
+ *
+ *  Overwrite : the writer never waits; slow readers lose the oldest
+ *              records and see a gap in the sequence numbers.
+ *  Block     : the writer waits (yielding) until every subscribed reader
+ *              has copied out what the new record would overwrite.  Back-
+ *              pressure reaches the database's writer, so a reader that
+ *              stops polling stalls it – drop the Reader to release it.
+ *
+ *  At most kMaxReaders readers at a time.  A record must fit the ring
+ *  (onCommit throws std::length_error otherwise).  The stream must
+ *  outlive its readers, and onCommit is not safe to call from two threads
+ *  at once – give each database its own stream.
+ */
+class ChangeStream : public CommitObserver {
+public:
+    enum class Overflow { Overwrite, Block };
+
+    static constexpr std::size_t kMaxReaders = 16;
+
+    class Reader {
+    public:
+        Reader(Reader&& o) noexcept;
+        Reader& operator=(Reader&& o) noexcept;
+        ~Reader();
+
+        /* f(seq, changes) for at most `max` records, oldest first; returns
+           how many.  The views are valid until the next poll(). */
+        template <class F>
+        std::size_t poll(F&& f, std::size_t max = SIZE_MAX) {
+            std::size_t n = 0;
+            for (; n < max && next(); ++n) f(seq_, std::span<const CommittedChange>(changes_));
+            return n;
+        }
+
+        std::uint64_t nextSeq() const { return nextSeq_; }   // seq the next record should have
+        std::uint64_t lost()    const { return lost_; }      // records overwritten before read
+
+    private:
+        friend class ChangeStream;
+        Reader(ChangeStream& s, std::size_t slot);
+
+        ChangeStream*                stream_;
+        std::size_t                  slot_;
+        std::uint64_t                cursor_;
+        std::uint64_t                nextSeq_;
+        std::uint64_t                seq_  = 0;
+        std::uint64_t                lost_ = 0;
+        std::vector<std::uint64_t>   words_;     // copy of the current record's payload
+        std::vector<CommittedChange> changes_;   // views into words_
+
+        bool next();
+    };
+
+    /* capacity is rounded up to a power of two of at least 64 bytes */
+    explicit ChangeStream(std::size_t capacityBytes = 1u << 16,
+                          Overflow overflow = Overflow::Overwrite);
+
+    ChangeStream(const ChangeStream&)            = delete;
+    ChangeStream& operator=(const ChangeStream&) = delete;
+
+    void onCommit(std::span<const CommittedChange> changes) override;
+
+    /* starts with the next record published; std::length_error if
+       kMaxReaders are subscribed already */
+    Reader subscribe();
+
+    std::uint64_t lastSeq()       const { return seq_; }    // writer thread only
+    std::size_t   capacityBytes() const { return ring_.size() * sizeof(std::uint64_t); }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<std::uint64_t> cursor{0};
+        std::atomic<bool>          inUse{false};
+    };
+
+    std::vector<std::atomic<std::uint64_t>> ring_;
+    std::uint64_t                           mask_;
+    Overflow                                overflow_;
+
+    alignas(64) std::atomic<std::uint64_t>  head_{0};
+    std::atomic<std::uint64_t>              tail_{0};
+    std::atomic<std::uint32_t>              readersVersion_{0};   // bumped on (un)subscribe
+
+    alignas(64) std::uint64_t               seq_  = 0;   // writer-only state from here
+    std::uint64_t                           tailW_ = 0;  // == tail_
+    std::uint64_t                           floor_ = 0;  // lowest reader cursor (Block)
+    std::uint32_t                           seenVersion_ = 0;
+    std::string                             scratch_;
+
+    std::array<Slot, kMaxReaders>           slots_;
+
+    std::uint64_t word(std::uint64_t pos) const {
+        return ring_[pos & mask_].load(std::memory_order_relaxed);
+    }
+    std::uint64_t lowestCursor(std::uint64_t head) const;
+    void          waitForRoom(std::uint64_t end);     // Block: until end − size ≤ every cursor
+};
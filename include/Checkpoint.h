@@ -0,0 +1,90 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include "MappedFile.h"
+#include "inMemoryDb.h"
+
+/*
+ * Read-only, memory-mapped image of an InMemoryDB.
+ *
+ * write() dumps the committed contents of a database – keys, values and
+ * the COUNT of every value – into one file.  open() maps that file and is
+ * ready to serve lookups as soon as the header has been checked: nothing is
+ * parsed, copied or hashed up front, so time-to-first-GET is independent
+ * of the dataset size and pages fault in on demand.
+ *
+ * An InMemoryDB constructed over an image reads through to it and promotes
+ * a key into its own mutable tables the first time the key is written.
+ *
+ * ────────────────────────────────────────────────────────────────
+ *  File layout (little-endian, every section 8-byte aligned)
+ * ────────────────────────────────────────────────────────────────
+ *
+ *    Header      : magic, version, counts, section offsets
+ *    valueDir    : valueCount × { u64 off, u32 len, u32 0, u64 count }
+ *    keyDir      : keyCount   × { u64 off, u32 len, u32 valueIdx }
+ *                  sorted by key bytes
+ *    keyIndex    : keyBuckets   × u64   open-addressing hash index
+ *    valueIndex  : valueBuckets × u64   (linear probing, load ≤ ½)
+ *    blob        : key and value bytes
+ *
+ *  An index slot is 0 when empty, else (hash >> 32) << 32 | (idx + 1):
+ *  the upper hash half filters probes before any string is compared.  The
+ *  hash is defined by this file format (not std::hash), so an image stays
+ *  readable across builds.
+ *
+ *  open() validates the header and that the section offsets match the
+ *  counts; string offsets are bounds-checked on access.  write() goes to
+ *  "<path>.tmp" and renames over <path>, so readers never see a partial
+ *  file.
+ */
+class Checkpoint {
+public:
+    /* writes db's committed state; throws if a transaction is open */
+    static void write(const std::string& path, const InMemoryDB& db);
+
+    /* maps path; throws std::runtime_error on a missing or malformed file */
+    static std::shared_ptr<const Checkpoint> open(const std::string& path);
+
+    Checkpoint(const Checkpoint&)            = delete;
+    Checkpoint& operator=(const Checkpoint&) = delete;
+
+    struct Hit {
+        std::string_view val;
+        std::uint32_t    valueIdx;
+    };
+
+    std::optional<Hit>           find     (std::string_view key) const;
+    std::optional<std::uint32_t> findValue(std::string_view val) const;
+    std::uint64_t                count    (std::uint32_t valueIdx) const;
+
+    /* sorted access (keyDir order) */
+    std::size_t      keyCount()   const;
+    std::size_t      valueCount() const;
+    std::string_view keyAt  (std::size_t i) const;
+    Hit              valueAt(std::size_t i) const;   // value of the i-th key
+    std::size_t      lowerBound(std::string_view key) const;   // first i with keyAt(i) ≥ key
+
+    bool             mapped() const { return file_.mapped(); }   // false ⇒ read into memory
+
+private:
+    struct Header;
+    struct ValueRec;
+    struct KeyRec;
+
+    MappedFile  file_;
+    const char* base_ = nullptr;                    // file_.data()
+    std::size_t size_ = 0;
+
+    explicit Checkpoint(MappedFile file)
+        : file_(std::move(file)), base_(file_.data()), size_(file_.size()) {}
+    const Header&    header() const { return *reinterpret_cast<const Header*>(base_); }
+    const ValueRec&  valueRec(std::size_t i) const;
+    const KeyRec&    keyRec  (std::size_t i) const;
+    std::string_view bytes(std::uint64_t off, std::uint32_t len) const;
+};
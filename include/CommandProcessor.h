@@ -0,0 +1,134 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "inMemoryDb.h"
+
+/*
+ * Streaming driver for the text command language used by the DB tests:
+ *
+ *    SET k v | GET k | DELETE k | COUNT v | BEGIN | ROLLBACK | COMMIT | RELEASE
+ *    INCR k | DECR k | INCRBY k n
+ *    MSET k v [k v …] | MGET k [k …] | MDEL k [k …]
+ *
+ * One command per line, tokens separated by spaces / tabs, "\r\n" accepted,
+ * blank lines and lines starting with '#' ignored.  Responses, one line
+ * each, only for commands that produce one:
+ *
+ *    GET      → value or NULL            COUNT    → decimal
+ *    INCR / DECR / INCRBY → the new value (ERR if it is not an integer)
+ *    MGET     → values / NULL, space separated on one line
+ *    ROLLBACK / COMMIT / RELEASE → NO TRANSACTION  (only when none is open)
+ *    bad input → ERR <reason>
+ *
+ * ────────────────────────────────────────────────────────────────
+ *  Hot path
+ * ────────────────────────────────────────────────────────────────
+ *
+ *  Input     : runFd() reads 1 MiB chunks into one buffer and processes
+ *              every complete line in place; only a partial last line is
+ *              moved to the front before the next read.  runFile() maps
+ *              the file and never copies at all.
+ *  Tokens    : string_views into the input, collected in a reused vector.
+ *  Dispatch  : opcodeOf() – a collision-free hash of (first two bytes,
+ *              length) into a 32-entry table, then one compare.
+ *  Output    : appended to a reused std::string; flushed to the output
+ *              fd whenever it passes 64 KiB (or left for output() when
+ *              there is no fd).
+ */
+enum class Opcode : std::uint8_t {
+    Set, Get, Delete, Count, Begin, Rollback, Commit, Release, Incr, Decr, IncrBy,
+    MSet, MGet, MDel, Unknown
+};
+
+namespace command_detail {
+
+struct OpName {
+    std::string_view name;
+    Opcode           op;
+};
+
+inline constexpr std::array<OpName, 14> kOps = { {
+    { "SET", Opcode::Set },       { "GET", Opcode::Get },         { "DELETE", Opcode::Delete },
+    { "COUNT", Opcode::Count },   { "BEGIN", Opcode::Begin },     { "ROLLBACK", Opcode::Rollback },
+    { "COMMIT", Opcode::Commit }, { "RELEASE", Opcode::Release }, { "INCR", Opcode::Incr },
+    { "DECR", Opcode::Decr },     { "INCRBY", Opcode::IncrBy },   { "MSET", Opcode::MSet },
+    { "MGET", Opcode::MGet },     { "MDEL", Opcode::MDel },
+} };
+
+constexpr std::size_t slotOf(std::string_view s) {
+    unsigned c0 = static_cast<unsigned char>(s[0]);
+    unsigned c1 = s.size() > 1 ? static_cast<unsigned char>(s[1]) : 0u;
+    return (c0 * 7 + c1 + (s.size() << 2)) & 31;
+}
+
+constexpr std::array<Opcode, 32> buildTable() {
+    std::array<Opcode, 32> t{};
+    for (auto& o : t) o = Opcode::Unknown;
+    for (const auto& e : kOps) t[slotOf(e.name)] = e.op;
+    return t;
+}
+
+inline constexpr std::array<Opcode, 32> kTable = buildTable();
+
+constexpr bool perfect() {
+    for (std::size_t i = 0; i < kOps.size(); ++i)      // kOps is indexed by Opcode
+        if (kOps[i].op != static_cast<Opcode>(i) || kTable[slotOf(kOps[i].name)] != kOps[i].op)
+            return false;
+    return true;
+}
+static_assert(perfect(), "opcode hash collides – pick new constants in slotOf()");
+
+} // namespace command_detail
+
+/* Unknown if tok is not exactly one of the command names */
+constexpr Opcode opcodeOf(std::string_view tok) {
+    if (tok.empty()) return Opcode::Unknown;
+    Opcode op = command_detail::kTable[command_detail::slotOf(tok)];
+    if (op == Opcode::Unknown) return op;
+    return command_detail::kOps[static_cast<std::size_t>(op)].name == tok ? op : Opcode::Unknown;
+}
+
+class CommandProcessor {
+public:
+    /* outFd < 0 ⇒ keep responses in output() */
+    explicit CommandProcessor(InMemoryDB& db, int outFd = -1);
+    ~CommandProcessor();                          // flushes to outFd
+
+    CommandProcessor(const CommandProcessor&)            = delete;
+    CommandProcessor& operator=(const CommandProcessor&) = delete;
+
+    /* every line of text, the last one may lack '\n'; returns #commands */
+    std::size_t execute(std::string_view text);
+
+    /* the one command in `line` (no newline) */
+    void        executeLine(std::string_view line);
+
+    std::size_t runFd  (int inFd);                // read until EOF
+    std::size_t runFile(const std::string& path); // mmap + execute
+
+    std::string_view output() const { return out_; }
+    void             clearOutput()  { out_.clear(); }
+    void             flush();
+
+    std::size_t commands() const { return commands_; }
+    std::size_t errors()   const { return errors_; }
+
+private:
+    InMemoryDB&                                                db_;
+    int                                                        outFd_;
+    std::string                                                out_;
+    std::vector<std::string_view>                              tokens_;
+    std::vector<std::optional<std::string_view>>               views_;
+    std::vector<std::pair<std::string_view, std::string_view>> pairs_;
+    std::size_t                                                commands_ = 0;
+    std::size_t                                                errors_   = 0;
+
+    void error(std::string_view why);
+    void maybeFlush() { if (outFd_ >= 0 && out_.size() >= (1u << 16)) flush(); }
+};
@@ -0,0 +1,107 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "inMemoryDb.h"
+
+/*
+ * Single-threaded, non-blocking network front end for one InMemoryDB
+ * (Linux / epoll; on other platforms the constructor throws).
+ *
+ * ────────────────────────────────────────────────────────────────
+ *  Protocol (RESP-like, pipelined)
+ * ────────────────────────────────────────────────────────────────
+ *
+ *  Request : RESP array of bulk strings   *3\r\n$3\r\nSET\r\n$1\r\na\r\n$2\r\n10\r\n
+ *            or an inline line             SET a 10\r\n
+ *            Command names are those of CommandProcessor (opcodeOf()).
+ *  Reply   : +OK              SET / DELETE / BEGIN / COMMIT / ROLLBACK /
+ *                             RELEASE / MSET
+ *            $<n>\r\n<bytes>  GET hit            $-1   GET miss
+ *            :<n>             COUNT, MDEL, INCR / DECR / INCRBY (new value)
+ *            *<n> …           MGET (bulk strings / $-1)
+ *            -NO TRANSACTION  COMMIT / ROLLBACK / RELEASE without BEGIN
+ *            -ERR <reason>    bad command; a malformed frame also closes
+ *                             the connection after the reply
+ *
+ *  A client may send any number of requests without waiting.  Every
+ *  readable connection has all of its complete requests executed and
+ *  their replies written with one send(); only a partial tail stays
+ *  buffered.
+ *
+ * ────────────────────────────────────────────────────────────────
+ *  Transactions
+ * ────────────────────────────────────────────────────────────────
+ *
+ *  InMemoryDB has one transaction stack, so the connection that issues
+ *  BEGIN becomes the owner until its depth returns to 0.  Meanwhile other
+ *  connections are parked: their input is left unread (EPOLLIN dropped)
+ *  and they resume in arrival order once the owner commits, rolls back
+ *  its outermost level or disconnects (which rolls back everything it
+ *  left open).  Clients therefore see serializable transactions without
+ *  any locking in the database itself.
+ *
+ *  While the database holds keys with a TTL the loop wakes at least every
+ *  10 ms and calls InMemoryDB::expire() (bounded work) after each batch.
+ */
+struct ServerOptions {
+    std::string   host     = "127.0.0.1";
+    std::uint16_t port     = 0;            // 0 ⇒ ephemeral, see DbServer::port()
+    std::string   unixPath;                // non-empty ⇒ AF_UNIX instead of TCP
+    int           backlog  = 4096;
+};
+
+class DbServer {
+public:
+    DbServer(InMemoryDB& db, ServerOptions opts = {});
+    ~DbServer();
+
+    DbServer(const DbServer&)            = delete;
+    DbServer& operator=(const DbServer&) = delete;
+
+    std::uint16_t port() const { return port_; }
+
+    void run();              // event loop; returns after stop()
+    void stop();             // thread-safe, async-signal-safe
+
+    std::size_t connections() const { return open_.load(std::memory_order_relaxed); }
+    std::size_t commands()    const { return commands_.load(std::memory_order_relaxed); }
+
+private:
+    struct Conn;
+
+    InMemoryDB&                        db_;
+    ServerOptions                      opts_;
+    int                                listenFd_ = -1;
+    int                                epollFd_  = -1;
+    int                                wakeFd_   = -1;     // eventfd for stop()
+    std::uint16_t                      port_     = 0;
+
+    std::vector<std::unique_ptr<Conn>> conns_;             // indexed by fd
+    std::atomic<std::size_t>           open_{0};
+    Conn*                              owner_ = nullptr;   // has an open txn
+    std::deque<int>                    parked_;            // fds waiting for owner_
+    std::atomic<std::size_t>           commands_{0};
+
+    std::vector<std::string_view>                              args_;
+    std::vector<std::optional<std::string_view>>               views_;
+    std::unique_ptr<char[]>                                    scratch_;   // read buffer
+    std::vector<std::pair<std::string_view, std::string_view>> pairs_;
+
+    void accept();
+    void onReadable(Conn& c);
+    void process(Conn& c);                 // run buffered requests
+    void execute(Conn& c);                 // args_ → reply
+    void flush(Conn& c);
+    void settle(Conn& c);                  // close once finished and drained
+    void close(Conn& c);
+    void watch(Conn& c);                   // refresh epoll interest
+    void resumeParked();
+};
@@ -0,0 +1,179 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/*
+ * Operation counters and latency histograms of one InMemoryDB.
+ *
+ * Build with -DINMEMORYDB_STATS=0 (CMake option INMEMORYDB_STATS=OFF) and
+ * InMemoryDB keeps no counters, takes no timestamps and has no recorder
+ * member: stats() then reports the gauges only and every OpStats is zero.
+ *
+ * ────────────────────────────────────────────────────────────────
+ *  Cost when enabled
+ * ────────────────────────────────────────────────────────────────
+ *
+ *  Every call bumps its op's counter (relaxed load + store, as for the
+ *  cache hit counters – const calls may run side by side).
+ *  Only one call in kSampleEvery is timed: two steady_clock reads cost
+ *  more than a cached GET, so timing all of them would not stay within a
+ *  few percent.  The histograms therefore hold samples, not every call.
+ *
+ *  INCR counts as a SET.  Batch commands (MGET / MSET / MDEL) count one
+ *  GET / SET / DELETE call per key and are not timed; so are
+ *  ShardedInMemoryDB's lock-free GET and COUNT, which never reach a
+ *  shard's InMemoryDB.
+ *
+ * ────────────────────────────────────────────────────────────────
+ *  LatencyHistogram
+ * ────────────────────────────────────────────────────────────────
+ *
+ *  Log-linear buckets in ns, HDR style: values below 16 get one bucket
+ *  each, every power of two above is split into 16 equal sub-buckets, so
+ *  a percentile is at most 1/16 above the true value.  Values past
+ *  2^36 ns (~69 s) land in the last bucket.
+ */
+#ifndef INMEMORYDB_STATS
+#  define INMEMORYDB_STATS 1
+#endif
+
+/* operations with their own counter and histogram */
+enum class DbOp : std::uint8_t { Set, Get, Del, Count, Begin, Rollback, Commit, Release };
+
+inline constexpr std::size_t kDbOps = 8;
+inline constexpr std::array<std::string_view, kDbOps> kDbOpNames = {
+    "set", "get", "del", "count", "begin", "rollback", "commit", "release"
+};
+
+class LatencyHistogram {
+public:
+    static constexpr unsigned    kSubBits = 4;
+    static constexpr unsigned    kMaxExp  = 36;     // last bucket starts below 2^kMaxExp
+    static constexpr std::size_t kBuckets = (kMaxExp - kSubBits + 1) << kSubBits;
+
+    static std::size_t bucketOf(std::uint64_t ns) {
+        if (ns < (1u << kSubBits)) return static_cast<std::size_t>(ns);
+        const unsigned e = std::min<unsigned>(std::bit_width(ns) - 1, kMaxExp - 1);
+        const std::uint64_t sub = std::min<std::uint64_t>(ns >> (e - kSubBits), (2u << kSubBits) - 1);
+        return ((e - kSubBits + 1) << kSubBits) + static_cast<std::size_t>(sub - (1u << kSubBits));
+    }
+    /* largest value that falls into bucket b */
+    static std::uint64_t bucketTop(std::size_t b) {
+        if (b < (1u << kSubBits)) return b;
+        const unsigned e   = static_cast<unsigned>(b >> kSubBits) + kSubBits - 1;
+        const std::uint64_t sub = (b & ((1u << kSubBits) - 1)) + (1u << kSubBits);
+        return ((sub + 1) << (e - kSubBits)) - 1;
+    }
+
+    /* relaxed load + store per field: concurrent recorders may lose a sample */
+    void record(std::uint64_t ns) {
+        bump(counts_[bucketOf(ns)], 1);
+        bump(count_, 1);
+        bump(sum_, ns);
+        std::atomic_ref<std::uint64_t> m(max_);
+        if (ns > m.load(std::memory_order_relaxed)) m.store(ns, std::memory_order_relaxed);
+    }
+    void merge(const LatencyHistogram& o);
+
+    std::uint64_t count() const { return load(count_); }
+    std::uint64_t max()   const { return load(max_); }
+    double        mean()  const {
+        const std::uint64_t n = count();
+        return n ? double(load(sum_)) / double(n) : 0.0;
+    }
+    /* upper end of the bucket holding the p-quantile, p in [0, 1]; 0 if empty */
+    std::uint64_t percentile(double p) const;
+
+private:
+    std::array<std::uint64_t, kBuckets> counts_{};
+    std::uint64_t count_ = 0, sum_ = 0, max_ = 0;
+
+    static void bump(std::uint64_t& c, std::uint64_t n) {
+        std::atomic_ref<std::uint64_t> r(c);
+        r.store(r.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+    static std::uint64_t load(const std::uint64_t& c) {
+        return std::atomic_ref<std::uint64_t>(const_cast<std::uint64_t&>(c)).load(std::memory_order_relaxed);
+    }
+};
+
+struct OpStats {
+    std::uint64_t    calls = 0;
+    LatencyHistogram latency;                   // sampled calls only
+};
+
+/* snapshot returned by InMemoryDB::stats() */
+struct DbStats {
+    static constexpr bool     enabled      = INMEMORYDB_STATS;
+    static constexpr unsigned kSampleEvery = 64;   // one call in 64 is timed
+
+    std::array<OpStats, kDbOps> ops{};
+    /* gauges at the time of the call */
+    std::size_t keys      = 0;                  // entries in db_ (image keys not promoted excluded)
+    std::size_t slots     = 0;                  // db_ capacity, both tables while resizing
+    std::size_t txnDepth  = 0;                  // open BEGIN levels
+    std::size_t undoBytes = 0;                  // undo logs / overlay layers, incl. key heap
+    std::size_t memoryBytes = 0;                // memoryUsage()
+
+    const OpStats& operator[](DbOp op) const { return ops[static_cast<std::size_t>(op)]; }
+    void merge(const DbStats& o);               // sums counters, histograms and gauges
+
+    /* one line per operation, then one per gauge:
+         set      calls=… sampled=… mean=…ns p50=…ns p99=…ns p999=…ns max=…ns
+         keys=… */
+    std::string text() const;
+};
+
+#if INMEMORYDB_STATS
+/* per-database recorder; enter() returns a scope that times the call when
+   it is a sampled one */
+class OpRecorder {
+public:
+    class Scope {
+        LatencyHistogram*                     hist_ = nullptr;   // null ⇒ not sampled
+        std::chrono::steady_clock::time_point t0_;
+    public:
+        explicit Scope(LatencyHistogram* h) : hist_(h) {
+            if (hist_) t0_ = std::chrono::steady_clock::now();
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+        ~Scope() {
+            if (!hist_) return;
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - t0_).count();
+            hist_->record(static_cast<std::uint64_t>(ns));
+        }
+    };
+
+    Scope enter(DbOp op) const {
+        OpStats& s = ops_[static_cast<std::size_t>(op)];
+        std::atomic_ref<std::uint64_t> r(s.calls);
+        const std::uint64_t n = r.load(std::memory_order_relaxed);
+        r.store(n + 1, std::memory_order_relaxed);
+        return Scope(n % DbStats::kSampleEvery == 0 ? &s.latency : nullptr);
+    }
+    void add(DbOp op, std::uint64_t calls) const {      // untimed (batch commands)
+        std::atomic_ref<std::uint64_t> r(ops_[static_cast<std::size_t>(op)].calls);
+        r.store(r.load(std::memory_order_relaxed) + calls, std::memory_order_relaxed);
+    }
+    void copyTo(DbStats& st) const;
+    void reset() { ops_ = {}; }
+
+private:
+    mutable std::array<OpStats, kDbOps> ops_{};
+};
+
+#  define INMEMORYDB_OP(op)        const auto dbOpScope_ = opStats_.enter(op)
+#  define INMEMORYDB_OP_ADD(op, n) opStats_.add(op, n)
+#else
+#  define INMEMORYDB_OP(op)        ((void)0)
+#  define INMEMORYDB_OP_ADD(op, n) ((void)0)
+#endif
@@ -0,0 +1,116 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * EpochDomain – epoch-based reclamation for structures that readers walk
+ * without locks while a writer unlinks and replaces parts of them.
+ *
+ * ────────────────────────────────────────────────────────────────
+ *  Protocol
+ * ────────────────────────────────────────────────────────────────
+ *
+ *  global_      : the current epoch, ≥ 1
+ *  Reader       : one per (thread, domain), on its own cache line;
+ *                 epoch = 0 while outside a Guard, else the epoch it pinned
+ *
+ *  Guard (reader) : exchange(epoch, global_); … read …; epoch = 0
+ *                   – only the thread's own line is written, no lock
+ *  retire (writer): after unlinking p, tag it with global_ and keep it
+ *  collect        : advance global_ if every pinned reader has seen it,
+ *                   then free what was retired two epochs ago
+ *
+ *  A reader pinned at e may hold pointers unlinked in e − 1 or later; once
+ *  global_ reaches e + 2 every reader has unpinned since or pinned after
+ *  the unlink, so nothing retired at ≤ global_ − 2 is reachable.  The
+ *  seq_cst exchange in Guard pairs with the fence in retire/advance: a
+ *  reader either shows up pinned to the scan or sees the unlink.  The
+ *  scan's acquire loads of each record also order the reader's last
+ *  accesses before the free, which is what lets TSan follow it.
+ *
+ *  Guards do not nest.  A reader blocks reclamation only while pinned.
+ *
+ *  Reader records are registered once per thread (the only CAS a reader
+ *  ever does) and handed back when the thread exits, to be reused by the
+ *  next thread.  Each carries a few owner-written counters (`counters`)
+ *  so the domain's user can keep read statistics without shared writes.
+ */
+class EpochDomain {
+public:
+    struct alignas(64) Reader {
+        std::atomic<std::uint64_t>                epoch{0};   // 0 ⇒ not pinned
+        std::atomic<bool>                         inUse{false};
+        std::array<std::atomic<std::uint64_t>, 4> counters{};  // written by the owner only
+        Reader*                                   next = nullptr;   // immutable once linked
+
+        void bump(std::size_t i, std::uint64_t n = 1) {
+            counters[i].store(counters[i].load(std::memory_order_relaxed) + n,
+                              std::memory_order_relaxed);
+        }
+    };
+
+    class Guard {
+        Reader* r_;
+    public:
+        explicit Guard(EpochDomain& d) : r_(&d.reader()) {
+            r_->epoch.exchange(d.global_.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+        }
+        ~Guard() { r_->epoch.store(0, std::memory_order_release); }
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+        Reader& reader() const { return *r_; }
+    };
+
+    EpochDomain();
+    ~EpochDomain();                                  // no Guard may be alive
+    EpochDomain(const EpochDomain&) = delete;
+    EpochDomain& operator=(const EpochDomain&) = delete;
+
+    Reader&       reader();                          // this thread's record
+    std::uint64_t epoch() const { return global_.load(std::memory_order_seq_cst); }
+    bool          tryAdvance();                      // true ⇒ global_ moved on
+
+    /* Σ counters[i] over every reader record, live or handed back */
+    std::uint64_t sum(std::size_t i) const;
+
+private:
+    friend class RetireList;
+    std::atomic<std::uint64_t> global_{1};
+    std::atomic<Reader*>       head_{nullptr};
+    std::uint64_t              id_;                  // never reused, unlike addresses
+
+    Reader* acquire();
+};
+
+/* Objects one writer (or writers serialised by one lock) has unlinked. */
+class RetireList {
+public:
+    using Deleter = void (*)(void*);
+
+    RetireList() = default;
+    ~RetireList();                                   // frees everything: readers must be gone
+    RetireList(const RetireList&) = delete;
+    RetireList& operator=(const RetireList&) = delete;
+
+    /* p is unreachable for new readers; free it once old ones are done */
+    void retire(EpochDomain& d, void* p, Deleter del);
+    /* try to advance the epoch and free what is safe; retire() calls this
+       every kCollectEvery objects */
+    void collect(EpochDomain& d);
+
+    std::size_t pending() const { return items_.size(); }
+
+    static constexpr std::size_t kCollectEvery = 64;
+
+private:
+    struct Item {
+        std::uint64_t epoch;
+        void*         p;
+        Deleter       del;
+    };
+    std::vector<Item> items_;                        // ascending epoch
+    std::size_t       sinceCollect_ = 0;
+};
@@ -0,0 +1,551 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#ifdef __linux__
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+#  define FLAT_HASH_MAP_SSE2 1
+#endif
+
+/*
+ * FlatHashMap – open-addressing hash table with SIMD-probed control bytes
+ * (the “Swiss table” layout).
+ *
+ * ────────────────────────────────────────────────────────────────
+ *  Layout
+ * ────────────────────────────────────────────────────────────────
+ *
+ *  ctrl_   : one metadata byte per slot
+ *              0x00          empty
+ *              0x01          deleted (tombstone)
+ *              0x80 | h2     full; h2 = low 7 bits of the hash
+ *  slots_  : std::pair<K,V>[capacity_], constructed only where ctrl is full
+ *
+ *  The table is split into aligned groups of 16 slots.  A lookup hashes
+ *  once, picks a start group from the high bits (h1) and compares all 16
+ *  control bytes against h2 with one SSE2 compare.  Only slots whose h2
+ *  matches are touched, so the common case is one cache line of metadata
+ *  plus one slot.  Groups are visited in triangular order
+ *  (g, g+1, g+3, g+6, …) which covers every group of a power-of-two table.
+ *  A probe stops at the first group that still contains an empty byte.
+ *
+ *  Erase writes “empty” back when the slot's group already has an empty
+ *  byte (no probe can have passed through it), otherwise a tombstone.
+ *  Tombstones count against the 7/8 load factor; when they pile up (live
+ *  keys ≤ 25/32 of the slots) the table is rebuilt in place instead of
+ *  doubling: no allocation, so erase/insert churn at a steady size never
+ *  touches the heap.
+ *
+ *  Empty is encoded as 0x00 so a fresh control array is just calloc'd.
+ *
+ *  Iterators and references are invalidated by any insertion that grows
+ *  or rebuilds the table (same contract as std::unordered_map::rehash).
+ *  Keys must not be modified through iterators.
+ */
+
+namespace flat_detail {
+
+inline constexpr std::uint8_t kEmpty     = 0x00;
+inline constexpr std::uint8_t kDeleted   = 0x01;
+inline constexpr std::uint8_t kFullBit   = 0x80;
+inline constexpr std::size_t  kGroupSize = 16;
+
+/* bit i set ⇔ slot i of the group matched */
+class BitMask {
+    std::uint32_t bits_;
+public:
+    explicit BitMask(std::uint32_t b) : bits_(b) {}
+    explicit operator bool() const { return bits_ != 0; }
+    unsigned lowest() const { return static_cast<unsigned>(std::countr_zero(bits_)); }
+    void     next()         { bits_ &= bits_ - 1; }
+};
+
+class Group {
+#ifdef FLAT_HASH_MAP_SSE2
+    __m128i ctrl_;
+public:
+    explicit Group(const std::uint8_t* p)
+        : ctrl_(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) {}
+
+    BitMask match(std::uint8_t h) const {
+        __m128i m = _mm_cmpeq_epi8(ctrl_, _mm_set1_epi8(static_cast<char>(h)));
+        return BitMask(static_cast<std::uint32_t>(_mm_movemask_epi8(m)));
+    }
+    BitMask matchEmpty() const { return match(kEmpty); }
+    /* empty or deleted: high bit clear */
+    BitMask matchNonFull() const {
+        return BitMask(~static_cast<std::uint32_t>(_mm_movemask_epi8(ctrl_)) & 0xFFFFu);
+    }
+#else
+    const std::uint8_t* ctrl_;
+public:
+    explicit Group(const std::uint8_t* p) : ctrl_(p) {}
+
+    BitMask match(std::uint8_t h) const {
+        std::uint32_t m = 0;
+        for (std::size_t i = 0; i < kGroupSize; ++i)
+            if (ctrl_[i] == h) m |= 1u << i;
+        return BitMask(m);
+    }
+    BitMask matchEmpty() const { return match(kEmpty); }
+    BitMask matchNonFull() const {
+        std::uint32_t m = 0;
+        for (std::size_t i = 0; i < kGroupSize; ++i)
+            if (!(ctrl_[i] & kFullBit)) m |= 1u << i;
+        return BitMask(m);
+    }
+#endif
+};
+
+/* cache hint only; never faults */
+inline void prefetch(const void* p) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(p);
+#elif defined(FLAT_HASH_MAP_SSE2)
+    _mm_prefetch(static_cast<const char*>(p), _MM_HINT_T0);
+#else
+    (void)p;
+#endif
+}
+
+/* final avalanche so weak hashes (e.g. identity std::hash<int>) still
+   spread over both h1 and h2 */
+inline std::uint64_t mix(std::uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+} // namespace flat_detail
+
+template <class K, class V,
+          class Hash  = std::hash<K>,
+          class Equal = std::equal_to<K>>
+class FlatHashMap {
+public:
+    using key_type    = K;
+    using mapped_type = V;
+    using value_type  = std::pair<K, V>;
+    using size_type   = std::size_t;
+
+    static constexpr bool kTransparent =
+        requires { typename Hash::is_transparent; typename Equal::is_transparent; };
+
+private:
+    template <bool Const>
+    class Iter {
+        friend class FlatHashMap;
+        template <bool> friend class Iter;
+        using Map = std::conditional_t<Const, const FlatHashMap, FlatHashMap>;
+        Map*        map_ = nullptr;
+        std::size_t idx_ = 0;
+
+        Iter(Map* m, std::size_t i) : map_(m), idx_(i) { skip(); }
+        void skip() {
+            while (idx_ < map_->capacity_ && !(map_->ctrl_[idx_] & flat_detail::kFullBit)) ++idx_;
+        }
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = FlatHashMap::value_type;
+        using difference_type   = std::ptrdiff_t;
+        using reference         = std::conditional_t<Const, const value_type&, value_type&>;
+        using pointer           = std::conditional_t<Const, const value_type*, value_type*>;
+
+        Iter() = default;
+        /* iterator → const_iterator */
+        template <bool C = Const, class = std::enable_if_t<C>>
+        Iter(const Iter<false>& o) : map_(o.map_), idx_(o.idx_) {}
+
+        reference operator*()  const { return map_->slots_[idx_]; }
+        pointer   operator->() const { return &map_->slots_[idx_]; }
+        Iter& operator++()    { ++idx_; skip(); return *this; }
+        Iter  operator++(int) { Iter t = *this; ++*this; return t; }
+        bool operator==(const Iter& o) const { return idx_ == o.idx_; }
+
+        std::size_t slotIndex() const { return idx_; }
+    };
+
+public:
+    using iterator       = Iter<false>;
+    using const_iterator = Iter<true>;
+
+    FlatHashMap() = default;
+    explicit FlatHashMap(size_type n) { reserve(n); }
+    ~FlatHashMap() { destroyAll(); release(); }
+
+    FlatHashMap(const FlatHashMap& o) : hash_(o.hash_), eq_(o.eq_) {
+        reserve(o.size_);
+        for (const auto& kv : o) emplaceNew(kv.first, kv.second);
+    }
+    FlatHashMap& operator=(const FlatHashMap& o) {
+        if (this != &o) { FlatHashMap tmp(o); swap(tmp); }
+        return *this;
+    }
+    FlatHashMap(FlatHashMap&& o) noexcept { swap(o); }
+    FlatHashMap& operator=(FlatHashMap&& o) noexcept {
+        if (this != &o) { FlatHashMap tmp(std::move(o)); swap(tmp); }
+        return *this;
+    }
+
+    void swap(FlatHashMap& o) noexcept {
+        std::swap(ctrl_, o.ctrl_);
+        std::swap(slots_, o.slots_);
+        std::swap(capacity_, o.capacity_);
+        std::swap(size_, o.size_);
+        std::swap(growthLeft_, o.growthLeft_);
+        std::swap(hash_, o.hash_);
+        std::swap(eq_, o.eq_);
+    }
+
+    /* ─────────── capacity ─────────── */
+    size_type size()     const { return size_; }
+    bool      empty()    const { return size_ == 0; }
+    size_type capacity() const { return capacity_; }
+
+    /* bytes owned by the table itself (control bytes + slot array) */
+    size_type memoryBytes() const { return capacity_ * (1 + sizeof(value_type)); }
+
+    /* true ⇒ inserting a new key may double the capacity (erasing first
+       either frees room or lets the table rebuild in place) */
+    bool growsOnInsert() const { return capacity_ == 0 || (growthLeft_ == 0 && mustDouble()); }
+
+    /* inserts of new keys left before the next rehash, and the capacity
+       that rehash will pick (see IncrementalHashMap) */
+    size_type growthLeft()   const { return growthLeft_; }
+    size_type nextCapacity() const {
+        return capacity_ == 0 ? flat_detail::kGroupSize : mustDouble() ? 2 * capacity_ : capacity_;
+    }
+
+    void reserve(size_type n) {
+        size_type want = capacityFor(n);
+        if (want > capacity_) rehash(want);
+    }
+
+    void clear() {
+        destroyAll();
+        if (capacity_) std::fill(ctrl_, ctrl_ + capacity_, flat_detail::kEmpty);
+        size_       = 0;
+        growthLeft_ = maxLoad(capacity_);
+    }
+
+    /* Rebuild at the same capacity without a second array, turning every
+       tombstone back into an empty slot.  Inserts call it themselves once
+       tombstones have used up the load factor; a caller that has just
+       erased in bulk may call it early.  Live slots are marked “to place”
+       (kDeleted) and each moves to the first non-full slot of its probe
+       sequence – or stays if that lies in its own group.  A target still
+       holding a slot to place is swapped with, and the swapped-in slot
+       handled next. */
+    void dropDeletes() {
+        for (std::size_t i = 0; i < capacity_; ++i)
+            ctrl_[i] = ctrl_[i] & flat_detail::kFullBit ? flat_detail::kDeleted : flat_detail::kEmpty;
+        for (std::size_t i = 0; i < capacity_; ++i) {
+            if (ctrl_[i] != flat_detail::kDeleted) continue;
+            const std::uint64_t h = hashOf(slots_[i].first);
+            const std::size_t   j = findNonFull(h);
+            if (j / flat_detail::kGroupSize == i / flat_detail::kGroupSize) {
+                ctrl_[i] = h2(h);
+            } else if (ctrl_[j] == flat_detail::kEmpty) {
+                ::new (static_cast<void*>(slots_ + j)) value_type(std::move(slots_[i]));
+                std::destroy_at(slots_ + i);
+                ctrl_[j] = h2(h);
+                ctrl_[i] = flat_detail::kEmpty;
+            } else {                                // j waits to be placed itself
+                using std::swap;
+                swap(slots_[i], slots_[j]);
+                ctrl_[j] = h2(h);
+                --i;                                // place what came in next
+            }
+        }
+        growthLeft_ = maxLoad(capacity_) - size_;
+    }
+
+    /* ─────────── iteration ─────────── */
+    iterator       begin()       { return iterator(this, 0); }
+    iterator       end()         { return iterator(this, capacity_); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end()   const { return const_iterator(this, capacity_); }
+    /* first element in slot order at or after slot i (a resumable cursor) */
+    iterator       fromSlot(size_type i)       { return iterator(this, i < capacity_ ? i : capacity_); }
+
+    /* ─────────── lookup ───────────
+       The Q-templated overloads are heterogeneous lookups: they exist only
+       when both Hash and Equal declare is_transparent, and let callers
+       probe with e.g. std::string_view without building a K first. */
+    iterator find(const K& key) {
+        return iterator(this, findIndex(key, hashOf(key)));
+    }
+    const_iterator find(const K& key) const {
+        return const_iterator(this, findIndex(key, hashOf(key)));
+    }
+    template <class Q> requires kTransparent
+    iterator find(const Q& key) {
+        return iterator(this, findIndex(key, hashOf(key)));
+    }
+    template <class Q> requires kTransparent
+    const_iterator find(const Q& key) const {
+        return const_iterator(this, findIndex(key, hashOf(key)));
+    }
+    bool contains(const K& key) const { return find(key) != end(); }
+    template <class Q> requires kTransparent
+    bool contains(const Q& key) const { return find(key) != end(); }
+
+    /* ─────────── batched lookup ───────────
+       hashKey() exposes the table's hash so a caller can hash a batch of
+       keys up front, prefetch() each key's first control group, a few keys
+       later prefetchSlot() the slot its tag points at, and finally find()
+       with the precomputed hash.  The misses of neighbouring keys then
+       overlap instead of forming one dependency chain per key. */
+    template <class Q> requires (kTransparent || std::is_same_v<Q, K>)
+    std::uint64_t hashKey(const Q& key) const { return hashOf(key); }
+
+    void prefetch(std::uint64_t h) const {
+        if (capacity_) flat_detail::prefetch(ctrl_ + firstGroup(h));
+    }
+    /* reads the control group (ideally already prefetched) */
+    void prefetchSlot(std::uint64_t h) const {
+        if (!capacity_) return;
+        const std::size_t base = firstGroup(h);
+        if (auto m = flat_detail::Group(ctrl_ + base).match(h2(h)))
+            flat_detail::prefetch(slots_ + base + m.lowest());
+    }
+
+    iterator find(const K& key, std::uint64_t h) {
+        return iterator(this, findIndex(key, h));
+    }
+    const_iterator find(const K& key, std::uint64_t h) const {
+        return const_iterator(this, findIndex(key, h));
+    }
+    template <class Q> requires kTransparent
+    iterator find(const Q& key, std::uint64_t h) {
+        return iterator(this, findIndex(key, h));
+    }
+    template <class Q> requires kTransparent
+    const_iterator find(const Q& key, std::uint64_t h) const {
+        return const_iterator(this, findIndex(key, h));
+    }
+
+    /* ─────────── modifiers ─────────── */
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(const K& key, Args&&... args) {
+        return emplaceKey(key, std::forward<Args>(args)...);
+    }
+    /* K is built from Q only when the key is actually inserted */
+    template <class Q, class... Args> requires kTransparent
+    std::pair<iterator, bool> try_emplace(const Q& key, Args&&... args) {
+        return emplaceKey(key, std::forward<Args>(args)...);
+    }
+
+    V& operator[](const K& key) { return try_emplace(key).first->second; }
+
+    /* insert a key the caller knows is absent – no lookup (moving entries
+       between tables) */
+    template <class A, class B>
+    void emplaceUnique(A&& key, B&& val) { emplaceNew(std::forward<A>(key), std::forward<B>(val)); }
+
+    void erase(const_iterator it) { eraseAt(it.idx_); }
+    void erase(iterator it)       { eraseAt(it.idx_); }
+
+    /* give the pages wholly inside slots [first, last) back to the OS; none
+       of them may be full.  Lets a table being drained shed its memory as
+       it goes, so the final free does not unmap it all at once.  Linux only;
+       elsewhere a no-op. */
+    void discardSlots(size_type first, size_type last) {
+#ifdef __linux__
+        static const std::uintptr_t page = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+        if (last > capacity_ || first >= last) return;
+        std::uintptr_t lo = (reinterpret_cast<std::uintptr_t>(slots_ + first) + page - 1) & ~(page - 1);
+        std::uintptr_t hi = reinterpret_cast<std::uintptr_t>(slots_ + last) & ~(page - 1);
+        if (hi > lo) ::madvise(reinterpret_cast<void*>(lo), hi - lo, MADV_DONTNEED);
+#else
+        (void)first; (void)last;
+#endif
+    }
+
+    size_type erase(const K& key) { return eraseKey(key); }
+    template <class Q> requires kTransparent
+    size_type erase(const Q& key) { return eraseKey(key); }
+
+private:
+    std::uint8_t* ctrl_       = nullptr;
+    value_type*   slots_      = nullptr;
+    std::size_t   capacity_   = 0;      // power of two, multiple of 16 (or 0)
+    std::size_t   size_       = 0;
+    std::size_t   growthLeft_ = 0;      // empty slots we may still fill
+    [[no_unique_address]] Hash  hash_{};
+    [[no_unique_address]] Equal eq_{};
+
+    static std::size_t maxLoad(std::size_t cap) { return cap - cap / 8; }
+    bool mustDouble() const { return size_ * 32 > capacity_ * 25; }
+
+    template <class Q, class... Args>
+    std::pair<iterator, bool> emplaceKey(const Q& key, Args&&... args) {
+        std::uint64_t h = hashOf(key);
+        std::size_t i = findIndex(key, h);
+        if (i != capacity_) return { iterator(this, i), false };
+        i = prepareInsert(h);
+        ::new (static_cast<void*>(slots_ + i))
+            value_type(std::piecewise_construct,
+                       std::forward_as_tuple(key),
+                       std::forward_as_tuple(std::forward<Args>(args)...));
+        return { iterator(this, i), true };
+    }
+
+    template <class Q>
+    size_type eraseKey(const Q& key) {
+        std::size_t i = findIndex(key, hashOf(key));
+        if (i == capacity_) return 0;
+        eraseAt(i);
+        return 1;
+    }
+
+    static std::size_t capacityFor(std::size_t n) {
+        if (n == 0) return 0;
+        std::size_t need = n + n / 7 + 1;
+        return std::bit_ceil(need < flat_detail::kGroupSize ? flat_detail::kGroupSize : need);
+    }
+
+    template <class Q>
+    std::uint64_t hashOf(const Q& key) const {
+        return flat_detail::mix(static_cast<std::uint64_t>(hash_(key)));
+    }
+    static std::uint8_t h2(std::uint64_t h) {
+        return static_cast<std::uint8_t>(flat_detail::kFullBit | (h & 0x7F));
+    }
+    std::size_t groupMask() const { return capacity_ / flat_detail::kGroupSize - 1; }
+    std::size_t firstGroup(std::uint64_t h) const {
+        return (static_cast<std::size_t>(h >> 7) & groupMask()) * flat_detail::kGroupSize;
+    }
+
+    template <class Q>
+    std::size_t findIndex(const Q& key, std::uint64_t h) const {
+        if (capacity_ == 0) return 0;
+        const std::uint8_t tag  = h2(h);
+        const std::size_t  mask = groupMask();
+        std::size_t g = static_cast<std::size_t>(h >> 7) & mask;
+        for (std::size_t step = 1;; ++step) {
+            const std::size_t base = g * flat_detail::kGroupSize;
+            flat_detail::Group grp(ctrl_ + base);
+            for (auto m = grp.match(tag); m; m.next()) {
+                std::size_t i = base + m.lowest();
+                if (eq_(slots_[i].first, key)) return i;
+            }
+            if (grp.matchEmpty()) return capacity_;
+            g = (g + step) & mask;
+        }
+    }
+
+    /* first empty-or-deleted slot on h's probe path (key known absent) */
+    std::size_t findNonFull(std::uint64_t h) const {
+        const std::size_t mask = groupMask();
+        std::size_t g = static_cast<std::size_t>(h >> 7) & mask;
+        for (std::size_t step = 1;; ++step) {
+            const std::size_t base = g * flat_detail::kGroupSize;
+            auto m = flat_detail::Group(ctrl_ + base).matchNonFull();
+            if (m) return base + m.lowest();
+            g = (g + step) & mask;
+        }
+    }
+
+    /* claim a slot for a key known to be absent; may grow the table */
+    std::size_t prepareInsert(std::uint64_t h) {
+        std::size_t i = capacity_ ? findNonFull(h) : 0;
+        if (capacity_ == 0 || (growthLeft_ == 0 && ctrl_[i] == flat_detail::kEmpty)) {
+            /* enough tombstones → rebuild in place, otherwise double */
+            if (capacity_ == 0)                         rehash(flat_detail::kGroupSize);
+            else if (!mustDouble())                     dropDeletes();
+            else                                        rehash(capacity_ * 2);
+            i = findNonFull(h);
+        }
+        if (ctrl_[i] == flat_detail::kEmpty) --growthLeft_;
+        ctrl_[i] = h2(h);
+        ++size_;
+        return i;
+    }
+
+    void eraseAt(std::size_t i) {
+        std::destroy_at(slots_ + i);
+        const std::size_t base = i & ~(flat_detail::kGroupSize - 1);
+        if (flat_detail::Group(ctrl_ + base).matchEmpty()) {
+            ctrl_[i] = flat_detail::kEmpty;
+            ++growthLeft_;
+        } else {
+            ctrl_[i] = flat_detail::kDeleted;
+        }
+        --size_;
+    }
+
+    template <class A, class B>
+    void emplaceNew(A&& k, B&& v) {
+        std::size_t i = prepareInsert(hashOf(k));
+        ::new (static_cast<void*>(slots_ + i)) value_type(std::forward<A>(k), std::forward<B>(v));
+    }
+
+    void rehash(std::size_t newCap) {
+        std::uint8_t* oldCtrl  = ctrl_;
+        value_type*   oldSlots = slots_;
+        std::size_t   oldCap   = capacity_;
+
+        ctrl_       = static_cast<std::uint8_t*>(std::calloc(newCap, 1));
+        if (!ctrl_) throw std::bad_alloc();
+        slots_      = std::allocator<value_type>().allocate(newCap);
+        capacity_   = newCap;
+        growthLeft_ = maxLoad(newCap) - size_;
+
+        for (std::size_t i = 0; i < oldCap; ++i) {
+            if (!(oldCtrl[i] & flat_detail::kFullBit)) continue;
+            std::uint64_t h = hashOf(oldSlots[i].first);
+            std::size_t   j = findNonFull(h);
+            ctrl_[j] = h2(h);
+            ::new (static_cast<void*>(slots_ + j)) value_type(std::move(oldSlots[i]));
+            std::destroy_at(oldSlots + i);
+        }
+        std::free(oldCtrl);
+        if (oldSlots) std::allocator<value_type>().deallocate(oldSlots, oldCap);
+    }
+
+    void destroyAll() {
+        if constexpr (!std::is_trivially_destructible_v<value_type>) {
+            if (size_ == 0) return;                 // drained table: skip the ctrl walk
+            for (std::size_t i = 0; i < capacity_; ++i)
+                if (ctrl_[i] & flat_detail::kFullBit) std::destroy_at(slots_ + i);
+        }
+    }
+
+    void release() {
+        std::free(ctrl_);
+        if (slots_) std::allocator<value_type>().deallocate(slots_, capacity_);
+        ctrl_ = nullptr; slots_ = nullptr; capacity_ = 0; size_ = 0; growthLeft_ = 0;
+    }
+};
+
+/* Transparent hasher so string-keyed maps accept std::string_view /
+   const char* lookups without allocating a temporary std::string. */
+struct StringHash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view s) const noexcept {
+        return std::hash<std::string_view>{}(s);
+    }
+};
+
+template <class V>
+using FlatStringMap = FlatHashMap<std::string, V, StringHash, std::equal_to<>>;
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include "FlatHashMap.h"
+
+/*
+ * IncrementalHashMap – FlatHashMap whose rehashes are spread over the
+ * inserts that follow them instead of happening inside one insert.
+ *
+ * ────────────────────────────────────────────────────────────────
+ *  Layout
+ * ────────────────────────────────────────────────────────────────
+ *
+ *  cur_   : the table new keys go to
+ *  old_   : while a resize is in progress, the previous table; its keys
+ *           are moved to cur_ in slot order from cursor_ on
+ *
+ *  When an insert would make cur_ rehash (no growth left), cur_ becomes
+ *  old_ and a fresh, empty cur_ of FlatHashMap's next capacity (double,
+ *  or the same size when mostly tombstones) takes its place – allocating
+ *  zeroed memory, not touching a single entry.  From then on every insert
+ *  first moves the keys of the next kStepSlots slots of old_, so a
+ *  resize costs O(kStepSlots) per insert and old_ is gone after
+ *  capacity / kStepSlots inserts – well before cur_ can fill up: growth
+ *  left in cur_ is ≥ 3/32 of the old capacity, the resize needs 1/32.
+ *  The drained part of old_ is handed back to the OS every kDiscardSlots
+ *  slots, so freeing old_ at the end does not unmap it all in one insert.
+ *
+ *  Every key lives in exactly one table.  find() probes cur_ and, while
+ *  old_ is alive, old_; misses pay the second probe during a resize.
+ *  erase() never moves other keys, so it keeps the FlatHashMap contract:
+ *  iterators and references are invalidated by inserts only.
+ *
+ *  Slot numbers (fromSlot / slotIndex / capacity) span old_ then cur_, so
+ *  a cursor over them visits every slot of both tables.
+ */
+template <class K, class V,
+          class Hash  = std::hash<K>,
+          class Equal = std::equal_to<K>>
+class IncrementalHashMap {
+    using Table = FlatHashMap<K, V, Hash, Equal>;
+
+public:
+    using key_type    = K;
+    using mapped_type = V;
+    using value_type  = typename Table::value_type;
+    using size_type   = std::size_t;
+
+    static constexpr bool      kTransparent = Table::kTransparent;
+    static constexpr size_type kStepSlots   = 32;     // old_ slots moved per insert
+    static constexpr size_type kMinCapacity = 1024;   // smaller tables rehash at once
+    static constexpr size_type kDiscardSlots = 4096;  // drained old_ slots per discardSlots()
+
+private:
+    template <bool Const>
+    class Iter {
+        friend class IncrementalHashMap;
+        template <bool> friend class Iter;
+        using Map   = std::conditional_t<Const, const IncrementalHashMap, IncrementalHashMap>;
+        using Inner = std::conditional_t<Const, typename Table::const_iterator, typename Table::iterator>;
+        Map*  map_ = nullptr;
+        bool  inOld_ = false;                     // it_ points into map_->old_
+        Inner it_{};
+
+        Iter(Map* m, bool inOld, Inner it) : map_(m), inOld_(inOld), it_(it) { skip(); }
+        void skip() {                             // old_'s end continues in cur_
+            if (inOld_ && it_ == map_->old_.end()) { inOld_ = false; it_ = map_->cur_.begin(); }
+        }
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = IncrementalHashMap::value_type;
+        using difference_type   = std::ptrdiff_t;
+        using reference         = std::conditional_t<Const, const value_type&, value_type&>;
+        using pointer           = std::conditional_t<Const, const value_type*, value_type*>;
+
+        Iter() = default;
+        /* iterator → const_iterator */
+        template <bool C = Const, class = std::enable_if_t<C>>
+        Iter(const Iter<false>& o) : map_(o.map_), inOld_(o.inOld_), it_(o.it_) {}
+
+        reference operator*()  const { return *it_; }
+        pointer   operator->() const { return &*it_; }
+        Iter& operator++()    { ++it_; skip(); return *this; }
+        Iter  operator++(int) { Iter t = *this; ++*this; return t; }
+        bool operator==(const Iter& o) const { return inOld_ == o.inOld_ && it_ == o.it_; }
+
+        std::size_t slotIndex() const {
+            return inOld_ ? it_.slotIndex() : map_->old_.capacity() + it_.slotIndex();
+        }
+    };
+
+public:
+    using iterator       = Iter<false>;
+    using const_iterator = Iter<true>;
+
+    /* ─────────── capacity ─────────── */
+    size_type size()      const { return cur_.size() + old_.size(); }
+    bool      empty()     const { return size() == 0; }
+    size_type capacity()  const { return cur_.capacity() + old_.capacity(); }
+    bool      resizing()  const { return old_.capacity() != 0; }
+    size_type memoryBytes() const { return cur_.memoryBytes() + old_.memoryBytes(); }
+
+    /* true ⇒ inserting a new key may allocate a new table, of resizeBytes() */
+    bool growsOnInsert() const {
+        return !resizing() && (cur_.capacity() == 0 || cur_.growthLeft() == 0);
+    }
+    size_type resizeBytes() const { return cur_.nextCapacity() * (1 + sizeof(value_type)); }
+
+    void clear() {
+        Table().swap(old_);
+        cursor_ = discarded_ = 0;
+        cur_.clear();
+    }
+
+    /* ─────────── iteration ─────────── */
+    iterator       begin()       { return iterator(this, true, old_.begin()); }
+    iterator       end()         { return iterator(this, false, cur_.end()); }
+    const_iterator begin() const { return const_iterator(this, true, old_.begin()); }
+    const_iterator end()   const { return const_iterator(this, false, cur_.end()); }
+    /* first element in slot order at or after slot i (a resumable cursor) */
+    iterator fromSlot(size_type i) {
+        if (i < old_.capacity()) return iterator(this, true, old_.fromSlot(i));
+        return iterator(this, false, cur_.fromSlot(i - old_.capacity()));
+    }
+
+    /* ─────────── lookup ─────────── */
+    template <class Q> requires (kTransparent || std::is_same_v<Q, K>)
+    std::uint64_t hashKey(const Q& key) const { return cur_.hashKey(key); }
+
+    void prefetch(std::uint64_t h) const {
+        cur_.prefetch(h);
+        if (resizing()) old_.prefetch(h);
+    }
+    void prefetchSlot(std::uint64_t h) const {
+        cur_.prefetchSlot(h);
+        if (resizing()) old_.prefetchSlot(h);
+    }
+
+    template <class Q> requires (kTransparent || std::is_same_v<Q, K>)
+    iterator find(const Q& key, std::uint64_t h) {
+        auto c = cur_.find(key, h);
+        if (c != cur_.end() || !resizing()) return iterator(this, false, c);
+        auto o = old_.find(key, h);
+        return o != old_.end() ? iterator(this, true, o) : end();
+    }
+    template <class Q> requires (kTransparent || std::is_same_v<Q, K>)
+    const_iterator find(const Q& key, std::uint64_t h) const {
+        auto c = cur_.find(key, h);
+        if (c != cur_.end() || !resizing()) return const_iterator(this, false, c);
+        auto o = old_.find(key, h);
+        return o != old_.end() ? const_iterator(this, true, o) : end();
+    }
+    template <class Q> requires (kTransparent || std::is_same_v<Q, K>)
+    iterator find(const Q& key) { return find(key, hashKey(key)); }
+    template <class Q> requires (kTransparent || std::is_same_v<Q, K>)
+    const_iterator find(const Q& key) const { return find(key, hashKey(key)); }
+
+    template <class Q> requires (kTransparent || std::is_same_v<Q, K>)
+    bool contains(const Q& key) const { return find(key) != end(); }
+
+    /* ─────────── modifiers ─────────── */
+    template <class Q, class... Args> requires (kTransparent || std::is_same_v<Q, K>)
+    std::pair<iterator, bool> try_emplace(const Q& key, Args&&... args) {
+        if (resizing()) migrate(kStepSlots);     // before any iterator is formed
+        const std::uint64_t h = hashKey(key);
+        if (auto it = find(key, h); it != end()) return { it, false };
+        if (!resizing() && cur_.capacity() >= kMinCapacity && cur_.growthLeft() == 0) {
+            old_.swap(cur_);                      // start a resize: entries stay put
+            cur_.reserve(old_.nextCapacity() / 2);   // capacityFor(c/2) == c
+            cursor_ = discarded_ = 0;
+        } else if (resizing() && cur_.growthLeft() == 0) {
+            migrate(old_.capacity());             // cannot happen with the bounds above
+        }
+        return { iterator(this, false, cur_.try_emplace(key, std::forward<Args>(args)...).first), true };
+    }
+
+    void erase(iterator it) {
+        if (it.inOld_) old_.erase(it.it_);
+        else         cur_.erase(it.it_);
+    }
+    template <class Q> requires (kTransparent || std::is_same_v<Q, K>)
+    size_type erase(const Q& key) {
+        auto it = find(key);
+        if (it == end()) return 0;
+        erase(it);
+        return 1;
+    }
+
+    /* move the keys of the next `slots` slots of old_ (all: old_.capacity()) */
+    void migrate(size_type slots) {
+        const size_type stop = std::min(old_.capacity(), cursor_ + slots);
+        for (auto it = old_.fromSlot(cursor_); it != old_.end() && it.slotIndex() < stop;
+             it = old_.fromSlot(cursor_)) {
+            cursor_ = it.slotIndex() + 1;
+            cur_.emplaceUnique(std::move(it->first), std::move(it->second));
+            old_.erase(it);
+        }
+        cursor_ = stop;
+        if (cursor_ == old_.capacity()) {         // done: drop the old arrays
+            Table().swap(old_);
+            cursor_ = discarded_ = 0;
+        } else if (cursor_ - discarded_ >= kDiscardSlots) {
+            old_.discardSlots(discarded_, cursor_);
+            discarded_ = cursor_;
+        }
+    }
+
+private:
+    Table     cur_;
+    Table     old_;
+    size_type cursor_    = 0;                     // next old_ slot to move
+    size_type discarded_ = 0;                     // old_ slots below this are discarded
+};
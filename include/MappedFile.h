@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/*
+ * Read-only view of a whole file.  Uses mmap where available (pages fault
+ * in on demand, nothing is copied); elsewhere, or if mapping fails, the
+ * file is read into an 8-byte aligned heap buffer so callers can rely on
+ * the same alignment either way.  Throws std::runtime_error if the file
+ * cannot be opened.
+ */
+class MappedFile {
+public:
+    enum class Access { Random, Sequential };    // madvise hint
+
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path, Access access = Access::Random);
+    ~MappedFile();
+
+    MappedFile(MappedFile&& o) noexcept;
+    MappedFile& operator=(MappedFile&& o) noexcept;
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char*      data()   const { return data_; }
+    std::size_t      size()   const { return size_; }
+    std::string_view view()   const { return { data_, size_ }; }
+    bool             mapped() const { return mapped_; }   // false ⇒ heap copy
+
+private:
+    const char*                      data_   = nullptr;
+    std::size_t                      size_   = 0;
+    bool                             mapped_ = false;
+    std::unique_ptr<std::uint64_t[]> owned_;
+};
@@ -0,0 +1,169 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include "EpochDomain.h"
+#include "inMemoryDb.h"
+
+/*
+ * Multi-version front end over InMemoryDB: snapshot readers never wait for
+ * the write path and see a consistent point-in-time view.
+ *
+ * ────────────────────────────────────────────────────────────────
+ *  Write side
+ * ────────────────────────────────────────────────────────────────
+ *
+ *  head_        : ordinary InMemoryDB (any TxnMode) holding the latest
+ *                 state incl. uncommitted writes; writer calls are
+ *                 serialized by writerMu_.
+ *  On commit    : head_ reports the net changes (CommitObserver); they
+ *                 are stamped with ts = commitTs_ + 1, prepended to the
+ *                 per-key version chains together with the new COUNT of
+ *                 every affected value, and only then commitTs_ = ts is
+ *                 published (release).  A commit is therefore invisible
+ *                 until all of its versions are in place.
+ *
+ * ────────────────────────────────────────────────────────────────
+ *  Read side
+ * ────────────────────────────────────────────────────────────────
+ *
+ *  snapshot()   : registers ts = commitTs_ and returns a handle.
+ *  get / count  : walk the chain from its head to the first version with
+ *                 version.ts ≤ snapshot ts.  Chains are singly linked,
+ *                 newest first, and published with release stores, so no
+ *                 lock is held while walking.  Locating a chain takes a
+ *                 shared lock on one of 64 directory shards for the
+ *                 duration of a hash lookup only – a long scan never holds
+ *                 anything across keys, and never delays a commit by more
+ *                 than one lookup.
+ *
+ *  Values returned by a snapshot stay valid for the snapshot's lifetime.
+ *
+ * ────────────────────────────────────────────────────────────────
+ *  Garbage collection
+ * ────────────────────────────────────────────────────────────────
+ *
+ *  horizon = oldest registered snapshot ts (or commitTs_ if none).
+ *  Every chain keeps its versions newer than the horizon plus the first
+ *  one at/below it; everything older is unreachable for current and future
+ *  snapshots and is freed.  Touched chains are trimmed on each commit,
+ *  collectGarbage() sweeps all of them.  Snapshot registration and horizon
+ *  computation share registryMu_, so a snapshot can never pick a ts whose
+ *  versions are being trimmed.
+ *
+ *  A reader may be standing on the surviving version, so trimming never
+ *  frees it.  When that survivor is a tombstone (deleted key, COUNT 0) the
+ *  chain reads the same as no chain at all: collectGarbage() unlinks it
+ *  from the directory and retires it to an EpochDomain, which frees it
+ *  once no Snapshot::get / count that might have found it is still
+ *  running.  Deleting keys therefore costs nothing after the next sweep.
+ */
+class MvccInMemoryDB : private CommitObserver {
+public:
+    using Timestamp = std::uint64_t;
+
+private:
+    /* one immutable version; next is only ever cut by GC */
+    template <class T>
+    struct Version {
+        Timestamp                ts;
+        T                        val;
+        std::atomic<Version*>    next{nullptr};
+    };
+
+    template <class T>
+    struct Chain {
+        std::atomic<Version<T>*> head{nullptr};
+        ~Chain();
+    };
+
+    /* key → chain directory, sharded so readers lock one shard briefly */
+    template <class T>
+    class VersionedMap {
+        static constexpr std::size_t kShards = 64;
+        struct Shard {
+            mutable std::shared_mutex                  mu;
+            FlatStringMap<std::unique_ptr<Chain<T>>>   chains;
+        };
+        std::unique_ptr<Shard[]> shards_ = std::make_unique<Shard[]>(kShards);
+
+        Shard&         shardFor(std::string_view key) const;
+        Chain<T>*      find(std::string_view key) const;
+
+    public:
+        const T*  read(std::string_view key, Timestamp ts) const;     // reader
+        const T*  latest(std::string_view key) const;                 // writer
+        Chain<T>* install(std::string_view key, Timestamp ts, T val); // writer
+        static std::size_t trim(Chain<T>& c, Timestamp horizon);      // writer
+        std::size_t trimAll(Timestamp horizon, EpochDomain& d, RetireList& retired);
+        std::size_t versionCount() const;
+        std::size_t chainCount() const;
+    };
+
+    mutable EpochDomain                        epochs_;    // outlives what it guards
+    InMemoryDB                                 head_;
+    mutable std::mutex                         writerMu_;
+
+    VersionedMap<std::optional<std::string>>   keys_;      // nullopt ⇒ deleted
+    VersionedMap<std::size_t>                  counts_;    // value → COUNT
+    std::atomic<Timestamp>                     commitTs_{0};
+    RetireList                                 retired_;   // unlinked chains
+
+    mutable std::mutex                         registryMu_;
+    mutable std::map<Timestamp, std::size_t>   snapshots_; // ts → #open handles
+
+    void      onCommit(std::span<const CommittedChange> changes) override;
+    Timestamp horizon() const;
+    void      release(Timestamp ts) const;
+
+public:
+    /* RAII read view; movable, not copyable */
+    class Snapshot {
+        friend class MvccInMemoryDB;
+        const MvccInMemoryDB* db_;
+        Timestamp             ts_;
+        Snapshot(const MvccInMemoryDB* db, Timestamp ts) : db_(db), ts_(ts) {}
+    public:
+        Snapshot(Snapshot&& o) noexcept : db_(o.db_), ts_(o.ts_) { o.db_ = nullptr; }
+        Snapshot& operator=(Snapshot&&) = delete;
+        Snapshot(const Snapshot&) = delete;
+        ~Snapshot() { if (db_) db_->release(ts_); }
+
+        std::optional<std::string_view> get  (std::string_view key) const;
+        std::size_t                     count(std::string_view val) const;
+        Timestamp                       timestamp() const { return ts_; }
+    };
+
+    explicit MvccInMemoryDB(TxnMode mode = TxnMode::UndoLog);
+    ~MvccInMemoryDB();
+
+    /* write side – same semantics as InMemoryDB, reads see own writes */
+    void                       set  (std::string_view key, std::string_view val);
+    std::optional<std::string> get  (std::string_view key) const;
+    void                       del  (std::string_view key);
+    std::size_t                count(std::string_view val) const;
+    std::optional<std::int64_t> incr(std::string_view key, std::int64_t delta = 1);
+    void                       begin();
+    TxnStatus                  rollback();
+    TxnStatus                  commit();
+    TxnStatus                  release();
+
+    /* read side */
+    Snapshot    snapshot() const;
+    Timestamp   lastCommit() const { return commitTs_.load(std::memory_order_acquire); }
+
+    /* frees versions no snapshot can reach and drops chains that end in a
+       tombstone; returns #versions freed (a dropped chain's last version
+       counts, although its memory is reclaimed a little later) */
+    std::size_t collectGarbage();
+    std::size_t versionCount() const;
+    std::size_t chainCount() const;     // keys + values with a version chain
+};
@@ -0,0 +1,98 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include "EpochDomain.h"
+#include "inMemoryDb.h"
+
+/*
+ * Thread-safe front end over InMemoryDB that partitions the key space.
+ *
+ * ────────────────────────────────────────────────────────────────
+ *  Layout
+ * ────────────────────────────────────────────────────────────────
+ *
+ *  shards_[i]   : { mutex; InMemoryDB; ReadIndex }   (own cache line)
+ *
+ *  A key lives in shard  hash(key) >> (64 - log2 N), i.e. the top bits of
+ *  the mixed hash; FlatHashMap indexes with the low bits, so the shard
+ *  choice does not skew the per-shard tables.  Every shard owns its own
+ *  db_ and value pool, i.e. its slice of valCount_.
+ *
+ *  SET / DELETE : lock the shard, apply to its InMemoryDB
+ *  GET / COUNT  : no lock – read the shards' ReadIndex
+ *
+ * ────────────────────────────────────────────────────────────────
+ *  Lock-free reads
+ * ────────────────────────────────────────────────────────────────
+ *
+ *  Each shard's InMemoryDB reports every change (writes, evictions) to its
+ *  ReadIndex, a CommitObserver holding two open-addressing tables of
+ *  atomic node pointers: key → { key, value } and value → { value, count }.
+ *  Nodes are immutable apart from their counters; the writer publishes a
+ *  new node or a grown table with a release store and retires the one it
+ *  replaced to an EpochDomain shared by all shards.
+ *
+ *  A reader pins the domain (a store and a fence on its own cache line),
+ *  probes with acquire loads, copies what it needs and unpins.  It never
+ *  writes a shared line: hit / miss / count tallies live in its reader
+ *  record, and the CLOCK reference bit of a node is only stored when clear.
+ *  Nodes and tables are freed once no reader can still be pinned to an
+ *  epoch in which they were reachable.
+ *
+ *  COUNT sums the shards one after another; it is not an atomic snapshot
+ *  across shards while writers run.  A GET racing a SET of the same key
+ *  returns the old or the new value.
+ *
+ *  A memory limit is split evenly.  The read index is counted against a
+ *  shard's share: its InMemoryDB gets the share minus what the index
+ *  holds, and evicts (CLOCK, see InMemoryDB) with the index's reference
+ *  bits as a second source of recency.
+ *
+ * Writes to different shards never contend and reads never contend at
+ * all, so read throughput scales with cores.  Transactions are
+ * deliberately not exposed: BEGIN/ROLLBACK would have to span every
+ * shard – use a plain InMemoryDB for transactional sessions.
+ */
+class ShardedInMemoryDB {
+    class ReadIndex;
+
+    struct alignas(64) Shard {
+        mutable std::mutex         mu;            // writers only
+        InMemoryDB                 db;
+        std::unique_ptr<ReadIndex> index;
+        std::size_t                limit = 0;     // share of the memory limit; 0 ⇒ none
+    };
+
+    mutable EpochDomain      epochs_;       // outlives shards_ (declared first)
+    std::unique_ptr<Shard[]> shards_;
+    std::size_t              shardCount_;
+    unsigned                 shift_;        // 64 - log2(shardCount_)
+
+    Shard& shardFor(std::string_view key) const;
+    Shard& shardOf(std::uint64_t h) const;   // h = mixed hash of the key
+    void   fitLimit(Shard& s);              // after a write: db limit = share − index
+
+public:
+    /* shard count is rounded up to a power of two */
+    explicit ShardedInMemoryDB(std::size_t shards = 64);
+    ~ShardedInMemoryDB();
+
+    void                       set  (std::string_view key, std::string_view val);
+    std::optional<std::string> get  (std::string_view key) const;
+    void                       del  (std::string_view key);
+    std::size_t                count(std::string_view val) const;
+    std::optional<std::int64_t> incr(std::string_view key, std::int64_t delta = 1);   // see InMemoryDB
+
+    /* total ceiling in bytes (0 ⇒ none), shardCount() equal shares */
+    void        setMemoryLimit(std::size_t bytes);
+    std::size_t memoryUsage() const;            // Σ shards, read indexes included
+    CacheStats  cacheStats()  const;            // Σ shards
+    DbStats     stats()       const;            // Σ shards; lock-free GET / COUNT untimed
+
+    std::size_t shardCount() const { return shardCount_; }
+};
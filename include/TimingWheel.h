@@ -0,0 +1,172 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/*
+ * TimingWheel – hierarchical timer wheel of (deadline, key) entries with
+ * budgeted advancement.
+ *
+ * ────────────────────────────────────────────────────────────────
+ *  Layout
+ * ────────────────────────────────────────────────────────────────
+ *
+ *  kLevels wheels of 64 slots; a slot of level l spans 64^l ticks, so the
+ *  wheels together cover 64^6 ≈ 6.9·10^10 ticks (≈ 2 years at 1 ms).
+ *
+ *  A slot is one byte buffer of packed records { u64 when, u32 len, key }.
+ *  Keys are copied in, so scheduling allocates only when a buffer grows
+ *  (buffers keep their capacity when drained) and firing frees nothing –
+ *  no per-timer heap node, and a timer costs 12 bytes + the key.
+ *
+ *  schedule(when) appends to the lowest level whose span reaches `when`
+ *  (O(1): one bit_width).  An entry further out than the top level is
+ *  parked on the top level and simply re-placed when its slot comes up.
+ *
+ *  Moving time forward to t visits every tick in between.  At tick t the
+ *  level-0 slot of t is due; when t is a multiple of 64^l, the level-l
+ *  slot that starts at t is also emptied and its entries are re-placed on
+ *  the levels below ("cascade").  The largest such slot is handed over by
+ *  swapping buffers, so the bookkeeping per tick is O(1); runs of ticks
+ *  with an empty level 0 (or empty low levels) are skipped in one step.
+ *
+ * ────────────────────────────────────────────────────────────────
+ *  Budget
+ * ────────────────────────────────────────────────────────────────
+ *
+ *  advance(to, budget, due) touches at most `budget` entries – fired or
+ *  cascaded.  If it runs out, now() stops at the tick being drained and
+ *  the next call resumes there, so a storm of simultaneous deadlines is
+ *  spread over several calls instead of one long pause.  Every entry
+ *  with when ≤ now() has been handed to `due` once the call returns with
+ *  backlog() == 0.
+ *
+ *  Entries are never cancelled; owners validate them when they fire.
+ *  `due` receives a view into the wheel and must not call schedule().
+ */
+class TimingWheel {
+public:
+    static constexpr unsigned kBits   = 6;
+    static constexpr unsigned kSlots  = 1u << kBits;
+    static constexpr unsigned kLevels = 6;
+
+    explicit TimingWheel(std::uint64_t now = 0) : now_(now) {}
+
+    std::uint64_t now()     const { return now_; }
+    std::size_t   size()    const { return size_; }               // scheduled + backlog
+    bool          backlog() const { return workPos_ < work_.size(); }
+    /* heap bytes held (slot table + buffer capacity; drained buffers keep theirs) */
+    std::size_t   memoryBytes() const { return slots_.capacity() * sizeof(Buffer) + bufBytes_; }
+
+    /* move an empty wheel's clock (e.g. to the owner's time on first use) */
+    void seek(std::uint64_t now) {
+        if (size_ == 0) now_ = now;
+    }
+
+    void schedule(std::uint64_t when, std::string_view key) {
+        if (slots_.empty()) slots_.resize(kLevels * kSlots);
+        ++size_;
+        if (when <= now_) append(work_, when, key, bufBytes_);
+        else              place(when, key);
+    }
+
+    /* due(when, std::string_view key) for every entry with when ≤ the new
+       now(); see Budget */
+    template <class F>
+    std::size_t advance(std::uint64_t to, std::size_t budget, F&& due) {
+        std::size_t fired = 0;
+        for (;;) {
+            while (workPos_ < work_.size()) {
+                if (budget == 0) return fired;
+                --budget;
+                std::uint64_t when;
+                std::uint32_t len;
+                std::memcpy(&when, work_.data() + workPos_, sizeof when);
+                std::memcpy(&len, work_.data() + workPos_ + sizeof when, sizeof len);
+                std::string_view key(work_.data() + workPos_ + kHeader, len);
+                workPos_ += kHeader + len;
+                if (when <= now_) {
+                    --size_;
+                    ++fired;
+                    due(when, key);
+                } else {
+                    place(when, key);                 // never into work_: views stay valid
+                }
+            }
+            work_.clear();
+            workPos_ = 0;
+            if (now_ >= to) return fired;
+            if (size_ == 0) { now_ = to; return fired; }
+            step(to);
+        }
+    }
+
+private:
+    using Buffer = std::vector<char>;
+    static constexpr std::size_t   kHeader  = sizeof(std::uint64_t) + sizeof(std::uint32_t);
+    static constexpr std::uint64_t kHorizon = std::uint64_t(1) << (kBits * kLevels);
+
+    std::vector<Buffer> slots_;                       // [level * kSlots + slot], allocated on first use
+    std::size_t         perLevel_[kLevels] = {};      // bytes per level
+    Buffer              work_;                        // records of the slots being drained
+    std::size_t         workPos_ = 0;                 // byte offset of the next record
+    std::uint64_t       now_;
+    std::size_t         size_ = 0;
+    std::size_t         bufBytes_ = 0;                // Σ capacity of slots_ and work_
+
+    static void append(Buffer& b, std::uint64_t when, std::string_view key, std::size_t& bytes) {
+        const auto len = static_cast<std::uint32_t>(key.size());
+        const std::size_t at = b.size();
+        const std::size_t cap = b.capacity();
+        b.resize(at + kHeader + len);
+        bytes += b.capacity() - cap;
+        std::memcpy(b.data() + at, &when, sizeof when);
+        std::memcpy(b.data() + at + sizeof when, &len, sizeof len);
+        std::memcpy(b.data() + at + kHeader, key.data(), len);
+    }
+
+    void place(std::uint64_t when, std::string_view key) {
+        const std::uint64_t delta = when - now_;    // > 0
+        unsigned level = static_cast<unsigned>(std::bit_width(delta) - 1) / kBits;
+        std::uint64_t at = when;
+        if (level >= kLevels) {                      // beyond the top wheel: park
+            level = kLevels - 1;
+            at    = now_ + kHorizon - 1;
+        }
+        auto slot = static_cast<std::size_t>((at >> (kBits * level)) & (kSlots - 1));
+        append(slots_[level * kSlots + slot], when, key, bufBytes_);
+        perLevel_[level] += kHeader + key.size();
+    }
+
+    /* move now_ to the next tick that can have work (≤ to) and collect it */
+    void step(std::uint64_t to) {
+        unsigned empty = 0;                          // leading empty levels
+        while (empty < kLevels && perLevel_[empty] == 0) ++empty;
+        std::uint64_t next = now_ + 1;
+        if (empty > 0) {                             // jump to the next boundary of `empty`
+            const unsigned shift = kBits * (empty < kLevels ? empty : kLevels);
+            next = ((now_ >> shift) + 1) << shift;
+        }
+        now_ = next < to ? next : to;
+
+        for (unsigned l = kLevels; l-- > 0;) {       // highest (largest) slot first
+            if (l > 0 && (now_ & ((std::uint64_t(1) << (kBits * l)) - 1)) != 0) continue;
+            Buffer& slot = slots_[l * kSlots + ((now_ >> (kBits * l)) & (kSlots - 1))];
+            if (slot.empty()) continue;
+            perLevel_[l] -= slot.size();
+            if (work_.empty()) {
+                work_.swap(slot);
+            } else {
+                const std::size_t cap = work_.capacity();
+                work_.insert(work_.end(), slot.begin(), slot.end());
+                bufBytes_ += work_.capacity() - cap;
+                slot.clear();
+            }
+        }
+    }
+};
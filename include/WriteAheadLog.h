@@ -0,0 +1,97 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include "inMemoryDb.h"
+
+/*
+ * Append-only write-ahead log for InMemoryDB.
+ *
+ * Attach it as the database's CommitObserver; every committed change set
+ * (autocommit SET/DELETE or the net result of COMMIT) becomes one record.
+ * Rolled-back work never reaches the log.  Several databases (e.g. one per
+ * thread) may share one log – onCommit() is thread-safe, and that is where
+ * group commit pays off.
+ *
+ * ────────────────────────────────────────────────────────────────
+ *  Record format (little-endian)
+ * ────────────────────────────────────────────────────────────────
+ *
+ *    u32 payloadLen | u32 crc32(payload) | payload
+ *    payload = varint n, n × { u8 op (0 del, 1 set),
+ *                              varint klen, key, [varint vlen, value] }
+ *
+ *  A crash can leave a torn last record; replay() stops at the first
+ *  record whose length or checksum does not verify and truncates the file
+ *  there, so later appends are never hidden behind garbage.
+ *
+ * ────────────────────────────────────────────────────────────────
+ *  Durability levels
+ * ────────────────────────────────────────────────────────────────
+ *
+ *  None      : records are buffered and handed to the OS when the buffer
+ *              fills (or on close); never fsync'ed.
+ *  Async     : a flusher thread writes + fsyncs every flushInterval; commit
+ *              returns immediately (may lose the last interval on crash).
+ *  Group     : commit returns once its record is fsync'ed.  Commits that
+ *              arrive while the flusher is busy (or during the optional
+ *              flushInterval gathering window) share the next fsync.
+ *  PerCommit : every commit writes and fsyncs its own record.
+ *
+ *  A failed write or fsync (e.g. ENOSPC) throws std::runtime_error from
+ *  the call that did the I/O.  When the flusher thread hits it, it stops
+ *  and keeps the error; waiting Group committers, sync() and every later
+ *  onCommit() rethrow it.
+ */
+enum class Durability { None, Async, Group, PerCommit };
+
+struct WalOptions {
+    Durability                durability    = Durability::Group;
+    std::chrono::microseconds flushInterval { 0 };   // Async period / Group window
+};
+
+class WriteAheadLog : public CommitObserver {
+public:
+    explicit WriteAheadLog(const std::string& path, WalOptions opts = {});
+    ~WriteAheadLog() override;
+
+    WriteAheadLog(const WriteAheadLog&)            = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    void onCommit(std::span<const CommittedChange> changes) override;
+
+    /* force everything appended so far to disk */
+    void sync();
+
+    std::uint64_t records() const;
+    std::uint64_t fsyncs()  const;
+
+    /* apply every intact record of `path` to db (which should have no
+       observer attached yet); truncates a torn tail; returns #records */
+    static std::size_t replay(const std::string& path, InMemoryDB& db);
+
+private:
+    WalOptions              opts_;
+    int                     fd_ = -1;
+
+    mutable std::mutex      mu_;
+    std::condition_variable flushCv_;     // wakes the flusher
+    std::condition_variable durableCv_;   // wakes Group committers
+    std::string             buf_;         // encoded, not yet written
+    std::uint64_t           appended_ = 0;    // records appended
+    std::uint64_t           durable_  = 0;    // records fsync'ed
+    std::uint64_t           fsyncs_   = 0;
+    bool                    stop_     = false;
+    bool                    flushNow_ = false;    // sync() asked the flusher
+    std::exception_ptr      failure_;             // the flusher's I/O error, if any
+    std::thread             flusher_;
+
+    void flusherLoop();
+    void writeOut(const std::string& bytes, bool doSync);   // no lock held
+};
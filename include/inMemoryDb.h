@@ -1,63 +1,463 @@
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <utility>
 #include <vector>
 #include <optional>
+#include "BPlusTree.h"
+#include "BumpArena.h"
+#include "DbStats.h"
+#include "FlatHashMap.h"
+#include "IncrementalHashMap.h"
+#include "TimingWheel.h"
 
 /*
  * Simple in-memory, single-threaded database with nested transactions.
  * All data operations run in expected O(1) (hash-map) time, which is
  * within the O(log N) worst-case bound that was requested.
  *
+ * Both maps are FlatHashMap (open addressing, SIMD-probed control bytes);
+ * db_ wraps its table in an IncrementalHashMap, so growing it is spread
+ * over the inserts that follow.  The API takes std::string_view and the
+ * maps hash transparently, so GET / DELETE / COUNT never build a
+ * temporary std::string.  getView() and visit() hand out the stored value
+ * without copying; the view stays valid until the next mutating call.
+ *
  * ────────────────────────────────────────────────────────────────
  *  Data structures
  * ────────────────────────────────────────────────────────────────
  *
- *  db_          : current committed key → value map
- *  valCount_    : current committed value → multiplicity (COUNT) map
+ *  db_          : current committed key → Entry { value-id, txn stamp }
+ *
+ *  Value pool   : every distinct value string is stored once and
+ *                 referred to by a small integer id.
+ *    valueIds_  : value → id
+ *    values_    : id → value
+ *    valCount_  : id → multiplicity (COUNT), dense array
+ *    valRefs_   : id → #holders (db_ entries + undo records)
+ *    freeIds_   : ids whose refcount dropped to 0, reused first
  *
- *  txnStack_    : vector< vector<Change> >
+ *                 An id is reclaimed only when no key AND no undo record
+ *                 refers to it, so a rollback can never resurrect an id
+ *                 that was meanwhile reused for a different value.
+ *
+ *  txnStack_    : vector< Txn{ epoch, vector<Change>, arena mark } >
  *                 each level holds the “undo log” of THAT transaction
  *                 (only the first modification of a key in the scope
  *                 is stored, so space is proportional to #changes,
  *                 not #keys → satisfies space constraint).
  *
- *  Change       : { string key; optional<string> priorValue; }
+ *  Change       : { key; optional<ValueId> priorValue; priorStamp }
  *                 priorValue == nullopt  ⇒  key was absent beforehand
  *
  *  On ROLLBACK  : replay undo log in reverse and pop one level
- *  On COMMIT    : discard the entire stack (logs already applied)
+ *  On COMMIT    : unpin logged ids and discard the entire stack
+ *  On RELEASE   : fold the top log into its parent and pop one level
+ *
+ *  Epoch stamps, frame recycling and the RELEASE merge are described at
+ *  the transaction ops in inMemoryDb.cpp.
+ *
+ * ────────────────────────────────────────────────────────────────
+ *  TxnMode::Overlay (chosen at construction)
+ * ────────────────────────────────────────────────────────────────
+ *
+ *  Writes inside BEGIN leave db_ untouched.  Each level instead buffers
+ *  them in a Layer:
+ *
+ *    writes     : key → new value | nullopt (deleted in this level)
+ *    countDelta : value → net change of COUNT caused by this level
+ *
+ *  GET    : first layer (top-down) that mentions the key wins, else db_
+ *  COUNT  : base count + Σ countDelta over the open layers
+ *  ROLLBACK: pop the top layer – no lookups, no count fix-ups
+ *  COMMIT : apply every layer bottom-up to db_, then drop them
+ *  RELEASE: merge the top layer into the one below – its writes and
+ *           deadlines overwrite, its count deltas add up
+ *
+ *  Reads cost O(depth) extra; aborts become constant work, which suits
+ *  speculative workloads where most transactions roll back.
+ *
+ * ────────────────────────────────────────────────────────────────
+ *  Commit notifications
+ * ────────────────────────────────────────────────────────────────
+ *
+ *  An attached CommitObserver is told about every change that becomes
+ *  durable state: each effective SET / DELETE outside a transaction, and
+ *  the net result of a COMMIT (one entry per distinct key touched by any
+ *  level, carrying the key's final value).  Rolled-back writes are never
+ *  reported.  With no observer attached nothing is collected.
+ *  WriteAheadLog makes the changes durable; ChangeStream hands them to
+ *  in-process readers.
+ *
+ * ────────────────────────────────────────────────────────────────
+ *  Optional features (details next to their code in inMemoryDb.cpp)
+ * ────────────────────────────────────────────────────────────────
+ *
+ *  Checkpoint image : reads fall through to a mapped Checkpoint; the first
+ *                     write to an image key copies it into db_.
+ *  Ordered index    : a BPlusTreeSet mirroring db_'s keys makes scan /
+ *                     scanRange O(log N + page) instead of a sort.
+ *  Value index      : value-id → keys, kept by inc() / dec(), makes
+ *                     keysWithValue() O(COUNT) instead of O(N).
+ *  Counters         : incr() rewrites the value-pool slot in place when
+ *                     the key is the only holder of its id.
+ *  Expiration       : deadlines in expires_ fire from a TimingWheel as
+ *                     expire(budget) advances it; writes reap lazily.
+ *  Memory limit     : above setMemoryLimit(), a CLOCK hand over db_'s
+ *                     slots evicts keys not read since it last passed.
+ *  Snapshots        : copy-on-write; a write saves the entry it changes if
+ *                     the snapshot walk has not handed it out yet.
+ *  Statistics       : per-operation counts and sampled latency histograms
+ *                     (DbStats.h; INMEMORYDB_STATS=0 compiles them out).
  */
 
+class Checkpoint;
+
 /* Return‑code for COMMIT / ROLLBACK */
 enum class TxnStatus { Ok, NoTransaction };
 
+/* How BEGIN / ROLLBACK / COMMIT are implemented (see above) */
+enum class TxnMode { UndoLog, Overlay };
+
+/* One page of scan results, ascending by key */
+struct ScanPage {
+    std::vector<std::pair<std::string, std::string>> items;
+    std::string                                      next;   // cursor of the next page; empty ⇒ done
+};
+
+/* read and eviction counters of one InMemoryDB (see setMemoryLimit) */
+struct CacheStats {
+    std::uint64_t hits = 0, misses = 0;     // GET-style reads that found / missed the key
+    std::uint64_t evictions = 0;
+    double hitRatio() const {
+        return hits + misses ? double(hits) / double(hits + misses) : 0.0;
+    }
+};
+
+/* One committed mutation; views are valid only during onCommit() */
+struct CommittedChange {
+    std::string_view                key;
+    std::optional<std::string_view> val;        // nullopt ⇒ key deleted
+};
+
+class CommitObserver {
+public:
+    virtual ~CommitObserver() = default;
+    /* changes of one atomic commit (autocommit ⇒ exactly one entry) */
+    virtual void onCommit(std::span<const CommittedChange> changes) = 0;
+};
+
 class InMemoryDB {
+    friend class Checkpoint;                     // reads committed state in write()
+
+    using ValueId = std::uint32_t;
+    using Epoch   = std::uint64_t;
+
+    struct Entry {
+        ValueId              val;
+        mutable std::uint8_t ref   = 0;          // CLOCK reference bit (atomic_ref access)
+        std::uint8_t         snap  = 0;          // snapshot phase (see beginSnapshot)
+        Epoch                stamp = 0;          // epoch of the last txn that logged it
+    };
+
     /* per‑transaction undo record */
     struct Change {
-        std::string                 key;
-        std::optional<std::string>  oldVal;      // nullopt ⇒ key was absent
+        std::string_view            key;         // in undoKeys_
+        std::optional<ValueId>      oldVal;      // nullopt ⇒ key was absent
+        Epoch                       priorStamp = 0;
+        std::uint64_t               priorDeadline = 0;   // 0 ⇒ no TTL
     };
 
-    std::unordered_map<std::string,std::string> db_;        // key → value
-    std::unordered_map<std::string,std::size_t> valCount_;  // value → freq
+    struct Txn {
+        Epoch               epoch = 0;
+        std::vector<Change> log;
+        BumpArena::Mark     keys;                // undoKeys_ at BEGIN
+    };
 
-    std::vector<std::vector<Change>>            txnStack_;  // stack of undo logs (one per BEGIN)
+    using KeyTable = IncrementalHashMap<std::string, Entry, StringHash, std::equal_to<>>;
+    KeyTable                         db_;         // key → value-id + stamp
 
-    void inc(const std::string& v);             // ++count[v]
-    void dec(const std::string& v);             // --count[v]
-    void record(const std::string& key);        // log first change in txn
+    FlatStringMap<ValueId>           valueIds_;   // value → id
+    std::vector<std::string>         values_;     // id → value
+    std::vector<std::size_t>         valCount_;   // id → freq
+    std::vector<std::size_t>         valRefs_;    // id → holders
+    std::vector<ValueId>             freeIds_;    // reclaimed ids
+
+    /* per‑level write buffer (TxnMode::Overlay) */
+    struct Layer {
+        FlatStringMap<std::optional<std::string>> writes;      // nullopt ⇒ deleted
+        FlatStringMap<std::ptrdiff_t>             countDelta;
+        FlatStringMap<std::uint64_t>              deadlines;   // keys written with a TTL
+        std::size_t                               heap = 0;    // string heap bytes of the maps
+    };
+
+    TxnMode                          mode_;
+    std::vector<Txn>                 txnStack_;   // stack of undo logs (one per BEGIN)
+    std::vector<Txn>                 spareStack_; // COMMIT's swap partner, always empty
+    std::vector<std::vector<Change>> spareLogs_;  // cleared logs of finished levels
+    BumpArena                        undoKeys_;   // keys of every open level's log
+    Epoch                            lastEpoch_ = 0;
+    std::vector<Layer>               layers_;     // overlay stack (one per BEGIN)
+
+    CommitObserver*                  observer_ = nullptr;
+
+    std::shared_ptr<const Checkpoint>         image_;      // read-only base, may be null
+    FlatStringMap<bool>                       shadowed_;   // promoted image keys
+    FlatHashMap<std::uint32_t, std::size_t>   hidden_;     // image value → #shadowed holders
+
+    std::optional<BPlusTreeSet<std::string>>  ordered_;    // keys of db_, if enabled
+
+    struct ValueIndex {
+        std::vector<std::vector<std::string>> keys;   // id → holders (unordered)
+        FlatStringMap<std::uint32_t>          pos;    // key → index in keys[its id]
+        std::size_t                           bytes = 0;   // list slots + key heap
+    };
+    std::optional<ValueIndex>                 byValue_;    // if enabled
+
+    struct SnapshotWalk {
+        std::vector<std::pair<std::string, std::string>> saved;   // pre-images, not yet handed out
+        std::size_t heap      = 0;               // string heap of saved
+        std::size_t pending   = 0;               // unvisited db_ entries
+        std::size_t cursor    = 0;               // next db_ slot of the walk
+        std::size_t imageNext = 0;               // next image keyDir index
+    };
+    std::optional<SnapshotWalk>               walk_;       // while a snapshot runs
+    std::uint8_t                              phase_ = 0;  // see beginSnapshot
+
+    FlatStringMap<std::uint64_t>              expires_;    // key → deadline (TTL keys only)
+    TimingWheel                               wheel_;
+    std::function<std::uint64_t()>            clock_;      // ms; empty ⇒ steady_clock
+    std::function<bool(std::string_view)>     refHook_;    // extra CLOCK reference bits
+    std::size_t                               expired_ = 0;
+
+    std::size_t                               memLimit_ = 0;   // bytes; 0 ⇒ none
+    std::size_t                               keyHeap_  = 0;   // heap of db_ keys
+    std::size_t                               heap_     = 0;   // heap of pool, expires_, shadowed_
+    std::size_t                               hand_     = 0;   // CLOCK hand (db_ slot)
+    std::uint64_t                             evicted_  = 0;
+    mutable std::uint64_t                     hits_ = 0, misses_ = 0;   // atomic_ref access
+#if INMEMORYDB_STATS
+    OpRecorder                                opStats_;    // see DbStats.h
+#endif
+
+    static std::size_t heapBytes(std::size_t len) {   // of a string built from len chars
+        static const std::size_t sso = std::string().capacity();
+        return len > sso ? len + 1 : 0;
+    }
+
+    ValueId intern(std::string_view v);         // find or allocate id (no ref taken)
+    void pin  (ValueId id);                     // ++refs[id]
+    void unpin(ValueId id);                     // --refs[id], reclaim at 0
+    bool rename(ValueId id, std::string_view v); // sole holder: slot id now holds v
+    void inc(ValueId id, std::string_view key); // ++count[id] (+ ref); key now holds id
+    void dec(ValueId id, std::string_view key); // --count[id] (− ref); key no longer does
+    void holderAdd (ValueId id, std::string_view key);
+    void holderDrop(ValueId id, std::string_view key);
+    using KeySink = void (*)(void* ctx, std::string_view key);
+    std::size_t holdersOf(std::string_view val, std::size_t limit, KeySink sink, void* ctx) const;
+    void record(std::string_view key, Entry* e); // log first change in txn (e = current entry or null)
+    std::uint64_t now() const;
+    std::uint64_t deadlineOf(std::string_view key) const;      // layers, then expires_; 0 ⇒ none
+    void setDeadline(std::string_view key, std::uint64_t deadline);   // 0 ⇒ clear
+    void discard(KeyTable::iterator it, std::string_view key); // unlogged delete
+    void reap(KeyTable::iterator it, std::string_view key);   // delete an expired key
+    bool reapIfExpired(KeyTable::iterator& it, std::string_view key);
+    bool pastDeadline(std::string_view key) const;   // expired, not reaped yet: reads miss
+    std::size_t expiredHolders(ValueId id) const;     // db_ keys of id that pastDeadline()
+    Epoch currentEpoch() const { return txnStack_.empty() ? 0 : txnStack_.back().epoch; }
+
+    std::optional<std::string_view> lookup(std::string_view key) const;   // layers, db_, image
+    std::optional<std::string_view> lookup(std::string_view key, std::uint64_t h) const; // h = db_ hash
+    /* lookup() without touch(): for the database's own reads (publishing
+       a commit, checking a holder) that must not count as a use */
+    std::optional<std::string_view> peek(std::string_view key) const;
+    std::optional<std::string_view> resolve(std::string_view key, std::uint64_t h, bool use) const;
+    KeyTable::iterator  promote(std::string_view key);        // image key → db_
+    void keyAdded(std::string_view key) {      // after every insert into db_ …
+        keyHeap_ += heapBytes(key.size());
+        if (ordered_) ordered_->insert(key);
+    }
+    void keyDropped(std::string_view key) {    // … and every erase
+        keyHeap_ -= heapBytes(key.size());
+        if (ordered_) ordered_->erase(key);
+    }
+    void touch(const Entry& e) const {
+        std::atomic_ref<std::uint8_t> ref(e.ref);
+        if (memLimit_ && !ref.load(std::memory_order_relaxed)) ref.store(1, std::memory_order_relaxed);
+    }
+    /* load + store, not a locked add: concurrent readers of one shard may
+       lose an increment, the read path stays free of bus locks */
+    static void bump(std::uint64_t& c, std::uint64_t n) {
+        std::atomic_ref<std::uint64_t> r(c);
+        r.store(r.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+    void noteReads(std::uint64_t hits, std::uint64_t misses) const {
+        if (hits)   bump(hits_, hits);
+        if (misses) bump(misses_, misses);
+    }
+    bool pinned(std::string_view key, const Entry& e) const;     // written by an open txn
+    /* before an entry's value changes or it is erased: copy it out if the
+       running snapshot has not handed it out yet */
+    void preserve(std::string_view key, Entry& e) {
+        if (walk_ && e.snap != phase_) save(key, e);
+    }
+    void save(std::string_view key, Entry& e);
+    void keep(std::string_view key, std::string_view val);   // append to the saved pairs
+    bool imageWalked(std::string_view key) const;   // the snapshot's image walk passed key
+    using PairSink = void (*)(void* ctx, std::string_view key, std::string_view val);
+    bool snapshotStep(std::size_t budget, PairSink sink, void* ctx);
+    std::size_t undoBytes() const;              // undo logs or overlay layers
+    void enforceLimit() { if (memLimit_ && memoryUsage() > memLimit_) evict(); }
+    void evict();                               // until under the limit
+    bool evictOne();                            // false ⇒ only pinned keys left
+    void makeRoom();                            // before a new key: avoid doubling db_
+    bool setBase(std::string_view key, std::string_view val);   // true ⇒ db_ changed
+    bool setBase(std::string_view key, std::string_view val, std::uint64_t h,
+                 std::uint64_t deadline = 0);
+    bool delBase(std::string_view key);
+    bool delBase(std::string_view key, std::uint64_t h);
+    void reserveUndo(std::size_t n);            // room for n more records in the top log
+    template <class KeyAt, class F>
+    void prefetched(std::size_t n, KeyAt&& keyAt, F&& f) const;   // f(i, db_ hash of key i)
+    void publishAutocommit(std::string_view key, bool changed);
+    TxnStatus commitAll();                      // COMMIT without the op counter
+    template <class KeyRange>
+    void publishCommit(const KeyRange& keys);   // net changes of a COMMIT
+    void setOverlay(std::string_view key, std::string_view val, std::uint64_t deadline = 0);
+    bool delOverlay(std::string_view key);      // true ⇒ key was visible
+    static void countDelta(Layer& l, std::string_view val, std::ptrdiff_t d);
 
 public:
+    explicit InMemoryDB(TxnMode mode = TxnMode::UndoLog) : mode_(mode) {}
+    /* serve reads from a checkpoint image; keys are promoted on first write */
+    explicit InMemoryDB(std::shared_ptr<const Checkpoint> image,
+                        TxnMode mode = TxnMode::UndoLog);
+
     /* data commands */
-    void                       set  (const std::string& key,
-                                     const std::string& val);
-    std::optional<std::string> get  (const std::string& key) const;
-    void                       del  (const std::string& key);
-    std::size_t                count(const std::string& val) const;
+    void                       set  (std::string_view key,
+                                     std::string_view val);
+    std::optional<std::string> get  (std::string_view key) const;
+    void                       del  (std::string_view key);
+    std::size_t                count(std::string_view val) const;
+
+    /* add delta to the key's value read as a decimal int64 (absent ⇒ 0) and
+       store the sum, keeping any TTL.  nullopt – and no change – if the
+       value is not a canonical integer or the sum overflows. */
+    std::optional<std::int64_t> incr(std::string_view key, std::int64_t delta = 1);
+
+    /* expiring keys; ttl ≤ 0 is treated as 1 ms */
+    void set(std::string_view key, std::string_view val, std::chrono::milliseconds ttl);
+    std::optional<std::chrono::milliseconds> ttl(std::string_view key) const;   // remaining
+    std::size_t expire(std::size_t budget = 1024);   // #keys deleted
+
+    /* borrowed reads: no copy, valid until the next mutation */
+    std::optional<std::string_view> getView(std::string_view key) const;
+
+    template <class F>              // f(std::string_view) if key present
+    bool visit(std::string_view key, F&& f) const {
+        auto v = lookup(key);
+        noteReads(v.has_value(), !v);
+        if (!v) return false;
+        f(*v);
+        return true;
+    }
+
+    /* batched commands – same results as a loop of the scalar calls, but
+       the keys' buckets are prefetched ahead of the probes.  Outside a
+       transaction an MSET / MDEL is reported to the observer as ONE
+       commit.  mgetView's views follow the getView() rules. */
+    std::vector<std::optional<std::string>> mget(std::span<const std::string_view> keys) const;
+    void        mgetView(std::span<const std::string_view> keys,
+                         std::span<std::optional<std::string_view>> out) const;
+    void        mset(std::span<const std::pair<std::string_view, std::string_view>> kvs);
+    std::size_t mdel(std::span<const std::string_view> keys);     // #keys removed
+
+    /* ordered reads: at most `limit` visible keys in [from, to) (to empty ⇒
+       unbounded) or with the given prefix, starting at cursor (empty ⇒ from
+       the beginning); O(log N + page) with the ordered index */
+    ScanPage scan     (std::string_view prefix, std::size_t limit,
+                       std::string_view cursor = {}) const;
+    ScanPage scanRange(std::string_view from, std::string_view to, std::size_t limit,
+                       std::string_view cursor = {}) const;
+
+    /* keys whose value is val, in no particular order: f(std::string_view)
+       for at most `limit` of them, returns how many.  f must not modify
+       the database.  See "Value index" above. */
+    template <class F>
+    std::size_t keysWithValue(std::string_view val, std::size_t limit, F&& f) const {
+        auto sink = [](void* ctx, std::string_view key) { (*static_cast<decltype(&f)>(ctx))(key); };
+        return holdersOf(val, limit, sink, const_cast<void*>(static_cast<const void*>(&f)));
+    }
+    std::vector<std::string> keysWithValue(std::string_view val, std::size_t limit) const;
 
     /* transaction commands */
     void       begin();
     TxnStatus  rollback();      // Ok | NoTransaction (if stack empty)
     TxnStatus  commit();        // Ok | NoTransaction (same behaviour)
-};
\ No newline at end of file
+    /* ends only the innermost level, keeping its writes: they become part
+       of the parent and are undone by the parent's ROLLBACK.  With a
+       single level open this is COMMIT. */
+    TxnStatus  release();       // Ok | NoTransaction (same behaviour)
+
+    /* commit notifications (nullptr detaches; not owned) */
+    void setCommitObserver(CommitObserver* o) { observer_ = o; }
+
+    /* time source for TTLs in ms (monotonic); nullptr ⇒ steady_clock */
+    void setClock(std::function<std::uint64_t()> nowMs) { clock_ = std::move(nowMs); }
+
+    /* reads served outside this object: asked about every unreferenced
+       eviction candidate; true ⇒ it was read since (the hook clears its own
+       bit) and gets a second chance.  nullptr detaches. */
+    void setReferenceHook(std::function<bool(std::string_view key)> f) { refHook_ = std::move(f); }
+
+    /* build (O(N log N)) or drop the ordered key index; allowed anytime */
+    void setOrderedIndex(bool on);
+
+    /* build (O(N)) or drop the value → keys index; allowed anytime */
+    void setValueIndex(bool on);
+
+    /* memory ceiling in bytes, 0 ⇒ none; evicts at once if already above
+       through the CLOCK hand */
+    void        setMemoryLimit(std::size_t bytes);
+    std::size_t memoryLimit() const { return memLimit_; }
+    std::size_t memoryUsage() const;
+    CacheStats  cacheStats()  const;
+
+    /* background snapshots (copy-on-write): beginSnapshot() freezes the
+       committed state – std::logic_error inside a transaction or while
+       one runs; snapshotStep() calls f(key, val) for at most
+       `budget` pairs of it and returns false once all were handed out.
+       The views in f are valid during the call only.  endSnapshot()
+       abandons a running snapshot (O(N) if its walk is unfinished). */
+    void beginSnapshot();
+    template <class F>
+    bool snapshotStep(std::size_t budget, F&& f) {
+        auto sink = [](void* ctx, std::string_view k, std::string_view v) {
+            (*static_cast<decltype(&f)>(ctx))(k, v);
+        };
+        return snapshotStep(budget, sink, const_cast<void*>(static_cast<const void*>(&f)));
+    }
+    void        endSnapshot();
+    bool        snapshotting()  const { return walk_.has_value(); }
+    std::size_t snapshotBytes() const;          // saved pre-images
+
+    /* per-operation counters, sampled latencies and gauges (see DbStats.h);
+       the counters are all zero when built with INMEMORYDB_STATS=0 */
+    DbStats     stats() const;
+    void        resetStats();
+
+    /* introspection */
+    TxnMode     txnMode()        const { return mode_; }
+    std::size_t internedValues() const { return valueIds_.size(); }
+    std::size_t promotedKeys()   const { return shadowed_.size(); }
+    bool        orderedIndex()   const { return ordered_.has_value(); }
+    bool        valueIndex()     const { return byValue_.has_value(); }
+    std::size_t expiringKeys()   const { return expires_.size(); }
+    std::size_t expiredKeys()    const { return expired_; }
+};
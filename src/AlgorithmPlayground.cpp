@@ -3,6 +3,48 @@
 #include "inMemoryDb.h"
 #include "BitonicTSPSolver.h"
 #include "LexiPathEngine.h"
+#include "FlatHashMap.h"
+#include "IncrementalHashMap.h"
+#include "BPlusTree.h"
+#include "TimingWheel.h"
+#include "ShardedInMemoryDB.h"
+#include "EpochDomain.h"
+#include "MvccInMemoryDB.h"
+#include "WriteAheadLog.h"
+#include "ChangeStream.h"
+#include "Checkpoint.h"
+#include "BackgroundSnapshot.h"
+#include "CommandProcessor.h"
+#include "DbServer.h"
+#include "AllocCounter.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <random>
+#include <map>
+#include <set>
+#include <thread>
+#include <unordered_map>
+
+#ifdef __linux__
+#  include <arpa/inet.h>
+#  include <netinet/in.h>
+#  include <poll.h>
+#  include <sys/socket.h>
+#  include <unistd.h>
+#endif
+
+/* ───────────── heap-allocation counter ─────────────
+   AllocCounter.h replaces global operator new/delete for the test runner
+   so tests can assert that a code path performs no heap allocations. */
+static std::atomic<std::size_t> g_allocCount{0};
+
+void onHeapAllocation() noexcept { g_allocCount.fetch_add(1, std::memory_order_relaxed); }
+
+static std::size_t allocCount() { return g_allocCount.load(std::memory_order_relaxed); }
 
 // A simple struct to bundle each ClosestPairSolver test
 struct TestCase {
@@ -25,6 +67,18 @@ struct DbTestCase {
       , expected(std::move(e)) {}
 };
 
+/* numbered result lines of one suite: "<suite> Test <n>: <name>: PASS" */
+struct SuiteReport {
+    explicit SuiteReport(const char* suite) : suite_(suite) {}
+    void operator()(const std::string& name, bool pass) {
+        std::cout << suite_ << " Test " << ++testNo_ << ": " << name << ": "
+                  << (pass ? "PASS" : "FAIL") << "\n";
+    }
+private:
+    const char* suite_;
+    int         testNo_ = 0;
+};
+
 // TestCase struct to group input and expected output
 typedef std::vector<std::vector<double>> Arr;
 struct BitonicTestCase {
@@ -135,13 +189,45 @@ static void runInMemoryDbTests() {
             {"SET","BEGIN","COUNT","BEGIN","DELETE","COUNT","ROLLBACK","COUNT"},
             {{"a","10"},{},{"10"},{},{"a"},{"10"},{},{"10"}},
             {nullopt,nullopt,"1",nullopt,nullopt,"0",nullopt,"1"}
+        },
+        /* Example 7 (overwrites move counts between values, nested undo) */
+        {
+            {"SET","SET","BEGIN","SET","BEGIN","SET","COUNT","COUNT","ROLLBACK","COUNT","ROLLBACK","COUNT","COUNT","GET"},
+            {{"a","10"},{"b","10"},{},{"a","20"},{},{"b","20"},{"20"},{"10"},{},{"20"},{},{"10"},{"20"},{"a"}},
+            {nullopt,nullopt,nullopt,nullopt,nullopt,nullopt,"2","0",nullopt,"1",nullopt,"2","0","10"}
+        },
+        /* Example 8 (value dropped and re-interned inside a txn) */
+        {
+            {"BEGIN","SET","DELETE","SET","SET","COUNT","ROLLBACK","GET","COUNT","COUNT","SET","COUNT"},
+            {{},{"a","x"},{"a"},{"b","y"},{"a","y"},{"y"},{},{"a"},{"x"},{"y"},{"c","x"},{"x"}},
+            {nullopt,nullopt,nullopt,nullopt,nullopt,"2",nullopt,"NULL","0","0",nullopt,"1"}
+        },
+        /* Example 9 (parent rewrites a key after its child rolled back) */
+        {
+            {"SET","BEGIN","SET","BEGIN","SET","DELETE","SET","ROLLBACK","GET","SET","SET","ROLLBACK","GET","COUNT","COUNT"},
+            {{"a","1"},{},{"a","2"},{},{"a","3"},{"a"},{"a","4"},{},{"a"},{"a","5"},{"a","6"},{},{"a"},{"6"},{"1"}},
+            {nullopt,nullopt,nullopt,nullopt,nullopt,nullopt,nullopt,nullopt,"2",nullopt,nullopt,nullopt,"1","0","1"}
+        },
+        /* Example 10 (released child is undone by the parent's rollback) */
+        {
+            {"SET","BEGIN","SET","BEGIN","SET","SET","DELETE","RELEASE","GET","GET","COUNT","ROLLBACK","GET","GET","COUNT","RELEASE"},
+            {{"a","1"},{},{"a","2"},{},{"a","3"},{"b","3"},{"a"},{},{"a"},{"b"},{"3"},{},{"a"},{"b"},{"1"},{}},
+            {nullopt,nullopt,nullopt,nullopt,nullopt,nullopt,nullopt,nullopt,"NULL","3","1",nullopt,"1","NULL","1","NO TRANSACTION"}
+        },
+        /* Example 11 (release of the outermost level commits) */
+        {
+            {"BEGIN","SET","BEGIN","SET","RELEASE","BEGIN","DELETE","RELEASE","RELEASE","GET","GET","ROLLBACK"},
+            {{},{"a","1"},{},{"b","2"},{},{},{"a"},{},{},{"a"},{"b"},{}},
+            {nullopt,nullopt,nullopt,nullopt,nullopt,nullopt,nullopt,nullopt,nullopt,"NULL","2","NO TRANSACTION"}
         }
     };
 
-    /* ---------------- execute the tests ---------------- */
+    /* ---------- execute the tests (every session in both txn modes) ---------- */
+    for (TxnMode mode : { TxnMode::UndoLog, TxnMode::Overlay })
     for (size_t tc = 0; tc < tests.size(); ++tc) {
-        std::cout << "Running DB Test Case " << tc + 1 << ":\n";
-        InMemoryDB db;
+        std::cout << "Running DB Test Case " << tc + 1
+                  << (mode == TxnMode::Overlay ? " (overlay)" : " (undo log)") << ":\n";
+        InMemoryDB db(mode);
 
         for (size_t i = 0; i < tests[tc].ops.size(); ++i) {
             const string& op   = tests[tc].ops[i];
@@ -193,13 +279,2085 @@ static void runInMemoryDbTests() {
                     std::cout << "  COMMIT() -> null\n";
                 }
             }
+            else if (op == "RELEASE") {
+                TxnStatus st = db.release();
+                if (st == TxnStatus::NoTransaction) {
+                    pass = (exp && *exp == "NO TRANSACTION");
+                    std::cout << "  RELEASE() -> NO TRANSACTION"
+                              << (exp ? (pass ? " [PASS]" : " [FAIL]") : "") << '\n';
+                } else {
+                    std::cout << "  RELEASE() -> null\n";
+                }
+            }
             else {
                 std::cerr << "  Unknown operation: " << op << '\n';
             }
         }
         std::cout << '\n';
     }
+
+    /* ---------------- value pool reclamation ---------------- */
+    {
+        InMemoryDB db;
+        for (int i = 0; i < 1000; ++i) db.set("k" + std::to_string(i % 10), "v" + std::to_string(i));
+        db.begin();
+        for (int i = 0; i < 10; ++i) db.set("k" + std::to_string(i), "tmp");
+        bool pinned = db.internedValues() == 11;       // 10 logged olds + "tmp"
+        db.rollback();
+        bool pass = pinned && db.internedValues() == 10 && db.count("v999") == 1;
+        std::cout << "Value pool reclaim: " << (pass ? "PASS" : "FAIL")
+                  << " (interned " << db.internedValues() << ")\n\n";
+    }
+
+    /* ---------------- allocation-free read path ---------------- */
+    {
+        InMemoryDB db;
+        const std::string longVal(100, 'x');            // well past SSO
+        for (int i = 0; i < 1000; ++i)
+            db.set("key:" + std::to_string(i), i % 2 ? longVal : "short");
+
+        // callers hold parsed buffers, not std::strings
+        const char buf[] = "key:123 key:999 key:nope";
+        std::string_view hit1(buf, 7), hit2(buf + 8, 7), miss(buf + 16, 8);
+
+        std::size_t before = allocCount(), bytes = 0, found = 0;
+        for (int i = 0; i < 10000; ++i) {
+            if (auto v = db.getView(hit1)) bytes += v->size();
+            db.visit(hit2, [&](std::string_view v) { bytes += v.size(); });
+            found += db.getView(miss).has_value();
+            found += db.count(std::string_view(longVal));
+        }
+        db.set(hit1, "short");                          // overwrite with interned value
+        db.del(miss);                                   // delete of absent key
+        std::size_t allocs = allocCount() - before;
+
+        before = allocCount();                          // sanity: the copying get()
+        bool counted = db.get(hit2).has_value() && allocCount() > before;   // is seen
+
+        bool pass = allocs == 0 && counted && bytes == 10000 * 200 && found == 10000 * 500;
+        std::cout << "Zero-alloc reads: " << (pass ? "PASS" : "FAIL")
+                  << " (" << allocs << " allocations in 40000 reads)\n\n";
+    }
+
+    /* ---------------- allocation-free short transactions ---------------- */
+    {
+        InMemoryDB db;
+        std::vector<std::string> keys;                  // past SSO: the undo log copies them
+        /* overwrites only: a rolled-back DELETE puts the key back into db_,
+           which stores its own copy */
+        for (int i = 0; i < 64; ++i) keys.push_back("account:" + std::to_string(i) + ":balance");
+        for (auto& k : keys) db.set(k, "0");
+        auto churn = [&](int rounds) {
+            for (int r = 0; r < rounds; ++r) {
+                for (int d = 0; d < 3; ++d) {           // nested levels
+                    db.begin();
+                    for (int i = 0; i < 8; ++i) db.set(keys[(r * 8 + d * 3 + i) % 64], i % 2 ? "1" : "2");
+                }
+                db.rollback();
+                if (r % 2) db.commit(); else { db.rollback(); db.rollback(); }
+            }
+        };
+        churn(4);                                       // warm the frames and the key arena
+        std::size_t before = allocCount();
+        churn(1000);
+        std::size_t allocs = allocCount() - before;
+        bool pass = allocs == 0 && db.get(keys[0]).has_value() && db.stats().undoBytes == 0;
+        std::cout << "Zero-alloc transactions: " << (pass ? "PASS" : "FAIL")
+                  << " (" << allocs << " allocations in 3000 levels)\n\n";
+    }
+
+    /* ---------------- RELEASE against a stack of full copies ---------------- */
+    for (TxnMode mode : { TxnMode::UndoLog, TxnMode::Overlay }) {
+        InMemoryDB db(mode);
+        std::vector<std::map<std::string, std::string>> model(1);   // model[0] = committed
+        std::mt19937 rng(mode == TxnMode::Overlay ? 31 : 30);
+        bool pass = true;
+        for (int step = 0; step < 20000 && pass; ++step) {
+            const std::string key = "k" + std::to_string(rng() % 16);
+            const std::string val = "v" + std::to_string(rng() % 6);
+            auto& cur = model.back();
+            switch (rng() % 10) {
+            case 0: case 1: case 2: db.set(key, val); cur[key] = val; break;
+            case 3:                 db.del(key); cur.erase(key); break;
+            case 4: if (model.size() < 6) { db.begin(); model.push_back(model.back()); } break;
+            case 5: db.rollback(); if (model.size() > 1) model.pop_back(); break;
+            case 6: case 7:                             // keep the writes, drop the level
+                db.release();
+                if (model.size() > 1) { model[model.size() - 2] = model.back(); model.pop_back(); }
+                break;
+            case 8: if (rng() % 4 == 0) { db.commit(); model.front() = model.back(); model.resize(1); } break;
+            default: {
+                auto it = model.back().find(key);
+                pass = db.get(key) == (it == model.back().end() ? std::nullopt
+                                                                : std::optional<std::string>(it->second));
+                std::size_t n = 0;
+                for (auto& kv : model.back()) n += kv.second == val;
+                pass = pass && db.count(val) == n;
+            }
+            }
+            pass = pass && db.stats().txnDepth == model.size() - 1;
+        }
+        while (db.rollback() == TxnStatus::Ok) model.pop_back();
+        for (int i = 0; i < 16 && pass; ++i) {          // unwinding lands on the committed state
+            const std::string key = "k" + std::to_string(i);
+            auto it = model.front().find(key);
+            pass = db.get(key) == (it == model.front().end() ? std::nullopt
+                                                             : std::optional<std::string>(it->second));
+        }
+
+        /* the parent keeps one record per key: released children rewriting
+           the same keys leave its undo log and the pool as they were */
+        InMemoryDB dedupe(mode);
+        for (int i = 0; i < 32; ++i) dedupe.set("key" + std::to_string(i), "base");
+        dedupe.begin();
+        for (int i = 0; i < 32; ++i) dedupe.set("key" + std::to_string(i), "parent");
+        const std::size_t undo = dedupe.stats().undoBytes, pool = dedupe.internedValues();
+        for (int r = 0; r < 1000; ++r) {
+            dedupe.begin();
+            for (int i = 0; i < 32; ++i) dedupe.set("key" + std::to_string(i), r % 2 ? "odd" : "even");
+            dedupe.release();
+        }
+        bool flat = (mode == TxnMode::Overlay || dedupe.stats().undoBytes == undo)
+                 && dedupe.internedValues() <= pool + 2 && dedupe.get("key7") == "odd";
+        dedupe.rollback();
+        flat = flat && dedupe.get("key7") == "base" && dedupe.count("base") == 32
+            && dedupe.internedValues() == 1;
+
+        std::cout << "Release" << (mode == TxnMode::Overlay ? " (overlay)" : " (undo log)")
+                  << ": " << (pass && flat ? "PASS" : "FAIL") << "\n\n";
+    }
+
+    /* ---------------- batched commands vs scalar loop ---------------- */
+    for (TxnMode mode : { TxnMode::UndoLog, TxnMode::Overlay }) {
+        struct Recorder : CommitObserver {
+            std::size_t commits = 0, changes = 0;
+            void onCommit(std::span<const CommittedChange> c) override { ++commits; changes += c.size(); }
+        } rec;
+        InMemoryDB batch(mode), scalar(mode);
+        batch.setCommitObserver(&rec);
+
+        std::vector<std::string> keys;
+        for (int i = 0; i < 300; ++i) keys.push_back("k" + std::to_string(i % 250));   // dupes
+        std::vector<std::string_view> views(keys.begin(), keys.end());
+        std::vector<std::pair<std::string_view, std::string_view>> kvs;
+        for (std::size_t i = 0; i < keys.size(); ++i) kvs.emplace_back(keys[i], i % 3 ? "a" : "b");
+
+        batch.mset(kvs);                                 // one autocommit
+        for (auto& [k, v] : kvs) scalar.set(k, v);
+        bool oneCommit = rec.commits == 1 && rec.changes == 250;
+
+        batch.begin(); scalar.begin();
+        std::size_t removed = batch.mdel(std::span(views).subspan(0, 100));
+        for (std::size_t i = 0; i < 100; ++i) scalar.del(views[i]);
+        batch.mset(std::span(kvs).subspan(200));
+        for (std::size_t i = 200; i < kvs.size(); ++i) scalar.set(kvs[i].first, kvs[i].second);
+        bool midTxn = batch.mget(views) == scalar.mget(views);
+        batch.rollback(); scalar.rollback();
+
+        std::vector<std::string_view> probe(views);
+        probe.push_back("missing");
+        std::vector<std::optional<std::string_view>> got(probe.size());
+        batch.mgetView(probe, got);
+        bool same = midTxn && removed == 100 && rec.commits == 1 && !got.back();
+        for (std::size_t i = 0; i < views.size(); ++i) same = same && got[i] == scalar.getView(views[i]);
+        same = same && batch.count("a") == scalar.count("a") && batch.count("b") == scalar.count("b");
+
+        bool pass = oneCommit && same;
+        std::cout << "Batched ops" << (mode == TxnMode::Overlay ? " (overlay)" : " (undo log)")
+                  << ": " << (pass ? "PASS" : "FAIL") << "\n\n";
+        batch.setCommitObserver(nullptr);
+    }
+}
+
+// Randomised differential test: FlatHashMap must agree with std::unordered_map
+// after every operation, including tombstone-heavy erase/reinsert churn.
+static void runFlatHashMapTests() {
+    struct Case {
+        std::string name;
+        std::size_t ops;
+        std::size_t keySpace;     // small key space ⇒ many erase/reinsert hits
+        unsigned    seed;
+    };
+    std::vector<Case> tests = {
+        { "Small key space churn",    20000,    64, 1 },
+        { "Growth through rehashes", 200000, 50000, 2 },
+        { "Erase-heavy tombstones",  100000,  2000, 3 }
+    };
+
+    for (std::size_t t = 0; t < tests.size(); ++t) {
+        const auto& tc = tests[t];
+        std::mt19937 rng(tc.seed);
+        FlatHashMap<std::string, int>        flat;
+        std::unordered_map<std::string, int> ref;
+        bool pass = true;
+
+        for (std::size_t i = 0; i < tc.ops && pass; ++i) {
+            std::string key = "k" + std::to_string(rng() % tc.keySpace);
+            switch (rng() % 4) {
+            case 0:
+            case 1:
+                flat[key] = int(i);
+                ref[key]  = int(i);
+                break;
+            case 2:
+                pass = flat.erase(key) == ref.erase(key);
+                break;
+            default: {
+                auto f = flat.find(key);
+                auto r = ref.find(key);
+                pass = (f == flat.end()) == (r == ref.end()) &&
+                       (f == flat.end() || f->second == r->second);
+            }
+            }
+            pass = pass && flat.size() == ref.size();
+        }
+        std::size_t visited = 0;
+        for (const auto& kv : flat) {
+            auto r = ref.find(kv.first);
+            pass = pass && r != ref.end() && r->second == kv.second;
+            ++visited;
+        }
+        pass = pass && visited == ref.size();
+
+        std::cout << "FlatHashMap Test " << (t + 1) << ": " << tc.name << ": "
+                  << (pass ? "PASS" : "FAIL") << " (size " << flat.size()
+                  << ", capacity " << flat.capacity() << ")\n";
+    }
+
+    /* dropDeletes() on a table dense with tombstones.  The hash sends every
+       key to one of five start groups, so each probe chain runs through
+       several groups and the rebuild has to move slots across them. */
+    struct ClumpHash {
+        std::size_t operator()(int k) const { return static_cast<std::size_t>(k % 5) * 0x9E3779B97F4A7C15ull; }
+    };
+    FlatHashMap<int, std::string, ClumpHash> flat;
+    std::unordered_map<int, std::string>     ref;
+    std::mt19937 rng(4);
+    for (int k = 0; k < 400; ++k) flat[k] = ref[k] = "v" + std::to_string(k);
+    for (int k = 0; k < 400; ++k)
+        if (rng() % 10 < 7) { flat.erase(k); ref.erase(k); }
+    auto same = [&] {
+        bool ok = flat.size() == ref.size();
+        std::size_t visited = 0;
+        for (const auto& kv : flat) {
+            auto r = ref.find(kv.first);
+            ok = ok && r != ref.end() && r->second == kv.second;
+            ++visited;
+        }
+        for (int k = 0; k < 600; ++k) {
+            auto f = flat.find(k);
+            auto r = ref.find(k);
+            ok = ok && (f == flat.end()) == (r == ref.end()) && (f == flat.end() || f->second == r->second);
+        }
+        return ok && visited == ref.size();
+    };
+    const std::size_t cap = flat.capacity(), left = flat.growthLeft();
+    flat.dropDeletes();
+    bool pass = same() && flat.capacity() == cap && flat.growthLeft() > left
+             && flat.growthLeft() == cap - cap / 8 - flat.size();
+    for (int k = 400; k < 600; ++k) flat[k] = ref[k] = "w" + std::to_string(k);
+    pass = pass && same() && flat.capacity() == cap;   // reclaimed room, no growth
+    std::cout << "FlatHashMap Test " << (tests.size() + 1) << ": dropDeletes across groups: "
+              << (pass ? "PASS" : "FAIL") << " (size " << flat.size()
+              << ", capacity " << flat.capacity() << ")\n";
+}
+
+static void runIncrementalHashMapTests() {
+    SuiteReport report("IncrementalHashMap");
+    using Map = IncrementalHashMap<std::string, int, StringHash, std::equal_to<>>;
+
+    for (std::size_t keySpace : { std::size_t(300000), std::size_t(3000) }) {
+        std::mt19937 rng(static_cast<unsigned>(keySpace));
+        Map                                  inc;
+        std::unordered_map<std::string, int> ref;
+        bool pass = true, sawResize = false;
+        for (std::size_t i = 0; i < 400000 && pass; ++i) {
+            std::string key = "k" + std::to_string(rng() % keySpace);
+            switch (rng() % 4) {
+            case 0:
+            case 1:
+                inc.try_emplace(key, 0).first->second = int(i);
+                ref[key] = int(i);
+                break;
+            case 2:
+                pass = inc.erase(std::string_view(key)) == ref.erase(key);
+                break;
+            default: {
+                auto f = inc.find(std::string_view(key));
+                auto r = ref.find(key);
+                pass = (f == inc.end()) == (r == ref.end()) && (f == inc.end() || f->second == r->second);
+            }
+            }
+            pass = pass && inc.size() == ref.size();
+            sawResize = sawResize || inc.resizing();
+        }
+        std::size_t visited = 0;
+        for (const auto& [k, v] : inc) {
+            auto r = ref.find(k);
+            pass = pass && r != ref.end() && r->second == v;
+            ++visited;
+        }
+        report(keySpace > 10000 ? "Growth: matches unordered_map across resizes"
+                                : "Churn: tombstone rebuilds stay incremental",
+               pass && sawResize && visited == ref.size());
+    }
+
+    {
+        static std::size_t moves = 0;
+        struct Counted {
+            int v = 0;
+            Counted() = default;
+            explicit Counted(int x) : v(x) {}
+            Counted(Counted&& o) noexcept : v(o.v) { ++moves; }
+            Counted& operator=(Counted&& o) noexcept { v = o.v; ++moves; return *this; }
+        };
+        IncrementalHashMap<std::string, Counted, StringHash, std::equal_to<>> inc;
+        FlatHashMap<std::string, Counted>                                     flat;
+        std::size_t worstInc = 0, worstFlat = 0;
+        for (int i = 0; i < 200000; ++i) {
+            std::string key = "key" + std::to_string(i);
+            std::size_t before = moves;
+            const bool  small  = inc.capacity() < Map::kMinCapacity;   // rehashes at once
+            inc.try_emplace(key, i);
+            if (!small) worstInc = std::max(worstInc, moves - before);
+            before = moves;
+            flat.try_emplace(key, i);
+            worstFlat = std::max(worstFlat, moves - before);
+        }
+        bool pass = worstInc <= Map::kStepSlots && worstFlat >= 100000 && inc.size() == 200000;
+        report("An insert moves at most kStepSlots entries (inc: " + std::to_string(worstInc) + ", flat: " + std::to_string(worstFlat) + ")", pass);
+    }
+
+    {
+        Map inc;
+        for (int i = 0; i < 5000; ++i) inc.try_emplace("key" + std::to_string(i), i);
+        while (!inc.resizing()) inc.try_emplace("more" + std::to_string(inc.size()), 0);
+        for (int i = 0; i < 40; ++i) inc.try_emplace("mid" + std::to_string(i), 0);
+        const std::size_t total = inc.size();
+        bool midResize = inc.resizing();
+        std::size_t seen = 0;                        // a CLOCK-style hand: erase every other key
+        for (std::size_t slot = 0;;) {
+            auto it = inc.fromSlot(slot);
+            if (it == inc.end()) break;
+            slot = it.slotIndex() + 1;
+            if (seen++ % 2 == 0) inc.erase(it);
+        }
+        std::size_t left = 0;
+        for (auto it = inc.begin(); it != inc.end(); ++it) ++left;
+        report("Slot cursor covers both tables during a resize",
+               midResize && seen == total && left == total / 2 && inc.size() == left);
+    }
+}
+
+// Concurrent writers/readers on disjoint and shared keys; afterwards every
+// key must hold its last value and COUNT must add up across shards.
+static void runShardedDbTests() {
+    struct Case {
+        std::string name;
+        std::size_t shards;
+        unsigned    threads;
+        int         keysPerThread;
+    };
+    std::vector<Case> tests = {
+        { "Single shard, 4 threads",  1, 4, 2000 },
+        { "64 shards, 8 threads",    64, 8, 5000 }
+    };
+
+    for (std::size_t t = 0; t < tests.size(); ++t) {
+        const auto& tc = tests[t];
+        ShardedInMemoryDB db(tc.shards);
+        std::atomic<bool> readsOk{true};
+
+        std::vector<std::thread> workers;
+        for (unsigned w = 0; w < tc.threads; ++w) {
+            workers.emplace_back([&, w] {
+                std::string own = "t" + std::to_string(w) + ":";
+                for (int i = 0; i < tc.keysPerThread; ++i) {
+                    std::string key = own + std::to_string(i);
+                    db.set(key, "tmp");
+                    db.set(key, i % 2 ? "odd" : "even");
+                    if (i % 3 == 0) db.del(key);
+                    auto v = db.get(key);
+                    if (i % 3 == 0 ? v.has_value() : !v) readsOk = false;
+                    db.set("shared", own);                  // contended key
+                }
+            });
+        }
+        for (auto& th : workers) th.join();
+
+        std::size_t live = 0, odd = 0;
+        for (int i = 0; i < tc.keysPerThread; ++i)
+            if (i % 3) { ++live; odd += i % 2; }
+        live *= tc.threads;
+        odd  *= tc.threads;
+
+        auto shared = db.get("shared");
+        bool pass = readsOk
+                 && db.count("odd") == odd
+                 && db.count("even") == live - odd
+                 && db.count("tmp") == 0
+                 && shared && db.count(*shared) == 1;
+        std::cout << "ShardedDB Test " << (t + 1) << ": " << tc.name << ": "
+                  << (pass ? "PASS" : "FAIL") << " (shards " << db.shardCount() << ")\n";
+    }
+}
+
+// Epoch-based reclamation on its own, then ShardedInMemoryDB's lock-free
+// readers against writers that keep replacing and deleting their keys.
+static void runEpochTests() {
+    SuiteReport report("Epoch");
+
+    {
+        static std::atomic<int> freed{0};
+        auto del = [](void* p) { delete static_cast<int*>(p); ++freed; };
+        EpochDomain d;
+        std::atomic<int>  stage{0};
+        std::thread reader([&] {
+            EpochDomain::Guard g(d);
+            stage = 1;
+            while (stage != 2) std::this_thread::yield();
+        });
+        while (stage != 1) std::this_thread::yield();
+        bool pass = true;
+        {
+            RetireList list;
+            list.retire(d, new int(1), del);
+            for (int i = 0; i < 10; ++i) list.collect(d);
+            pass = freed == 0 && list.pending() == 1;           // the pinned reader holds it
+            stage = 2;
+            reader.join();
+            for (int i = 0; i < 3; ++i) list.collect(d);
+            pass = pass && freed == 1 && list.pending() == 0;
+            list.retire(d, new int(2), del);
+        }
+        pass = pass && freed == 2;                              // the list frees the rest
+        report("Retired objects outlive pinned readers only", pass);
+    }
+
+    {
+        ShardedInMemoryDB db(4);
+        std::atomic<bool> stop{false}, ok{true};
+        std::atomic<std::size_t> reads{0};
+        auto valueOf = [](int k, int gen) { return "key" + std::to_string(k) + "/" + std::to_string(gen); };
+        std::vector<std::thread> readers;
+        for (int r = 0; r < 3; ++r)
+            readers.emplace_back([&, r] {
+                std::mt19937 rng(r);
+                std::size_t n = 0;
+                while (!stop) {
+                    int  k = static_cast<int>(rng() % 512);
+                    auto v = db.get("key" + std::to_string(k));
+                    std::string prefix = "key" + std::to_string(k) + "/";
+                    if (v && v->compare(0, prefix.size(), prefix) != 0) ok = false;
+                    if (db.count("never") != 0) ok = false;
+                    ++n;
+                }
+                reads += n;
+            });
+        std::thread writer([&] {
+            for (int gen = 0; gen < 200; ++gen)
+                for (int k = 0; k < 512; ++k) {
+                    if ((k + gen) % 5 == 0) db.del("key" + std::to_string(k));
+                    else                    db.set("key" + std::to_string(k), valueOf(k, gen));
+                }
+        });
+        writer.join();
+        stop = true;
+        for (auto& t : readers) t.join();
+        std::size_t live = 0;
+        for (int k = 0; k < 512; ++k) live += (k + 199) % 5 != 0;
+        bool last = true;
+        for (int k = 0; k < 512; ++k) {
+            auto v = db.get("key" + std::to_string(k));
+            last = last && ((k + 199) % 5 == 0 ? !v : v == valueOf(k, 199));
+        }
+        CacheStats st = db.cacheStats();
+        report("Readers see whole values while a writer churns",
+               ok && last && db.count(valueOf(7, 199)) == 1
+               && st.hits + st.misses == reads + 512 && live > 0);
+    }
+
+    {
+        ShardedInMemoryDB db(2);
+        for (int i = 0; i < 100; ++i) db.set("k" + std::to_string(i), i % 2 ? "odd" : "even");
+        for (int round = 0; round < 20; ++round) {              // short-lived reader threads
+            std::thread t([&] { for (int i = 0; i < 100; ++i) db.get("k" + std::to_string(i)); });
+            t.join();
+        }
+        CacheStats st = db.cacheStats();
+        report("Exited threads hand back their records, tallies kept",
+               st.hits == 2000 && st.misses == 0 && db.count("odd") == 50 && db.count("even") == 50);
+    }
+}
+
+// Snapshot isolation, invisibility of uncommitted/rolled-back writes,
+// concurrent readers vs. a committing writer, and version GC.
+static void runMvccTests() {
+    SuiteReport report("MVCC");
+
+    for (TxnMode mode : { TxnMode::UndoLog, TxnMode::Overlay }) {
+        const std::string tag = mode == TxnMode::Overlay ? " (overlay)" : " (undo log)";
+        MvccInMemoryDB db(mode);
+        db.set("a", "1");
+        db.set("b", "1");
+        auto s1 = db.snapshot();
+        db.set("a", "2");
+        db.del("b");
+        db.begin();
+        db.set("c", "1");
+        auto s2 = db.snapshot();                         // c is not committed yet
+        db.rollback();
+        db.begin();
+        db.set("d", "2");
+        db.commit();
+        auto s3 = db.snapshot();
+
+        bool pass = s1.get("a") == "1" && s1.get("b") == "1" && s1.count("1") == 2
+                 && s1.count("2") == 0
+                 && s2.get("a") == "2" && !s2.get("b") && !s2.get("c") && s2.count("1") == 0
+                 && s3.get("d") == "2" && !s3.get("c") && s3.count("2") == 2
+                 && db.get("a") == "2";
+        report("Point-in-time views" + tag, pass);
+    }
+
+    {
+        MvccInMemoryDB db;
+        db.set("x", "0");
+        db.set("y", "0");
+        std::atomic<bool> stop{false}, consistent{true};
+        std::atomic<std::size_t> reads{0};
+
+        std::vector<std::thread> readers;
+        for (int r = 0; r < 3; ++r) {
+            readers.emplace_back([&] {
+                while (!stop) {
+                    auto snap = db.snapshot();
+                    auto x = snap.get("x");
+                    auto y = snap.get("y");
+                    // x and y are always written in the same txn
+                    if (!x || !y || *x != *y || snap.count(*x) != 2) consistent = false;
+                    ++reads;
+                }
+            });
+        }
+        while (reads == 0) std::this_thread::yield();    // readers are running
+        for (int i = 1; i <= 2000; ++i) {
+            db.begin();
+            db.set("x", std::to_string(i));
+            db.set("y", std::to_string(i));
+            db.commit();
+            if (i % 100 == 0) std::this_thread::yield();
+        }
+        stop = true;
+        for (auto& t : readers) t.join();
+        report("Concurrent snapshots see whole txns", consistent && reads > 0);
+    }
+
+    {
+        MvccInMemoryDB db;
+        auto pinned = db.snapshot();                     // holds ts 0
+        for (int i = 0; i < 500; ++i) db.set("k", i % 2 ? "odd" : "even");
+        std::size_t held = db.versionCount();
+        bool seesNothing = !pinned.get("k");
+        { auto drop = std::move(pinned); }               // release the old snapshot
+        db.collectGarbage();
+        // one version each left for k and COUNT(odd); COUNT(even) = 0 is dropped
+        report("GC frees versions below horizon",
+               seesNothing && held > 1000 && db.versionCount() == 2);
+    }
+
+    {
+        constexpr int kKeys = 1000;
+        MvccInMemoryDB db;
+        for (int i = 0; i < kKeys; ++i) db.set("k" + std::to_string(i), "v" + std::to_string(i));
+        db.collectGarbage();
+        const std::size_t full = db.chainCount();
+        auto pinned = db.snapshot();
+        for (int i = 0; i < kKeys; ++i) db.del("k" + std::to_string(i));
+        db.collectGarbage();                             // pinned still reads every key
+        bool pass = full == 2 * kKeys && db.chainCount() == full
+                 && pinned.get("k7") == "v7" && pinned.count("v7") == 1;
+        { auto drop = std::move(pinned); }
+        db.collectGarbage();
+        pass = pass && db.chainCount() == 0 && db.versionCount() == 0;
+
+        std::atomic<bool> stop{false}, ok{true};
+        std::thread reader([&] {
+            while (!stop) {
+                auto snap = db.snapshot();
+                for (int i = 0; i < 50; ++i) {
+                    auto v = snap.get("t" + std::to_string(i));
+                    if (v && *v != "x" + std::to_string(i)) ok = false;
+                }
+            }
+        });
+        for (int round = 0; round < 200; ++round) {
+            for (int i = 0; i < 50; ++i) db.set("t" + std::to_string(i), "x" + std::to_string(i));
+            for (int i = 0; i < 50; ++i) db.del("t" + std::to_string(i));
+            db.collectGarbage();
+        }
+        stop = true;
+        reader.join();
+        db.collectGarbage();
+        report("GC drops chains of deleted keys", pass && ok && db.chainCount() == 0);
+    }
+}
+
+static void runWalTests() {
+    SuiteReport report("WAL");
+    namespace fs = std::filesystem;
+    const std::string path = (fs::temp_directory_path() / "algoplayground_wal_test.log").string();
+
+    for (Durability d : { Durability::None, Durability::Async, Durability::Group,
+                          Durability::PerCommit }) {
+        fs::remove(path);
+        {
+            WriteAheadLog wal(path, { d, std::chrono::microseconds(200) });
+            InMemoryDB db;
+            db.setCommitObserver(&wal);
+            db.set("a", "1");
+            db.set("b", "1");
+            db.del("a");
+            db.begin();
+            db.set("c", "2");
+            db.set("b", "2");
+            db.commit();
+            db.begin();
+            db.set("lost", "9");                        // rolled back: never logged
+            db.rollback();
+            db.setCommitObserver(nullptr);
+        }
+        InMemoryDB restored;
+        std::size_t n = WriteAheadLog::replay(path, restored);
+        bool pass = n == 4 && !restored.get("a") && restored.get("b") == "2"
+                 && restored.get("c") == "2" && !restored.get("lost")
+                 && restored.count("2") == 2 && restored.count("1") == 0;
+        static const char* names[] = { "none", "async", "group", "per-commit" };
+        report(std::string("Replay restores committed state (") +
+               names[static_cast<int>(d)] + ")", pass);
+    }
+
+    {
+        fs::remove(path);
+        {
+            WriteAheadLog wal(path, { Durability::None, {} });
+            InMemoryDB db;
+            db.setCommitObserver(&wal);
+            db.set("k", "v");
+            db.setCommitObserver(nullptr);
+        }
+        auto intact = fs::file_size(path);
+        {
+            std::ofstream out(path, std::ios::binary | std::ios::app);
+            out.write("\x20\x00\x00\x00torn", 8);      // header promises 32 bytes
+        }
+        InMemoryDB restored;
+        std::size_t n = WriteAheadLog::replay(path, restored);
+        report("Torn tail is truncated",
+               n == 1 && restored.get("k") == "v" && fs::file_size(path) == intact);
+    }
+
+    {
+        fs::remove(path);
+        {
+            WriteAheadLog wal(path, { Durability::None, {} });
+            InMemoryDB db;
+            db.setCommitObserver(&wal);
+            db.set("k", "v");
+            db.setCommitObserver(nullptr);
+        }
+        auto intact = fs::file_size(path);
+        /* checksum fine, payload not: 2 changes promised, the second cut short */
+        const std::string payload("\x02\x01\x01x\x01" "1" "\x01\x05y", 8);
+        std::uint32_t crc = 0xFFFFFFFFu;                 // CRC-32, as the log computes it
+        for (unsigned char c : payload) {
+            crc ^= c;
+            for (int k = 0; k < 8; ++k) crc = (crc & 1) ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+        }
+        crc ^= 0xFFFFFFFFu;
+        {
+            std::ofstream out(path, std::ios::binary | std::ios::app);
+            for (std::uint32_t v : { std::uint32_t(payload.size()), crc })
+                for (int i = 0; i < 4; ++i) out.put(static_cast<char>(v >> (8 * i)));
+            out << payload;
+        }
+        InMemoryDB restored;
+        std::size_t n = WriteAheadLog::replay(path, restored);
+        report("Undecodable record is not applied in part",
+               n == 1 && restored.get("k") == "v" && !restored.get("x")
+               && fs::file_size(path) == intact);
+    }
+
+#ifdef __linux__
+    for (Durability d : { Durability::Async, Durability::Group }) {
+        WriteAheadLog wal("/dev/full", { d, {} });      // every write fails with ENOSPC
+        InMemoryDB db;
+        db.setCommitObserver(&wal);
+        auto fails = [](auto&& f) {
+            try { f(); } catch (const std::runtime_error&) { return true; }
+            return false;
+        };
+        bool first = d == Durability::Group
+                   ? fails([&] { db.set("a", "1"); })                  // the waiting committer
+                   : !fails([&] { db.set("a", "1"); }) && fails([&] { wal.sync(); });
+        bool pass = first && fails([&] { db.set("b", "1"); }) && fails([&] { wal.sync(); });
+        db.setCommitObserver(nullptr);
+        report(std::string("Flusher I/O error reaches the caller (") +
+               (d == Durability::Group ? "group" : "async") + ")", pass);
+    }
+#endif
+    fs::remove(path);
+}
+
+static void runChangeStreamTests() {
+    SuiteReport report("ChangeStream");
+    using Change = std::pair<std::string, std::optional<std::string>>;
+    auto collect = [](ChangeStream::Reader& r, std::vector<std::uint64_t>& seqs,
+                      std::vector<std::vector<Change>>& recs) {
+        return r.poll([&](std::uint64_t seq, std::span<const CommittedChange> cs) {
+            seqs.push_back(seq);
+            recs.emplace_back();
+            for (const auto& c : cs)
+                recs.back().emplace_back(std::string(c.key),
+                                         c.val ? std::optional<std::string>(*c.val) : std::nullopt);
+        });
+    };
+
+    for (TxnMode mode : { TxnMode::UndoLog, TxnMode::Overlay }) {
+        ChangeStream stream(4096);
+        ChangeStream::Reader r = stream.subscribe();
+        InMemoryDB db(mode);
+        db.setCommitObserver(&stream);
+        db.set("a", "1");
+        db.set("b", "1");
+        db.del("a");
+        db.begin();
+        db.set("c", "2");
+        db.begin();
+        db.set("b", "2");
+        db.commit();
+        db.begin();
+        db.set("lost", "9");                            // rolled back: never published
+        db.del("b");
+        db.rollback();
+        db.del("missing");                              // no change: nothing published
+        db.setCommitObserver(nullptr);
+
+        std::vector<std::uint64_t> seqs;
+        std::vector<std::vector<Change>> recs;
+        std::size_t n = collect(r, seqs, recs);
+        std::vector<Change> txn = recs.size() == 4 ? recs[3] : std::vector<Change>{};
+        std::sort(txn.begin(), txn.end());
+        bool pass = n == 4 && seqs == std::vector<std::uint64_t>{ 1, 2, 3, 4 }
+                 && recs[0] == std::vector<Change>{ { "a", "1" } }
+                 && recs[2] == std::vector<Change>{ { "a", std::nullopt } }
+                 && txn == std::vector<Change>{ { "b", "2" }, { "c", "2" } }
+                 && r.lost() == 0 && r.nextSeq() == 5 && stream.lastSeq() == 4
+                 && r.poll([](auto, auto) {}) == 0;
+        report(std::string("Committed changes in order, rollback never seen (") +
+               (mode == TxnMode::Overlay ? "overlay" : "undo log") + ")", pass);
+    }
+
+    {
+        ChangeStream stream(4096);
+        InMemoryDB db;
+        db.setCommitObserver(&stream);
+        db.set("x", "1");
+        ChangeStream::Reader late = stream.subscribe();
+        db.set("y", "1");
+        std::vector<std::uint64_t> seqs;
+        std::vector<std::vector<Change>> recs;
+        collect(late, seqs, recs);
+        ChangeStream::Reader moved = std::move(late);
+        db.set("z", "1");
+        collect(moved, seqs, recs);
+        db.setCommitObserver(nullptr);
+        report("A reader starts at the next record and survives a move",
+               seqs == std::vector<std::uint64_t>{ 2, 3 } && moved.lost() == 0
+               && recs[0] == std::vector<Change>{ { "y", "1" } });
+    }
+
+    {
+        ChangeStream stream(512);                       // a few dozen records
+        ChangeStream::Reader r = stream.subscribe();
+        InMemoryDB db;
+        db.setCommitObserver(&stream);
+        for (int i = 1; i <= 200; ++i) db.set("key" + std::to_string(i % 7), std::to_string(i));
+        db.setCommitObserver(nullptr);
+        std::vector<std::uint64_t> seqs;
+        std::vector<std::vector<Change>> recs;
+        collect(r, seqs, recs);
+        bool pass = !seqs.empty() && seqs.back() == 200 && r.lost() > 0
+                 && r.lost() + seqs.size() == 200 && seqs.front() == r.lost() + 1;
+        for (std::size_t i = 0; pass && i < seqs.size(); ++i)
+            pass = recs[i].size() == 1 && recs[i][0].second == std::to_string(seqs[i])
+                && (i == 0 || seqs[i] == seqs[i - 1] + 1);
+        report("Overwrite: a lapped reader skips to the oldest and counts the loss", pass);
+    }
+
+    for (auto overflow : { ChangeStream::Overflow::Overwrite, ChangeStream::Overflow::Block }) {
+        constexpr int kWrites = 50000;
+        ChangeStream stream(1024, overflow);
+        ChangeStream::Reader r = stream.subscribe();
+        std::atomic<bool> ok{ true };
+        std::uint64_t received = 0;
+        std::thread consumer([&] {
+            std::uint64_t last = 0;
+            while (last < kWrites) {
+                std::size_t n = r.poll([&](std::uint64_t seq, std::span<const CommittedChange> cs) {
+                    if (seq <= last || cs.size() != 1 || !cs[0].val
+                        || *cs[0].val != std::to_string(seq)
+                        || cs[0].key != "key" + std::to_string(seq % 13))
+                        ok = false;                     // out of order or torn
+                    last = seq;
+                    ++received;
+                });
+                if (!n) std::this_thread::yield();
+            }
+        });
+        InMemoryDB db;
+        db.setCommitObserver(&stream);
+        for (int i = 1; i <= kWrites; ++i) db.set("key" + std::to_string(i % 13), std::to_string(i));
+        consumer.join();
+        db.setCommitObserver(nullptr);
+        bool pass = ok && received + r.lost() == kWrites;
+        if (overflow == ChangeStream::Overflow::Block) pass = pass && r.lost() == 0;
+        report(overflow == ChangeStream::Overflow::Block
+                   ? "Block: a concurrent reader sees every record"
+                   : "Overwrite: a concurrent reader never sees a torn record", pass);
+    }
+
+    {
+        ChangeStream stream(1024);
+        ChangeStream::Reader r = stream.subscribe();
+        const std::string val(40, 'v');
+        CommittedChange c{ "counter", std::string_view(val) };
+        stream.onCommit({ &c, 1 });                     // grows the encode buffer
+        std::size_t before = allocCount();
+        for (int i = 0; i < 10000; ++i) stream.onCommit({ &c, 1 });
+        bool pass = allocCount() == before;
+        bool threw = false;
+        const std::string huge(2048, 'h');
+        CommittedChange big{ "big", std::string_view(huge) };
+        try { stream.onCommit({ &big, 1 }); } catch (const std::length_error&) { threw = true; }
+        std::vector<ChangeStream::Reader> readers;
+        bool full = false;
+        try {
+            for (std::size_t i = 0; i < ChangeStream::kMaxReaders; ++i) readers.push_back(stream.subscribe());
+        } catch (const std::length_error&) { full = true; }
+        report("Publishing allocates nothing; oversized records and readers are refused",
+               pass && threw && full && readers.size() == ChangeStream::kMaxReaders - 1
+               && stream.lastSeq() == 10001);
+    }
+}
+
+static void runCheckpointTests() {
+    SuiteReport report("Checkpoint");
+    namespace fs = std::filesystem;
+    const std::string path = (fs::temp_directory_path() / "algoplayground_test.ckpt").string();
+
+    {
+        InMemoryDB src;
+        for (int i = 0; i < 1000; ++i) src.set("key" + std::to_string(i), std::to_string(i % 7));
+        src.set("", "empty-key");
+        src.set("empty-value", "");
+        Checkpoint::write(path, src);
+    }
+    auto image = Checkpoint::open(path);
+    {
+        InMemoryDB db(image);
+        bool pass = image->keyCount() == 1002 && image->valueCount() == 9
+                 && db.get("key42") == "0" && db.get("") == "empty-key"
+                 && db.get("empty-value") == "" && !db.get("missing")
+                 && db.count("3") == 143 && db.count("") == 1 && db.count("nope") == 0
+                 && db.promotedKeys() == 0 && db.internedValues() == 0
+                 && image->keyAt(0) == "" && image->keyAt(1) == "empty-value";
+        report("Image serves reads without loading", pass);
+    }
+
+    for (TxnMode mode : { TxnMode::UndoLog, TxnMode::Overlay }) {
+        const std::string tag = mode == TxnMode::Overlay ? " (overlay)" : " (undo log)";
+        InMemoryDB db(image, mode);
+        db.set("key3", "x");                             // promoted, 3 → x (key 3/10/17 hold "3")
+        db.del("key10");                                 // promoted, deleted
+        db.begin();
+        db.set("key17", "y");
+        db.del("key3");
+        db.set("new", "3");
+        bool inside = db.get("key17") == "y" && !db.get("key3") && db.count("3") == 141;
+        db.rollback();
+        bool pass = inside && db.get("key3") == "x" && !db.get("key10")
+                 && db.get("key17") == "3" && !db.get("new")
+                 && db.count("3") == 141 && db.count("x") == 1
+                 // promotion survives rollback; overlay writes never reach the base
+                 && db.promotedKeys() == (mode == TxnMode::UndoLog ? 3u : 2u);
+        db.begin();
+        db.set("key17", "y");
+        db.commit();
+        pass = pass && db.get("key17") == "y" && db.count("3") == 140 && db.count("y") == 1;
+        report("Writes promote keys lazily" + tag, pass);
+    }
+
+    {
+        InMemoryDB db(image);
+        db.set("key0", "changed");
+        db.del("key1");
+        db.set("extra", "0");
+        const std::string path2 = path + "2";
+        Checkpoint::write(path2, db);                    // merges image + own tables
+        InMemoryDB reloaded(Checkpoint::open(path2));
+        bool pass = reloaded.get("key0") == "changed" && !reloaded.get("key1")
+                 && reloaded.get("extra") == "0" && reloaded.get("key999") == "5"
+                 && reloaded.count("0") == db.count("0") && reloaded.count("1") == db.count("1");
+        fs::remove(path2);
+        report("Checkpoint of an image-backed db", pass);
+    }
+
+    {
+        const std::string bad = path + ".bad";
+        { std::ofstream(bad, std::ios::binary) << "definitely not a checkpoint file...."; }
+        bool threw = false;
+        try { Checkpoint::open(bad); } catch (const std::runtime_error&) { threw = true; }
+        fs::remove(bad);
+        report("Malformed file is rejected", threw);
+    }
+
+    {
+        const std::string wal = path + ".wal";           // checkpoint + log = recovery
+        fs::remove(wal);
+        {
+            WriteAheadLog log(wal, { Durability::None, {} });
+            InMemoryDB db(image);
+            db.setCommitObserver(&log);
+            db.set("key5", "after");
+            db.del("key6");
+            db.setCommitObserver(nullptr);
+        }
+        InMemoryDB recovered(Checkpoint::open(path));
+        WriteAheadLog::replay(wal, recovered);
+        fs::remove(wal);
+        report("Replay WAL on top of a checkpoint",
+               recovered.get("key5") == "after" && !recovered.get("key6")
+               && recovered.get("key7") == "0" && recovered.count("after") == 1);
+    }
+    image.reset();
+    fs::remove(path);
+}
+
+// Copy-on-write snapshots: whatever runs between the steps, the pairs
+// handed out are exactly the committed state at beginSnapshot(), once each.
+static void runSnapshotTests() {
+    SuiteReport report("Snapshot");
+    using State = std::map<std::string, std::string>;
+    auto state = [](const InMemoryDB& db) {
+        State kv;
+        for (auto& [k, v] : db.scan("", std::size_t(-1)).items) kv[k] = v;
+        return kv;
+    };
+    /* drains the snapshot, calling between(step) after every step;
+       false on a key handed out twice */
+    auto drain = [](InMemoryDB& db, std::size_t budget, State& out, auto&& between) {
+        bool unique = true;
+        for (int step = 0;; ++step) {
+            bool more = db.snapshotStep(budget, [&](std::string_view k, std::string_view v) {
+                unique = out.emplace(k, v).second && unique;
+            });
+            if (!more) return unique;
+            between(step);
+        }
+    };
+    namespace fs = std::filesystem;
+    const std::string path = (fs::temp_directory_path() / "algoplayground_snapshot_test").string();
+
+    for (TxnMode mode : { TxnMode::UndoLog, TxnMode::Overlay }) {
+        const std::string tag = mode == TxnMode::Overlay ? " (overlay)" : " (undo log)";
+        InMemoryDB db(mode);
+        db.setOrderedIndex(true);
+        for (int i = 0; i < 5000; ++i) db.set("key" + std::to_string(i), "v" + std::to_string(i % 50));
+        const State frozen = state(db);
+        db.beginSnapshot();
+        std::mt19937 rng(7);
+        auto key = [&] { return "key" + std::to_string(rng() % 6000); };
+        State got;
+        bool unique = drain(db, 37, got, [&](int step) {
+            for (int j = 0; j < 20; ++j) {
+                switch (rng() % 4) {
+                case 0: db.set(key(), "w" + std::to_string(step)); break;
+                case 1: db.del(key()); break;
+                case 2: db.set("new" + std::to_string(step) + "_" + std::to_string(j), "n"); break;
+                default:
+                    db.begin();
+                    db.set(key(), "t");
+                    db.del(key());
+                    if (rng() % 2) db.commit(); else db.rollback();
+                }
+            }
+        });
+        bool pass = unique && got == frozen && !db.snapshotting() && db.snapshotBytes() == 0;
+        const State now = state(db);                     // a second snapshot starts clean
+        db.beginSnapshot();
+        got.clear();
+        unique = drain(db, 1000, got, [](int) {});
+        report("Writes between steps do not leak in" + tag, pass && unique && got == now);
+    }
+
+    {
+        InMemoryDB db;
+        for (int i = 0; i < 1700; ++i) db.set("k" + std::to_string(i), std::to_string(i));
+        const State frozen = state(db);
+        const std::size_t slots = db.stats().slots;
+        db.beginSnapshot();
+        State got;
+        int next = 1700;
+        bool unique = drain(db, 10, got, [&](int step) {
+            for (int j = 0; j < 40; ++j) db.set("k" + std::to_string(next++), "new");
+            db.set("k" + std::to_string(step), "changed");
+            db.del("k" + std::to_string(1699 - step));
+        });
+        report("Resize during the walk", unique && got == frozen && db.stats().slots > slots);
+    }
+
+    {
+        const std::string ckpt = path + ".ckpt";
+        {
+            InMemoryDB src;
+            for (int i = 0; i < 1000; ++i) src.set("img" + std::to_string(i), std::to_string(i % 9));
+            Checkpoint::write(ckpt, src);
+        }
+        std::uint64_t clock = 1000;
+        InMemoryDB db(Checkpoint::open(ckpt));
+        db.setClock([&] { return clock; });
+        db.set("img1", "promoted-before");
+        db.del("img2");
+        for (int i = 0; i < 2000; ++i)
+            db.set("own" + std::to_string(i), std::string(40, 'a' + i % 26),
+                   std::chrono::milliseconds(i % 2 ? 50 : 100000));
+        const State frozen = state(db);
+        db.setMemoryLimit(db.memoryUsage() + 64 * 1024);
+        db.beginSnapshot();
+        State got;
+        int next = 0;
+        bool unique = drain(db, 25, got, [&](int step) {
+            db.set("img" + std::to_string(step * 7 % 1000), "promoted");   // ahead of and behind the walk
+            db.del("img" + std::to_string((step * 13 + 5) % 1000));
+            clock += 10;
+            db.expire();
+            for (int j = 0; j < 20; ++j) {
+                const std::string k = "fill" + std::to_string(next++);
+                db.set(k, std::string(200, 'f') + k);   // distinct values: the pool does not share them
+            }
+        });
+        const auto cs = db.cacheStats();
+        report("Image keys, expiry and eviction during the walk",
+               unique && got == frozen && db.expiredKeys() > 0 && cs.evictions > 0);
+        fs::remove(ckpt);
+    }
+
+    {
+        InMemoryDB db;
+        for (int i = 0; i < 3000; ++i) db.set("k" + std::to_string(i), "v");
+        db.begin();
+        bool threw = false;
+        try { db.beginSnapshot(); } catch (const std::logic_error&) { threw = true; }
+        db.commit();
+        db.beginSnapshot();
+        int steps = 0;
+        db.snapshotStep(100, [&](std::string_view, std::string_view) { ++steps; });
+        db.set("k0", "changed");
+        db.endSnapshot();                                // abandoned half-way
+        db.set("k1", "changed");
+        db.del("k2");
+        const State now = state(db);
+        db.beginSnapshot();
+        State got;
+        bool unique = drain(db, 500, got, [](int) {});
+        report("Abandoned snapshot, then a fresh one",
+               threw && steps == 100 && unique && got == now);
+    }
+
+    {
+        InMemoryDB db;
+        std::mutex mu;
+        for (int i = 0; i < 20000; ++i) db.set("key" + std::to_string(i), "v" + std::to_string(i));
+        const State frozen = state(db);
+        {
+            BackgroundSnapshot snap(db, mu, path, 64);
+            std::mt19937 rng(3);
+            while (!snap.done()) {
+                std::lock_guard lock(mu);
+                const std::string k = "key" + std::to_string(rng() % 25000);
+                if (rng() % 3) db.set(k, "w");
+                else           db.del(k);
+            }
+            snap.wait();
+        }
+        InMemoryDB restored;
+        WriteAheadLog::replay(path, restored);
+        const bool exists = fs::exists(path) && !fs::exists(path + ".tmp");
+        fs::remove(path);
+        report("BackgroundSnapshot writes a replayable file",
+               exists && state(restored) == frozen && !db.snapshotting());
+    }
+}
+
+// BPlusTreeSet against std::set (tiny nodes ⇒ deep trees, many splits and
+// merges), then scans against a sorted walk of the same database.
+static void runOrderedScanTests() {
+    SuiteReport report("Ordered Scan");
+
+    {
+        std::mt19937 rng(7);
+        BPlusTreeSet<std::string, std::less<>, 4> tree;
+        std::set<std::string, std::less<>>        ref;
+        bool pass = true;
+        for (int i = 0; i < 60000 && pass; ++i) {
+            std::string key = "k" + std::to_string(rng() % 3000);
+            if (rng() % 3) pass = tree.insert(key) == ref.insert(key).second;
+            else           pass = tree.erase(key) == (ref.erase(key) == 1);
+            if (i % 97 == 0) {
+                auto t = tree.lower_bound(std::string_view(key).substr(0, 3));
+                auto r = ref.lower_bound(std::string_view(key).substr(0, 3));
+                pass = pass && (t == tree.end()) == (r == ref.end()) && (r == ref.end() || *t == *r);
+            }
+            pass = pass && tree.size() == ref.size();
+        }
+        pass = pass && std::equal(tree.begin(), tree.end(), ref.begin(), ref.end());
+        for (auto& k : std::vector<std::string>(ref.begin(), ref.end())) tree.erase(k);
+        pass = pass && tree.empty() && tree.begin() == tree.end();
+        report("B+tree matches std::set", pass);
+    }
+
+    auto fill = [](InMemoryDB& db) {
+        for (int u = 0; u < 200; ++u)
+            for (const char* f : { "name", "mail", "plan" })
+                db.set("user:" + std::to_string(u) + ":" + f, f + std::to_string(u % 5));
+        db.set("userx", "1");
+        db.set("zzz", "2");
+    };
+    auto pageAll = [](const InMemoryDB& db, std::string_view prefix, std::size_t limit) {
+        std::vector<std::pair<std::string, std::string>> all;
+        std::string cursor;
+        do {
+            ScanPage p = db.scan(prefix, limit, cursor);
+            all.insert(all.end(), p.items.begin(), p.items.end());
+            cursor = p.next;
+        } while (!cursor.empty());
+        return all;
+    };
+
+    {
+        InMemoryDB indexed, plain;
+        indexed.setOrderedIndex(true);
+        fill(indexed);
+        fill(plain);
+        indexed.del("user:7:mail");
+        plain.del("user:7:mail");
+
+        ScanPage one = indexed.scan("user:42:", 10);
+        auto all = pageAll(indexed, "user:", 7);
+        bool sorted = std::is_sorted(all.begin(), all.end());
+        bool pass = one.items.size() == 3 && one.next.empty()
+                 && one.items[0] == std::make_pair(std::string("user:42:mail"), std::string("mail2"))
+                 && all.size() == 599 && sorted && all == pageAll(plain, "user:", 7)
+                 && indexed.scanRange("user:50:", "user:51", 100).items.size() == 3
+                 && indexed.scanRange("userx", "", 100).items.size() == 2
+                 && indexed.scan("", 1000).items.size() == 601
+                 && indexed.scan("user:1", 5).next == "user:101:name" + std::string(1, '\0');
+        report("Prefix scan with cursor pagination", pass);
+    }
+
+    for (TxnMode mode : { TxnMode::UndoLog, TxnMode::Overlay }) {
+        const std::string tag = mode == TxnMode::Overlay ? " (overlay)" : " (undo log)";
+        InMemoryDB db(mode);
+        db.setOrderedIndex(true);
+        fill(db);
+        auto before = pageAll(db, "user:1", 4);
+        db.begin();
+        db.set("user:1:new", "x");
+        db.del("user:1:name");
+        db.begin();
+        db.del("user:10:plan");
+        db.set("user:1a", "y");
+        auto inner = db.scan("user:1:", 10).items;
+        auto inside = pageAll(db, "user:1", 4);
+        db.rollback();
+        db.rollback();
+        bool pass = inner.size() == 3 && inner[1].first == "user:1:new"
+                 && inside.size() == before.size() && inside != before
+                 && pageAll(db, "user:1", 4) == before;
+        db.begin();
+        db.del("user:150:mail");
+        db.commit();
+        pass = pass && pageAll(db, "user:150:", 1).size() == 2;
+        report("Rollback restores scan results" + tag, pass);
+    }
+
+    {
+        namespace fs = std::filesystem;
+        const std::string path = (fs::temp_directory_path() / "algoplayground_scan.ckpt").string();
+        {
+            InMemoryDB src;
+            fill(src);
+            Checkpoint::write(path, src);
+        }
+        InMemoryDB db(Checkpoint::open(path));
+        db.setOrderedIndex(true);
+        db.del("user:3:mail");                           // shadowed + deleted
+        db.set("user:3:plan", "changed");                // shadowed + in db_
+        db.set("user:3:zip", "new");                     // only in db_
+        auto page = db.scan("user:3:", 10).items;
+        auto all  = pageAll(db, "", 50);
+        bool pass = page.size() == 3 && page[0].first == "user:3:name"
+                 && page[1] == std::make_pair(std::string("user:3:plan"), std::string("changed"))
+                 && page[2].first == "user:3:zip"
+                 && all.size() == 602 && std::is_sorted(all.begin(), all.end());
+        report("Scan merges checkpoint image and db", pass);
+        fs::remove(path);
+    }
+}
+
+// Timing wheel against brute force, then TTL semantics on a manual clock:
+// active and lazy expiry, COUNT, rollback, overlay and a same-deadline storm.
+static void runTtlTests() {
+    SuiteReport report("TTL");
+
+    {
+        std::mt19937_64 rng(5);
+        TimingWheel wheel(1000);
+        std::vector<std::uint64_t> when(20000);
+        std::vector<int>           fired(when.size(), 0);
+        for (std::size_t i = 0; i < when.size(); ++i) {
+            when[i] = 1000 + rng() % (i % 4 == 0 ? 10'000'000 : 5000);   // spans several levels
+            wheel.schedule(when[i], std::to_string(i));
+        }
+        bool pass = true;
+        std::uint64_t t = 1000;
+        while (wheel.size() && pass) {
+            t += 1 + rng() % 50'000;
+            do {
+                wheel.advance(t, 64, [&](std::uint64_t w, std::string_view key) {
+                    std::size_t i = std::stoul(std::string(key));
+                    pass = pass && w == when[i] && w <= wheel.now() && fired[i]++ == 0;
+                });
+            } while (wheel.backlog() || wheel.now() < t);
+            for (std::size_t i = 0; i < when.size(); ++i)    // …and never late
+                pass = pass && (when[i] > t || fired[i] == 1);
+        }
+        pass = pass && std::all_of(fired.begin(), fired.end(), [](int f) { return f == 1; });
+        report("Wheel fires every item once, on time", pass);
+    }
+
+    std::uint64_t clock = 1'000'000;
+    auto manual = [&] { return clock; };
+    using std::chrono::milliseconds;
+
+    {
+        InMemoryDB db;
+        db.setClock(manual);
+        db.set("a", "v", milliseconds(100));
+        db.set("b", "v", milliseconds(200));
+        db.set("c", "v");
+        db.set("d", "v", milliseconds(100));
+        db.set("d", "w");                                // plain SET drops the TTL
+        clock += 150;
+        bool before = !db.get("a") && db.count("v") == 2;   // reads miss before the wheel turns
+        std::size_t n = db.expire();
+        bool pass = before && n == 1 && !db.get("a") && db.count("v") == 2
+                 && db.ttl("b") == milliseconds(50) && !db.ttl("c") && !db.ttl("d");
+        clock += 1000;
+        n = db.expire();
+        pass = pass && n == 1 && !db.get("b") && db.get("c") && db.get("d") == "w"
+            && db.count("v") == 1 && db.expiredKeys() == 2 && db.expiringKeys() == 0;
+        report("Active expiry keeps COUNT exact", pass);
+    }
+
+    for (bool indexed : { false, true }) {               // COUNT walks expires_ / the holders
+        InMemoryDB db;
+        db.setClock(manual);
+        db.setValueIndex(indexed);
+        db.setOrderedIndex(true);
+        for (int i = 0; i < 10; ++i)
+            db.set("k" + std::to_string(i), "v", milliseconds(i < 4 ? 10 : 1000));
+        db.set("plain", "v");
+        db.set("other", "w", milliseconds(10));
+        for (int i = 0; i < 20; ++i)                     // expires_ outgrows v's holders
+            db.set("t" + std::to_string(i), "x", milliseconds(1000));
+        clock += 50;                                     // k0..k3 and other are due; no expire()
+        std::vector<std::string_view> keys = { "k0", "k5", "other", "plain" };
+        auto got = db.mget(keys);
+        std::size_t shown = 0;
+        db.keysWithValue("v", 100, [&](std::string_view) { ++shown; });
+        bool pass = !db.get("k0") && !db.getView("k3") && db.get("k4") == "v"
+                 && db.count("v") == 7 && db.count("w") == 0 && shown == 7
+                 && !got[0] && got[1] == "v" && !got[2] && got[3] == "v"
+                 && !db.ttl("k0") && db.ttl("k4") == milliseconds(950)
+                 && db.count("x") == 20 && db.scan("", 100).items.size() == 27
+                 && db.expiredKeys() == 0;
+        pass = pass && db.expire() == 5 && db.count("v") == 7 && db.expiredKeys() == 5;
+        report(indexed ? "Reads miss expired keys before expire() (value index)"
+                       : "Reads miss expired keys before expire()", pass);
+    }
+
+    {
+        struct Mirror : CommitObserver {
+            std::map<std::string, std::string> kv;
+            void onCommit(std::span<const CommittedChange> cs) override {
+                for (auto& c : cs) {
+                    if (c.val) kv[std::string(c.key)] = std::string(*c.val);
+                    else       kv.erase(std::string(c.key));
+                }
+            }
+        } mirror;
+        InMemoryDB db;
+        db.setClock(manual);
+        db.setCommitObserver(&mirror);
+        db.setOrderedIndex(true);
+        db.set("lazy", "1", milliseconds(10));
+        db.set("again", "1", milliseconds(10));
+        clock += 20;
+        db.del("lazy");                                  // expired: nothing left to delete
+        db.set("again", "2");                            // starts from an absent key
+        bool lazy = !db.get("lazy") && db.get("again") == "2" && db.count("1") == 0
+                 && db.expiredKeys() == 2 && !db.ttl("again");
+
+        db.set("x", "v0", milliseconds(100));            // prior version expires in the txn
+        db.set("y", "v0");                               // txn's version expires
+        db.set("z", "v0", milliseconds(500));            // restored with its TTL
+        db.begin();
+        db.set("x", "v1");
+        db.set("y", "v1", milliseconds(50));
+        db.del("z");
+        clock += 200;
+        std::size_t reaped = db.expire();                // y
+        db.rollback();
+        bool txn = reaped == 1 && !db.get("x") && db.get("y") == "v0" && db.get("z") == "v0"
+                && db.count("v0") == 2 && db.count("v1") == 0 && db.ttl("z") == milliseconds(300);
+        clock += 1000;
+        db.expire();
+        txn = txn && !db.get("z") && db.count("v0") == 1 && db.scan("", 10).items.size() == 2;
+
+        std::map<std::string, std::string> actual;
+        for (auto& [k, v] : db.scan("", 10).items) actual[k] = v;
+        db.setCommitObserver(nullptr);
+        report("Lazy expiry and rollback", lazy && txn && actual == mirror.kv);
+    }
+
+    {
+        InMemoryDB db(TxnMode::Overlay);
+        db.setClock(manual);
+        db.set("base", "v", milliseconds(10));
+        db.begin();
+        db.set("w", "v", milliseconds(10));
+        clock += 100;
+        bool frozen = db.expire() == 0 && db.get("base") == "v" && db.get("w") == "v"
+                   && db.count("v") == 2;
+        db.commit();
+        bool pass = frozen && db.expire() == 2 && !db.get("w") && !db.get("base") && db.count("v") == 0;
+        report("Overlay: time stands still inside BEGIN", pass);
+    }
+
+    {
+        InMemoryDB db;
+        db.setClock(manual);
+        for (int i = 0; i < 20000; ++i)
+            db.set("storm:" + std::to_string(i), std::to_string(i % 3), milliseconds(1000));
+        db.set("keep", "0");
+        clock += 5000;
+        std::size_t calls = 0, maxPerCall = 0, total = 0;
+        while (db.expiringKeys()) {
+            std::size_t n = db.expire(1000);
+            maxPerCall = std::max(maxPerCall, n);
+            total += n;
+            ++calls;
+        }
+        bool pass = total == 20000 && maxPerCall <= 1000 && calls >= 20
+                 && db.count("0") == 1 && db.count("1") == 0 && db.get("keep") == "0";
+        report("Expiry storm is spread over budgeted calls", pass);
+    }
+}
+
+static void runMemoryLimitTests() {
+    SuiteReport report("Memory Limit");
+    auto longKey = [](int i) { return "key:" + std::to_string(i) + std::string(40, 'k'); };
+    auto longVal = [](int i) { return "val:" + std::to_string(i) + std::string(60, 'v'); };
+
+    {
+        InMemoryDB db;
+        db.setOrderedIndex(true);
+        db.begin();                                      // size the txn stack once
+        db.rollback();
+        const std::size_t empty = db.memoryUsage();
+        auto fill = [&] {
+            for (int i = 0; i < 2000; ++i) db.set(longKey(i), longVal(i));
+        };
+        fill();
+        const std::size_t full = db.memoryUsage();
+        std::size_t strings = 0;                         // key in db_ and index; value twice
+        for (int i = 0; i < 2000; ++i) strings += 2 * (longKey(i).size() + 1) + 2 * (longVal(i).size() + 1);
+        for (int i = 0; i < 2000; ++i) db.del(longKey(i));
+        const std::size_t drained = db.memoryUsage();
+        fill();                                          // reuses the freed value ids
+        const std::size_t refilled = db.memoryUsage();
+        for (int i = 0; i < 2000; ++i) db.del(longKey(i));
+        fill();                                          // same sizes, every table already grown
+        bool pass = full - empty >= strings && full - drained >= strings - 8 * 1024
+                 && db.memoryUsage() == refilled;
+        std::size_t kept = 0;                            // the recycled frame and key arena
+        for (int round = 0; round < 2; ++round) {
+            db.begin();
+            for (int i = 0; i < 2000; i += 2) db.set(longKey(i), longVal(i + 1));
+            bool txn = db.memoryUsage() > refilled                     // undo records count …
+                    && (round == 0 || db.memoryUsage() == refilled + kept);  // … and reuse the frame
+            db.rollback();
+            if (round == 0) kept = db.memoryUsage() - refilled;
+            pass = pass && txn && db.memoryUsage() == refilled + kept && db.stats().undoBytes == 0;
+        }
+        db.set("ttl", "v", std::chrono::hours(1));
+        pass = pass && db.memoryUsage() > refilled;
+        report("Accounting follows keys, values, index, undo log and TTLs", pass);
+    }
+
+    {
+        InMemoryDB db;
+        const std::size_t limit = 1 << 20;
+        db.setMemoryLimit(limit);
+        const int n = 50000;
+        bool bounded = true;
+        for (int i = 0; i < n; ++i) {
+            db.set(longKey(i), longVal(i % 500));
+            bounded = bounded && db.memoryUsage() <= limit;
+        }
+        std::size_t present = 0;
+        for (int i = 0; i < n; ++i) present += db.get(longKey(i)).has_value();
+        std::size_t counted = 0;
+        for (int v = 0; v < 500; ++v) counted += db.count(longVal(v));
+        CacheStats st = db.cacheStats();
+        bool pass = bounded && present > 0 && present + st.evictions == std::size_t(n)
+                 && counted == present && st.hits == present && st.misses == n - present;
+        report("Usage stays under the limit; COUNT and stats stay exact", pass);
+    }
+
+    {
+        InMemoryDB db;
+        db.setMemoryLimit(1 << 20);
+        const int hot = 1000;
+        for (int i = 0; i < hot; ++i) db.set("hot:" + std::to_string(i), "h");
+        for (int i = 0; i < 60000; ++i) {
+            db.set(longKey(i), longVal(i));              // one-off scan traffic
+            if (i % 100 == 0)
+                for (int h = 0; h < hot; ++h) db.getView("hot:" + std::to_string(h));
+        }
+        bool pass = db.count("h") == hot && db.cacheStats().evictions > 10000;
+        report("CLOCK keeps keys read between sweeps", pass);
+    }
+
+    {
+        struct Ignore : CommitObserver {
+            void onCommit(std::span<const CommittedChange>) override {}
+        } ignore;
+        auto survivors = [&](CommitObserver* o) {        // hot keys left after write-once traffic
+            InMemoryDB db;
+            db.setCommitObserver(o);
+            db.setMemoryLimit(1 << 20);
+            const int hot = 200;
+            for (int i = 0; i < hot; ++i) db.set("hot:" + std::to_string(i), "h");
+            for (int i = 0; i < 60000; ++i) {
+                db.set(longKey(i), longVal(i));
+                if (i % 100 == 0)
+                    for (int h = 0; h < hot; ++h) db.getView("hot:" + std::to_string(h));
+            }
+            return db.count("h");
+        };
+        const std::size_t plain = survivors(nullptr);
+        bool pass = plain > 100 && survivors(&ignore) == plain;   // publishing is not a read
+        report("CLOCK with an observer attached: new keys still go first", pass);
+    }
+
+    {
+        InMemoryDB db;
+        for (int i = 0; i < 100; ++i) db.set("k" + std::to_string(i), "old");
+        db.begin();
+        for (int i = 0; i < 10; ++i) db.set("k" + std::to_string(i), "new");
+        db.begin();
+        db.set("inner", "new");
+        db.setMemoryLimit(1);                            // everything unpinned must go
+        bool pinned = db.count("new") == 11 && db.count("old") == 0;
+        db.setMemoryLimit(0);
+        db.rollback();
+        db.rollback();
+        bool undo = pinned && db.count("old") == 10 && db.get("k0") == "old" && !db.get("k50")
+                 && !db.get("inner");
+
+        InMemoryDB ov(TxnMode::Overlay);
+        for (int i = 0; i < 100; ++i) ov.set("k" + std::to_string(i), "old");
+        ov.begin();
+        ov.set("k0", "new");
+        ov.del("k1");
+        ov.setMemoryLimit(1);
+        bool layer = ov.get("k0") == "new" && !ov.get("k1") && ov.count("old") == 0;
+        ov.setMemoryLimit(0);
+        ov.rollback();
+        bool overlay = layer && ov.get("k0") == "old" && ov.get("k1") == "old" && ov.count("old") == 2;
+        report("Keys written by open transactions are pinned", undo && overlay);
+    }
+
+    {
+        struct Mirror : CommitObserver {
+            std::map<std::string, std::string> kv;
+            void onCommit(std::span<const CommittedChange> cs) override {
+                for (auto& c : cs) {
+                    if (c.val) kv[std::string(c.key)] = std::string(*c.val);
+                    else       kv.erase(std::string(c.key));
+                }
+            }
+        } mirror;
+        InMemoryDB db;
+        db.setCommitObserver(&mirror);
+        db.setOrderedIndex(true);
+        db.setMemoryLimit(512 * 1024);
+        std::mt19937 rng(11);
+        for (int i = 0; i < 20000; ++i) {
+            int k = static_cast<int>(rng() % 8000);
+            if (rng() % 8 == 0) {
+                db.begin();
+                db.set(longKey(k), longVal(i));
+                db.del(longKey(k + 1));
+                if (rng() % 2) db.commit(); else db.rollback();
+            } else {
+                db.set(longKey(k), longVal(i));
+            }
+        }
+        std::map<std::string, std::string> actual;
+        for (auto page = db.scan("", 1000);; page = db.scan("", 1000, page.next)) {
+            for (auto& [k, v] : page.items) actual[k] = v;
+            if (page.next.empty()) break;
+        }
+        db.setCommitObserver(nullptr);
+
+        ShardedInMemoryDB sharded(8);
+        sharded.setMemoryLimit(8 * 256 * 1024);
+        for (int i = 0; i < 40000; ++i) sharded.set(longKey(i), longVal(i));
+        for (int i = 0; i < 40000; i += 4) sharded.get(longKey(i));
+        CacheStats st = sharded.cacheStats();
+        bool shards = sharded.memoryUsage() <= 8 * 256 * 1024 && st.evictions > 0
+                   && st.hits + st.misses == 10000 && st.hitRatio() < 1.0;
+        report("Observer sees evictions; sharded limit and stats",
+               actual == mirror.kv && db.cacheStats().evictions > 0 && shards);
+    }
+}
+
+static void runValueIndexTests() {
+    SuiteReport report("Value Index");
+    /* reference answer: every visible key, found through the ordered scan */
+    auto holders = [](const InMemoryDB& db, const std::string& val) {
+        std::set<std::string> keys;
+        for (auto& [k, v] : db.scan("", std::size_t(-1)).items)
+            if (v == val) keys.insert(k);
+        return keys;
+    };
+    auto indexed = [](const InMemoryDB& db, const std::string& val) {
+        auto keys = db.keysWithValue(val, std::size_t(-1));
+        std::set<std::string> unique(keys.begin(), keys.end());
+        return unique.size() == keys.size() && keys.size() == db.count(val)
+             ? unique : std::set<std::string>{ "<duplicate or COUNT mismatch>" };
+    };
+
+    for (TxnMode mode : { TxnMode::UndoLog, TxnMode::Overlay }) {
+        InMemoryDB db(mode);
+        db.setValueIndex(true);
+        std::mt19937 rng(mode == TxnMode::Overlay ? 21 : 20);
+        bool pass = true;
+        for (int step = 0; step < 20000 && pass; ++step) {
+            std::string key = "k" + std::to_string(rng() % 400);
+            std::string val = "v" + std::to_string(rng() % 12);
+            switch (rng() % 10) {
+            case 0:  db.begin(); break;
+            case 1:  db.rollback(); break;
+            case 2:  db.commit(); break;
+            case 3:  db.del(key); break;
+            case 4: {
+                std::string_view ks[] = { key, "k7", "k8" };
+                db.mdel(ks);
+                break;
+            }
+            default: db.set(key, val);
+            }
+            if (step % 500 == 0)
+                for (int v = 0; v < 12; ++v)
+                    pass = pass && indexed(db, "v" + std::to_string(v)) == holders(db, "v" + std::to_string(v));
+        }
+        report(std::string("Index matches a full scan through txns") +
+               (mode == TxnMode::Overlay ? " (overlay)" : " (undo log)"), pass);
+    }
+
+    {
+        namespace fs = std::filesystem;
+        const std::string path = (fs::temp_directory_path() / "algoplayground_vindex.ckpt").string();
+        {
+            InMemoryDB src;
+            for (int i = 0; i < 300; ++i) src.set("img" + std::to_string(i), "v" + std::to_string(i % 3));
+            Checkpoint::write(path, src);
+        }
+        InMemoryDB db(Checkpoint::open(path), TxnMode::Overlay);
+        db.setValueIndex(true);
+        db.set("img0", "v1");                            // promoted: v0 → v1
+        db.del("img3");
+        db.set("own", "v0");
+        db.begin();
+        db.set("img6", "v2");                            // image key hidden by a level
+        db.set("img1", "v0");
+        db.set("own", "v2");
+        db.begin();
+        db.set("own", "v0");                             // rewritten above: counts once
+        db.del("img9");
+        bool pass = true;
+        for (std::string v : { "v0", "v1", "v2", "none" })
+            pass = pass && indexed(db, v) == holders(db, v);
+        db.commit();
+        for (std::string v : { "v0", "v1", "v2" })
+            pass = pass && indexed(db, v) == holders(db, v);
+        std::error_code ec;
+        fs::remove(path, ec);
+        report("Image keys and overlay levels are reported once", pass);
+    }
+
+    {
+        InMemoryDB plain, db;
+        db.set("seed", "x");
+        for (int i = 0; i < 5000; ++i) {
+            plain.set("key" + std::to_string(i), std::to_string(i % 5));
+            db.set("key" + std::to_string(i), std::to_string(i % 5));
+        }
+        db.setValueIndex(true);                          // built from existing keys
+        std::size_t streamed = 0;
+        std::size_t n = db.keysWithValue("3", 250, [&](std::string_view k) {
+            streamed += db.get(k) == "3";
+        });
+        auto a = plain.keysWithValue("4", std::size_t(-1));   // no index: walks db_
+        auto b = db.keysWithValue("4", std::size_t(-1));
+        std::sort(a.begin(), a.end());
+        std::sort(b.begin(), b.end());
+        const std::size_t withIndex = db.memoryUsage();
+        db.setValueIndex(false);
+        bool pass = n == 250 && streamed == 250 && a == b && a.size() == 1000
+                 && db.keysWithValue("3", 0).empty() && db.memoryUsage() < withIndex
+                 && plain.keysWithValue("x", 5).empty();
+        report("Streaming with a limit; index built later equals the db_ walk", pass);
+    }
+
+    {
+        std::uint64_t clock = 1000;
+        InMemoryDB db;
+        db.setClock([&] { return clock; });
+        db.setValueIndex(true);
+        db.setMemoryLimit(256 * 1024);
+        for (int i = 0; i < 20000; ++i) {
+            std::string key = "key:" + std::to_string(i) + std::string(30, 'k');
+            if (i % 3 == 0) db.set(key, std::to_string(i % 4), std::chrono::milliseconds(5));
+            else            db.set(key, std::to_string(i % 4));
+            if (i % 1000 == 0) { clock += 10; db.expire(); }
+        }
+        bool pass = db.cacheStats().evictions > 0 && db.expiredKeys() > 0;
+        for (int v = 0; v < 4; ++v)
+            pass = pass && indexed(db, std::to_string(v)) == holders(db, std::to_string(v));
+        report("Expiry and eviction keep the index exact", pass);
+    }
+}
+
+static void runCounterTests() {
+    SuiteReport report("Counter");
+
+    {
+        std::uint64_t clock = 1000;
+        InMemoryDB db;
+        db.setClock([&] { return clock; });
+        bool pass = db.incr("c") == 1 && db.incr("c", 41) == 42 && db.incr("c", -50) == -8
+                 && db.get("c") == "-8" && db.count("-8") == 1;
+        for (const char* bad : { "x", "", "007", "+5", "-0", "1.5", "12 " }) {
+            db.set("s", bad);
+            pass = pass && !db.incr("s") && db.get("s") == bad;
+        }
+        db.set("max", std::to_string(INT64_MAX));
+        pass = pass && !db.incr("max") && db.incr("max", INT64_MIN) == -1;
+        {
+            InMemoryDB edge;
+            edge.set("min", std::to_string(INT64_MIN));
+            pass = pass && !edge.incr("min", -1) && edge.get("min") == std::to_string(INT64_MIN)
+                && edge.incr("min", INT64_MAX) == -1 && edge.incr("zero", INT64_MIN) == INT64_MIN
+                && !edge.incr("zero", -1);
+        }
+        db.set("t", "5", std::chrono::milliseconds(100));
+        pass = pass && db.incr("t") == 6 && db.ttl("t") == std::chrono::milliseconds(100);
+        db.set("d", "6");                               // an id shared with "t"
+        pass = pass && db.incr("d", -6) == 0 && db.count("6") == 1 && db.count("0") == 1
+            && db.incr("t", -6) == 0 && db.count("0") == 2 && db.internedValues() == 4;
+        clock += 100;
+        db.expire();
+        pass = pass && db.incr("t") == 1 && !db.ttl("t");   // an expired counter restarts
+        report("INCR semantics, bad values, overflow, TTL kept", pass);
+    }
+
+    for (TxnMode mode : { TxnMode::UndoLog, TxnMode::Overlay }) {
+        InMemoryDB db(mode);
+        db.setValueIndex(true);
+        std::vector<std::map<std::string, std::string>> model(1);
+        std::mt19937 rng(mode == TxnMode::Overlay ? 41 : 40);
+        bool pass = true;
+        for (int step = 0; step < 30000 && pass; ++step) {
+            const std::string key = "c" + std::to_string(rng() % 24);
+            const std::string num = std::to_string(static_cast<int>(rng() % 9) - 4);
+            auto& cur = model.back();
+            switch (rng() % 12) {
+            case 0: case 1: case 2: case 3: {
+                const std::int64_t delta = static_cast<int>(rng() % 5) - 2;
+                auto it = cur.find(key);
+                const std::int64_t want = (it == cur.end() ? 0 : std::stoll(it->second)) + delta;
+                pass = db.incr(key, delta) == want;
+                cur[key] = std::to_string(want);
+                break;
+            }
+            case 4:  db.set(key, num); cur[key] = num; break;
+            case 5:  db.del(key); cur.erase(key); break;
+            case 6:  if (model.size() < 5) { db.begin(); model.push_back(cur); } break;
+            case 7:  db.rollback(); if (model.size() > 1) model.pop_back(); break;
+            case 8:
+                db.release();
+                if (model.size() > 1) { model[model.size() - 2] = cur; model.pop_back(); }
+                break;
+            case 9:  if (rng() % 3 == 0) { db.commit(); model.front() = cur; model.resize(1); } break;
+            default: {
+                auto it = cur.find(key);
+                pass = db.get(key) == (it == cur.end() ? std::nullopt : std::optional<std::string>(it->second));
+                std::size_t n = 0;
+                for (auto& kv : cur) n += kv.second == num;
+                pass = pass && db.count(num) == n && db.keysWithValue(num, std::size_t(-1)).size() == n;
+            }
+            }
+        }
+        report(std::string("Random INCR / SET / txns against a model")
+               + (mode == TxnMode::Overlay ? " (overlay)" : " (undo log)"), pass);
+    }
+
+    {
+        InMemoryDB db;
+        std::vector<std::string> keys;
+        for (int i = 0; i < 1000; ++i) keys.push_back("counter:" + std::to_string(i));
+        for (std::size_t i = 0; i < keys.size(); ++i)   // 13 digits, far apart: no two
+            db.incr(keys[i], 1'000'000'000'000LL + 1'000'000LL * i);   // ever meet
+        std::size_t before = allocCount();
+        for (int r = 0; r < 200; ++r)
+            for (auto& k : keys) db.incr(k, r % 3 ? 1 : -1);
+        const std::size_t outside = allocCount() - before;
+
+        db.begin();
+        for (auto& k : keys) db.incr(k);                // logs the old ids
+        before = allocCount();
+        for (int r = 0; r < 100; ++r)
+            for (auto& k : keys) db.incr(k);
+        const std::size_t inside = allocCount() - before;
+        db.rollback();
+        bool pass = outside == 0 && inside == 0 && db.get("counter:0") == "1000000000066"
+                 && db.count("1000000000066") == 1;
+        report("Zero-alloc increments (" + std::to_string(outside + inside) + " allocations in 300000)", pass);
+    }
+
+    {
+        struct Recorder : CommitObserver {
+            std::vector<std::pair<std::string, std::string>> seen;
+            void onCommit(std::span<const CommittedChange> c) override {
+                for (auto& ch : c) seen.emplace_back(ch.key, ch.val.value_or("<del>"));
+            }
+        } rec;
+        InMemoryDB db;
+        for (int i = 0; i < 100; ++i) db.set("k" + std::to_string(i), std::to_string(i));
+        db.setCommitObserver(&rec);
+        db.beginSnapshot();
+        db.incr("k5", 100);                             // before the walk reaches it
+        std::map<std::string, std::string> snap;
+        while (db.snapshotStep(10, [&](std::string_view k, std::string_view v) { snap.emplace(k, v); })) {}
+        db.endSnapshot();
+        db.begin();
+        db.incr("k6");
+        db.incr("k6");
+        db.commit();
+        db.setCommitObserver(nullptr);
+        bool pass = snap.size() == 100 && snap["k5"] == "5" && db.get("k5") == "105"
+                 && rec.seen == std::vector<std::pair<std::string, std::string>>{ { "k5", "105" }, { "k6", "8" } };
+        report("Snapshots and observers see the counter text", pass);
+    }
+
+    {
+        InMemoryDB db;
+        CommandProcessor cp(db);
+        cp.execute("INCR c\nINCRBY c 10\nDECR c\nGET c\nCOUNT 10\nSET s x\nINCR s\nINCRBY c 1x\n"
+                   "INCRBY c\nINCRBY c -20\n");
+        report("INCR / DECR / INCRBY commands",
+               cp.output() == "1\n11\n10\n10\n1\nERR value is not an integer or out of range\n"
+                              "ERR value is not an integer or out of range\n"
+                              "ERR wrong number of arguments\n-10\n");
+    }
+
+    {
+        ShardedInMemoryDB sharded(8);
+        MvccInMemoryDB mvcc;
+        for (int i = 0; i < 50; ++i) {
+            sharded.incr("hits:" + std::to_string(i % 5), i);
+            mvcc.incr("hits");
+        }
+        auto before = mvcc.snapshot();
+        mvcc.incr("hits", -50);
+        bool pass = sharded.get("hits:4") == "265" && sharded.count("265") == 1
+                 && mvcc.get("hits") == "0" && before.get("hits") == "50"
+                 && !sharded.incr("hits:0", INT64_MAX) && sharded.get("hits:0") == "225";
+        report("Sharded and MVCC front ends", pass);
+    }
+}
+
+static void runStatsTests() {
+    SuiteReport report("Stats");
+    constexpr bool on = DbStats::enabled;
+
+    {
+        std::mt19937_64 rng(5);
+        LatencyHistogram h;
+        std::vector<std::uint64_t> vals(100000);
+        for (auto& v : vals) { v = rng() % 2'000'000; h.record(v); }
+        std::sort(vals.begin(), vals.end());
+        bool pass = h.count() == vals.size() && h.max() == vals.back();
+        for (double p : { 0.0, 0.5, 0.9, 0.99, 0.999, 1.0 }) {
+            std::uint64_t exact = vals[std::max<std::size_t>(1, std::size_t(std::ceil(p * double(vals.size())))) - 1];
+            std::uint64_t got   = h.percentile(p);
+            pass = pass && got >= exact && got <= exact + exact / 16;
+        }
+        for (int i = 0; i < 10000 && pass; ++i) {
+            std::uint64_t v = rng() >> (rng() % 64);
+            std::size_t   b = LatencyHistogram::bucketOf(v);
+            pass = b < LatencyHistogram::kBuckets
+                && (b + 1 == LatencyHistogram::kBuckets || LatencyHistogram::bucketTop(b) >= v)
+                && LatencyHistogram::bucketOf(LatencyHistogram::bucketTop(b)) == b;
+        }
+        report("Percentiles are within 1/16 above the exact value", pass);
+    }
+
+    {
+        InMemoryDB db;
+        for (int i = 0; i < 1000; ++i) db.set("k" + std::to_string(i), "v");
+        for (int i = 0; i < 300; ++i)  db.get("k" + std::to_string(i));
+        for (int i = 0; i < 200; ++i)  db.getView("missing");
+        db.del("k1");
+        db.count("v");
+        std::vector<std::string_view> keys = { "k2", "k3", "k4" };
+        db.mget(keys);
+        db.mdel(keys);
+        db.begin();
+        db.rollback();
+        db.rollback();                                  // NoTransaction still counts
+        db.commit();
+        DbStats st = db.stats();
+        auto calls   = [&](DbOp op) { return st[op].calls; };
+        auto sampled = [&](DbOp op) { return st[op].latency.count(); };
+        bool pass = calls(DbOp::Set) == (on ? 1000 : 0) && calls(DbOp::Get) == (on ? 503 : 0)
+                 && calls(DbOp::Del) == (on ? 4 : 0) && calls(DbOp::Count) == (on ? 1 : 0)
+                 && calls(DbOp::Begin) == (on ? 1 : 0) && calls(DbOp::Rollback) == (on ? 2 : 0)
+                 && calls(DbOp::Commit) == (on ? 1 : 0)
+                 && sampled(DbOp::Set) == (on ? 1000 / DbStats::kSampleEvery + 1 : 0)
+                 && sampled(DbOp::Get) == (on ? 500 / DbStats::kSampleEvery + 1 : 0)
+                 && st.keys == 996 && st.slots >= 996;
+        db.resetStats();
+        pass = pass && db.stats()[DbOp::Set].calls == 0 && db.stats().keys == 996;
+        report(on ? "Every call counted, one in kSampleEvery timed"
+                  : "Compiled out: counters stay zero, gauges still read", pass);
+    }
+
+    {
+        bool pass = true;
+        for (TxnMode mode : { TxnMode::UndoLog, TxnMode::Overlay }) {
+            InMemoryDB db(mode);
+            db.set("a", "1");
+            pass = pass && db.stats().txnDepth == 0 && db.stats().undoBytes == 0;
+            db.begin();
+            db.set("a", "2");
+            db.begin();
+            db.set(std::string(100, 'b'), "3");
+            DbStats inside = db.stats();
+            db.commit();
+            DbStats after = db.stats();
+            pass = pass && inside.txnDepth == 2 && inside.undoBytes > 100
+                 && after.txnDepth == 0 && after.undoBytes == 0 && after.keys == 2;
+        }
+        report("Transaction depth and undo bytes in both modes", pass);
+    }
+
+    {
+        ShardedInMemoryDB sharded(8);
+        for (int i = 0; i < 4000; ++i) sharded.set("key" + std::to_string(i), "v");
+        for (int i = 0; i < 4000; ++i) sharded.get("key" + std::to_string(i));
+        DbStats st = sharded.stats();
+        std::string text = st.text();
+        bool pass = st.keys == 4000 && st[DbOp::Get].calls == (on ? 4000 : 0)
+                 && st[DbOp::Get].latency.count() == 0              // lock-free: not timed
+                 && st[DbOp::Set].latency.count() >= (on ? 4000 / DbStats::kSampleEvery : 0)
+                 && text.find("get      calls=") != std::string::npos
+                 && text.find("\nkeys=4000\n") != std::string::npos
+                 && text.find("txn_depth=0") != std::string::npos;
+        report("Sharded stats sum the shards; text dump", pass);
+    }
+}
+
+static int fdOf(std::FILE* f) {
+#ifdef _WIN32
+    return _fileno(f);
+#else
+    return fileno(f);
+#endif
+}
+
+static void runCommandProcessorTests() {
+    SuiteReport report("Command");
+
+    bool opcodes = opcodeOf("SET") == Opcode::Set && opcodeOf("ROLLBACK") == Opcode::Rollback
+                && opcodeOf("RELEASE") == Opcode::Release
+                && opcodeOf("MDEL") == Opcode::MDel && opcodeOf("set") == Opcode::Unknown
+                && opcodeOf("SETX") == Opcode::Unknown && opcodeOf("GE") == Opcode::Unknown
+                && opcodeOf("") == Opcode::Unknown;
+    report("Opcode table", opcodes);
+
+    // Examples 3 and 7 from runInMemoryDbTests, plus batches and bad input
+    const std::string script =
+        "BEGIN\nSET a 10\nGET a\nBEGIN\nSET a 20\nGET a\nROLLBACK\nGET a\nROLLBACK\nGET a\n"
+        "SET a 10\r\nSET b 10\nBEGIN\nSET a 20\nBEGIN\nSET b 20\nCOUNT 20\nCOUNT 10\n"
+        "ROLLBACK\nCOUNT 20\nROLLBACK\nCOUNT 10\nCOUNT 20\nGET a\n"
+        "\n# comment\n  MSET x 1\ty 2 z 1\nMGET x y nope z\nMDEL x y\nCOUNT 1\n"
+        "COMMIT\nFOO bar\nGET\nMSET k\nGET z";           // no trailing newline
+    const std::string expected =
+        "10\n20\n10\nNULL\n2\n0\n1\n2\n0\n10\n1 2 NULL 1\n1\nNO TRANSACTION\n"
+        "ERR unknown command\nERR wrong number of arguments\nERR wrong number of arguments\n1\n";
+
+    {
+        InMemoryDB db;
+        CommandProcessor cp(db);
+        std::size_t n = cp.execute(script);
+        report("Script output", cp.output() == expected && n == 33 && cp.errors() == 3);
+    }
+
+    {
+        namespace fs = std::filesystem;
+        const std::string in  = (fs::temp_directory_path() / "algoplayground_cmds.txt").string();
+        const std::string out = (fs::temp_directory_path() / "algoplayground_cmds.out").string();
+        {
+            std::ofstream f(in, std::ios::binary);
+            for (int i = 0; i < 100000; ++i)             // spans several 1 MiB reads
+                f << "SET key:" << i << " v" << i % 10 << "\n";
+            f << script;
+        }
+        std::FILE* inF  = std::fopen(in.c_str(), "rb");
+        std::FILE* outF = std::fopen(out.c_str(), "wb");
+        std::size_t viaFd = 0, viaMap = 0;
+        std::string mapOut;
+        {
+            InMemoryDB db;
+            CommandProcessor cp(db, fdOf(outF));
+            viaFd = cp.runFd(fdOf(inF));
+        }
+        std::fclose(inF);
+        std::fclose(outF);
+        {
+            InMemoryDB db;
+            CommandProcessor cp(db);
+            viaMap = cp.runFile(in);
+            mapOut = std::string(cp.output());
+        }
+        std::ifstream r(out, std::ios::binary);
+        std::string fdOut((std::istreambuf_iterator<char>(r)), std::istreambuf_iterator<char>());
+        report("Streaming from fd and mmap",
+               viaFd == 100033 && viaMap == 100033 && fdOut == expected && mapOut == expected);
+        fs::remove(in);
+        fs::remove(out);
+    }
+}
+
+#ifdef __linux__
+/* minimal blocking client for the server tests */
+static int connectLocal(std::uint16_t port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port   = htons(port);
+    ::inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) < 0) { ::close(fd); return -1; }
+    return fd;
+}
+
+static void sendAll(int fd, std::string_view s) {
+    while (!s.empty()) {
+        auto n = ::send(fd, s.data(), s.size(), MSG_NOSIGNAL);
+        if (n <= 0) return;
+        s.remove_prefix(static_cast<std::size_t>(n));
+    }
+}
+
+/* reads until `want` bytes arrived, EOF, or timeoutMs of silence */
+static std::string recvSome(int fd, std::size_t want, int timeoutMs = 2000) {
+    std::string got;
+    char buf[4096];
+    while (got.size() < want) {
+        pollfd p{ fd, POLLIN, 0 };
+        if (::poll(&p, 1, timeoutMs) <= 0) break;
+        auto n = ::recv(fd, buf, sizeof buf, 0);
+        if (n <= 0) break;
+        got.append(buf, static_cast<std::size_t>(n));
+    }
+    return got;
+}
+
+static void runServerTests() {
+    SuiteReport report("Server");
+
+    InMemoryDB  db;
+    DbServer    server(db);
+    std::thread loop([&] { server.run(); });
+
+    {
+        int c = connectLocal(server.port());
+        sendAll(c, "SET a 10\r\n*2\r\n$3\r\nGET\r\n$1\r\na\r\nCOUNT 10\r\nGET nope\r\n"
+                   "ROLLBACK\r\nFOO\r\n*3\r\n$4\r\nMGET\r\n$1\r\na\r\n$1\r\nb\r\n");
+        const std::string want = "+OK\r\n$2\r\n10\r\n:1\r\n$-1\r\n-NO TRANSACTION\r\n"
+                                 "-ERR unknown command\r\n*2\r\n$2\r\n10\r\n$-1\r\n";
+        report("Pipelined RESP + inline", recvSome(c, want.size()) == want);
+        ::close(c);
+    }
+
+    {
+        int a = connectLocal(server.port()), b = connectLocal(server.port());
+        sendAll(a, "BEGIN\r\nSET t 1\r\n");
+        bool began = recvSome(a, 10) == "+OK\r\n+OK\r\n";
+        sendAll(b, "GET t\r\n");
+        bool waited = recvSome(b, 1, 100).empty();      // parked behind a's txn
+        sendAll(a, "COMMIT\r\n");
+        bool committed = recvSome(a, 5) == "+OK\r\n";
+        report("Other connections wait for the txn owner",
+               began && waited && committed && recvSome(b, 7) == "$1\r\n1\r\n");
+
+        sendAll(a, "BEGIN\r\nSET u 1\r\n");
+        recvSome(a, 10);
+        sendAll(b, "GET u\r\n");
+        ::close(a);                                      // abandoned txn rolls back
+        report("Disconnect rolls back", recvSome(b, 5) == "$-1\r\n");
+        ::close(b);
+    }
+
+    {
+        int c = connectLocal(server.port());
+        sendAll(c, "*1\r\n$x\r\n");
+        std::string got = recvSome(c, 64);
+        report("Malformed frame closes the connection", got == "-ERR protocol error\r\n");
+        ::close(c);
+    }
+
+    server.stop();
+    loop.join();
 }
+#endif
 
 static void runBitonicTSPTests() {
     const double EPS = 1e-3;
@@ -347,8 +2505,44 @@ static void runLexiPathTests() {
 int main() {
     cout << "Running ClosestPairSolver Tests:" << endl;
     runClosestPairTests();
+    cout << "Running FlatHashMap Tests:" << endl;
+    runFlatHashMapTests();
+    cout << "Running IncrementalHashMap Tests:" << endl;
+    runIncrementalHashMapTests();
     cout << "Running InMemoryDb Tests:" << endl;
     runInMemoryDbTests();
+    cout << "Running ShardedDB Tests:" << endl;
+    runShardedDbTests();
+    cout << "Running Epoch Tests:" << endl;
+    runEpochTests();
+    cout << "Running MVCC Tests:" << endl;
+    runMvccTests();
+    cout << "Running WAL Tests:" << endl;
+    runWalTests();
+    cout << "Running ChangeStream Tests:" << endl;
+    runChangeStreamTests();
+    cout << "Running Checkpoint Tests:" << endl;
+    runCheckpointTests();
+    cout << "Running Snapshot Tests:" << endl;
+    runSnapshotTests();
+    cout << "Running Ordered Scan Tests:" << endl;
+    runOrderedScanTests();
+    cout << "Running TTL Tests:" << endl;
+    runTtlTests();
+    cout << "Running Memory Limit Tests:" << endl;
+    runMemoryLimitTests();
+    cout << "Running Value Index Tests:" << endl;
+    runValueIndexTests();
+    cout << "Running Counter Tests:" << endl;
+    runCounterTests();
+    cout << "Running Stats Tests:" << endl;
+    runStatsTests();
+    cout << "Running CommandProcessor Tests:" << endl;
+    runCommandProcessorTests();
+#ifdef __linux__
+    cout << "Running Server Tests:" << endl;
+    runServerTests();
+#endif
     cout << "Running BitonicTSP Tests:" << endl;
     runBitonicTSPTests();
     cout << "Running LexiSSSP Tests:" << endl;
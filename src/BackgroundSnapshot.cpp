@@ -0,0 +1,66 @@
+#include "BackgroundSnapshot.h"
+#include "WriteAheadLog.h"
+
+#include <filesystem>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+BackgroundSnapshot::BackgroundSnapshot(InMemoryDB& db, mutex& mu, string path, size_t batch)
+    : db_(db), mu_(mu), path_(std::move(path)), batch_(batch ? batch : 1) {
+    {
+        lock_guard lock(mu_);
+        db_.beginSnapshot();                    // the point in time
+    }
+    thread_ = thread(&BackgroundSnapshot::run, this);
+}
+
+BackgroundSnapshot::~BackgroundSnapshot() {
+    if (thread_.joinable()) thread_.join();
+}
+
+void BackgroundSnapshot::wait() {
+    if (thread_.joinable()) thread_.join();
+    if (error_) rethrow_exception(exchange(error_, nullptr));
+}
+
+void BackgroundSnapshot::run() {
+    const string tmp = path_ + ".tmp";
+    try {
+        filesystem::remove(tmp);                // left over from a crash: WAL appends
+        {
+            WriteAheadLog out(tmp, { Durability::None });
+            vector<pair<string, string>> copied;   // reused: assign keeps the capacity
+            vector<CommittedChange>      changes;
+            for (bool more = true; more;) {
+                size_t n = 0;
+                {
+                    lock_guard lock(mu_);
+                    more = db_.snapshotStep(batch_, [&](string_view k, string_view v) {
+                        if (n == copied.size()) copied.emplace_back();
+                        copied[n].first.assign(k);
+                        copied[n].second.assign(v);
+                        ++n;
+                    });
+                }
+                if (n == 0) continue;
+                changes.clear();
+                for (size_t i = 0; i < n; ++i) changes.push_back({ copied[i].first, copied[i].second });
+                out.onCommit(changes);
+                keys_.fetch_add(n, memory_order_relaxed);
+            }
+            out.sync();
+        }
+        filesystem::rename(tmp, path_);         // atomic replace
+    } catch (...) {
+        error_ = current_exception();
+        {
+            lock_guard lock(mu_);
+            db_.endSnapshot();
+        }
+        error_code ec;
+        filesystem::remove(tmp, ec);
+    }
+    done_.store(true, memory_order_release);
+}
@@ -0,0 +1,210 @@
+#include "ChangeStream.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+using namespace std;
+
+/* ─────────────────── encoding helpers ─────────────────── */
+namespace {
+
+constexpr uint64_t kRecordOverhead = 3;                // seq, header, trailing seq
+
+char* putU32(char* p, size_t v) {
+    const uint32_t u = static_cast<uint32_t>(v);
+    memcpy(p, &u, sizeof u);
+    return p + sizeof u;
+}
+
+char* putBytes(char* p, string_view s) {
+    p = putU32(p, s.size());
+    return copy(s.begin(), s.end(), p);                   // s.data() may be null when empty
+}
+
+uint32_t getU32(const char*& p) {
+    uint32_t u;
+    memcpy(&u, p, sizeof u);
+    p += sizeof u;
+    return u;
+}
+
+uint64_t payloadWords(uint64_t header) { return ((header & 0xFFFFFFFFu) + 7) >> 3; }
+
+} // namespace
+
+/* ─────────────────── stream (writer side) ─────────────────── */
+ChangeStream::ChangeStream(size_t capacityBytes, Overflow overflow)
+    : ring_(bit_ceil(max<size_t>(capacityBytes / sizeof(uint64_t), 8))),
+      mask_(ring_.size() - 1),
+      overflow_(overflow) {}
+
+void ChangeStream::onCommit(span<const CommittedChange> changes) {
+    size_t bytes = 0;
+    for (const auto& c : changes) bytes += 5 + c.key.size() + (c.val ? 4 + c.val->size() : 0);
+    const uint64_t words = (bytes + 7) >> 3;
+    const uint64_t size  = ring_.size();
+    if (words + kRecordOverhead > size || bytes > 0xFFFFFFFFu)
+        throw length_error("ChangeStream: record larger than the ring");
+    if (scratch_.size() < words * 8) scratch_.resize(words * 8);
+    char* out = scratch_.data();
+    for (const auto& c : changes) {
+        *out++ = static_cast<char>(c.val ? 1 : 0);
+        out = putBytes(out, c.key);
+        if (c.val) out = putBytes(out, *c.val);
+    }
+    memset(out, 0, words * 8 - bytes);                      // padding of the last word
+
+    const uint64_t head = head_.load(memory_order_relaxed);   // only this thread stores it
+    const uint64_t end  = head + words + kRecordOverhead;
+    if (overflow_ == Overflow::Block) waitForRoom(end);
+    if (end - tailW_ > size) {
+        do tailW_ += kRecordOverhead + payloadWords(word(tailW_ + 1));
+        while (end - tailW_ > size);
+        tail_.store(tailW_, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);            // readers that see new words see tail_
+    }
+
+    const uint64_t seq = ++seq_;
+    ring_[head & mask_].store(seq, memory_order_relaxed);
+    ring_[(head + 1) & mask_].store(bytes | (uint64_t(changes.size()) << 32), memory_order_relaxed);
+    const char* p = scratch_.data();
+    for (uint64_t i = 0; i < words; ++i, p += 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        ring_[(head + 2 + i) & mask_].store(w, memory_order_relaxed);
+    }
+    ring_[(end - 1) & mask_].store(seq, memory_order_relaxed);
+    head_.store(end, memory_order_release);
+}
+
+uint64_t ChangeStream::lowestCursor(uint64_t head) const {
+    uint64_t low = head;
+    for (const auto& s : slots_)
+        if (s.inUse.load(memory_order_acquire)) low = min(low, s.cursor.load(memory_order_acquire));
+    return low;
+}
+
+void ChangeStream::waitForRoom(uint64_t end) {
+    const uint64_t low = end - ring_.size();                // every reader must be at or past this
+    const uint32_t v = readersVersion_.load(memory_order_acquire);
+    if (v != seenVersion_) {                                // a reader came or went: rescan
+        seenVersion_ = v;
+        floor_ = lowestCursor(head_.load(memory_order_relaxed));
+    }
+    if (end <= ring_.size() || low <= floor_) return;       // the common case: no scan
+    for (;;) {
+        floor_ = lowestCursor(head_.load(memory_order_relaxed));
+        if (low <= floor_) return;
+        this_thread::yield();
+    }
+}
+
+ChangeStream::Reader ChangeStream::subscribe() {
+    for (size_t i = 0; i < kMaxReaders; ++i) {
+        bool expected = false;
+        if (slots_[i].inUse.compare_exchange_strong(expected, true, memory_order_acq_rel))
+            return Reader(*this, i);
+    }
+    throw length_error("ChangeStream: too many readers");
+}
+
+/* ─────────────────── reader ─────────────────── */
+ChangeStream::Reader::Reader(ChangeStream& s, size_t slot) : stream_(&s), slot_(slot) {
+    /* Start at head_; the trailing seq of the record before it says which
+       seq comes next.  Retry if that record is being overwritten. */
+    for (;;) {
+        cursor_ = s.head_.load(memory_order_acquire);
+        s.slots_[slot_].cursor.store(cursor_, memory_order_seq_cst);
+        if (cursor_ == 0) {
+            nextSeq_ = 1;
+            break;
+        }
+        const uint64_t last = s.word(cursor_ - 1);
+        atomic_thread_fence(memory_order_acquire);
+        if (s.tail_.load(memory_order_relaxed) < cursor_) {
+            nextSeq_ = last + 1;
+            break;
+        }
+    }
+    s.readersVersion_.fetch_add(1, memory_order_seq_cst);
+}
+
+ChangeStream::Reader::Reader(Reader&& o) noexcept
+    : stream_(o.stream_), slot_(o.slot_), cursor_(o.cursor_), nextSeq_(o.nextSeq_),
+      seq_(o.seq_), lost_(o.lost_), words_(std::move(o.words_)), changes_(std::move(o.changes_)) {
+    o.stream_ = nullptr;
+}
+
+ChangeStream::Reader& ChangeStream::Reader::operator=(Reader&& o) noexcept {
+    if (this != &o) {
+        if (stream_) {
+            stream_->slots_[slot_].inUse.store(false, memory_order_release);
+            stream_->readersVersion_.fetch_add(1, memory_order_release);
+        }
+        stream_  = exchange(o.stream_, nullptr);
+        slot_    = o.slot_;
+        cursor_  = o.cursor_;
+        nextSeq_ = o.nextSeq_;
+        seq_     = o.seq_;
+        lost_    = o.lost_;
+        words_   = std::move(o.words_);
+        changes_ = std::move(o.changes_);
+    }
+    return *this;
+}
+
+ChangeStream::Reader::~Reader() {
+    if (!stream_) return;
+    stream_->slots_[slot_].inUse.store(false, memory_order_release);
+    stream_->readersVersion_.fetch_add(1, memory_order_release);
+}
+
+bool ChangeStream::Reader::next() {
+    ChangeStream& s = *stream_;
+    for (;;) {
+        const uint64_t head = s.head_.load(memory_order_acquire);
+        if (cursor_ == head) return false;
+        const uint64_t tail = s.tail_.load(memory_order_acquire);
+        if (cursor_ < tail) {                               // lapped: resume at the oldest
+            cursor_ = tail;
+            continue;
+        }
+
+        const uint64_t seq    = s.word(cursor_);
+        const uint64_t header = s.word(cursor_ + 1);
+        const uint64_t words  = payloadWords(header);
+        const bool     sane   = words + kRecordOverhead <= head - cursor_;
+        if (sane) {
+            words_.resize(words);
+            for (uint64_t i = 0; i < words; ++i) words_[i] = s.word(cursor_ + 2 + i);
+        }
+        atomic_thread_fence(memory_order_acquire);
+        if (!sane || s.tail_.load(memory_order_relaxed) > cursor_) continue;   // torn copy
+
+        changes_.clear();
+        const char* p = reinterpret_cast<const char*>(words_.data());
+        for (uint64_t n = header >> 32; n--; ) {
+            const bool set = *p++ != 0;
+            const uint32_t klen = getU32(p);
+            CommittedChange c{ string_view(p, klen), nullopt };
+            p += klen;
+            if (set) {
+                const uint32_t vlen = getU32(p);
+                c.val = string_view(p, vlen);
+                p += vlen;
+            }
+            changes_.push_back(c);
+        }
+
+        lost_   += seq - nextSeq_;
+        seq_     = seq;
+        nextSeq_ = seq + 1;
+        cursor_ += words + kRecordOverhead;
+        s.slots_[slot_].cursor.store(cursor_, memory_order_release);
+        return true;
+    }
+}
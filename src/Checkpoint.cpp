@@ -0,0 +1,302 @@
+#include "Checkpoint.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+using namespace std;
+
+static_assert(endian::native == endian::little, "checkpoint files are little-endian");
+
+struct Checkpoint::Header {
+    char     magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t keyCount, valueCount;
+    uint64_t keyBuckets, valueBuckets;
+    uint64_t valueDirOff, keyDirOff, keyIndexOff, valueIndexOff, blobOff, fileSize;
+};
+
+struct Checkpoint::ValueRec {
+    uint64_t off;
+    uint32_t len;
+    uint32_t reserved;
+    uint64_t count;
+};
+
+struct Checkpoint::KeyRec {
+    uint64_t off;
+    uint32_t len;
+    uint32_t valueIdx;
+};
+
+/* ─────────────────── format helpers ─────────────────── */
+namespace {
+
+constexpr char     kMagic[8] = { 'I', 'M', 'D', 'B', 'C', 'K', 'P', 'T' };
+constexpr uint32_t kVersion  = 1;
+constexpr size_t   kHeaderSize   = 96;
+constexpr size_t   kValueRecSize = 24;
+constexpr size_t   kKeyRecSize   = 16;
+
+/* part of the file format – must never change for version 1 */
+uint64_t formatHash(string_view s) {
+    constexpr uint64_t k1 = 0x9E3779B97F4A7C15ull, k2 = 0xBF58476D1CE4E5B9ull;
+    const char* p = s.data();
+    size_t      n = s.size();
+    uint64_t    h = k1 ^ (n * k2);
+    for (; n >= 8; p += 8, n -= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        h = rotl(h ^ (w * k1), 31) * k2;
+    }
+    uint64_t w = 0;
+    if (n) memcpy(&w, p, n);
+    h ^= w * k1;
+    h ^= h >> 30; h *= k2;                      // splitmix64 finalizer
+    h ^= h >> 27; h *= 0x94D049BB133111EBull;
+    h ^= h >> 31;
+    return h;
+}
+
+uint64_t bucketsFor(size_t n) { return bit_ceil(max<uint64_t>(8, uint64_t(n) * 2)); }
+
+struct Offsets {
+    uint64_t valueDir, keyDir, keyIndex, valueIndex, blob;
+};
+
+/* section offsets implied by the counts; used to write and to validate */
+Offsets layoutFor(uint64_t keys, uint64_t values, uint64_t keyBuckets, uint64_t valueBuckets) {
+    Offsets o;
+    o.valueDir   = kHeaderSize;
+    o.keyDir     = o.valueDir + values * kValueRecSize;
+    o.keyIndex   = o.keyDir + keys * kKeyRecSize;
+    o.valueIndex = o.keyIndex + keyBuckets * 8;
+    o.blob       = o.valueIndex + valueBuckets * 8;
+    return o;
+}
+
+/* linear-probing index over hashes[i]; slot = hash tag | (i + 1) */
+vector<uint64_t> buildIndex(const vector<uint64_t>& hashes, uint64_t buckets) {
+    vector<uint64_t> idx(buckets, 0);
+    const uint64_t mask = buckets - 1;
+    for (size_t i = 0; i < hashes.size(); ++i) {
+        uint64_t b = hashes[i] & mask;
+        while (idx[b]) b = (b + 1) & mask;
+        idx[b] = (hashes[i] >> 32) << 32 | (uint64_t(i) + 1);
+    }
+    return idx;
+}
+
+/* probe an index; match(i) compares the i-th entry's string */
+template <class Match>
+optional<size_t> probe(const uint64_t* idx, uint64_t buckets, uint64_t limit,
+                       uint64_t hash, Match&& match) {
+    const uint64_t mask = buckets - 1;
+    uint64_t b = hash & mask;
+    for (uint64_t n = 0; n < buckets; ++n, b = (b + 1) & mask) {
+        uint64_t s = idx[b];
+        if (!s) return nullopt;
+        if ((s >> 32) != (hash >> 32)) continue;
+        uint64_t i = (s & 0xFFFFFFFFu) - 1;
+        if (i >= limit) throw runtime_error("corrupt checkpoint index");
+        if (match(static_cast<size_t>(i))) return static_cast<size_t>(i);
+    }
+    return nullopt;
+}
+
+template <class T>
+void put(ofstream& out, const T& v) { out.write(reinterpret_cast<const char*>(&v), sizeof v); }
+
+void syncFile(const string& path) {
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+#else
+    (void)path;
+#endif
+}
+
+} // namespace
+
+/* ─────────────────── write ─────────────────── */
+void Checkpoint::write(const string& path, const InMemoryDB& db) {
+    static_assert(sizeof(Header) == kHeaderSize && sizeof(ValueRec) == kValueRecSize
+                  && sizeof(KeyRec) == kKeyRecSize);
+    if (!db.txnStack_.empty() || !db.layers_.empty())
+        throw logic_error("Checkpoint::write with an open transaction");
+
+    /* committed key → value pairs: own tables plus the unshadowed image */
+    vector<pair<string_view, string_view>> kv;
+    kv.reserve(db.db_.size() + (db.image_ ? db.image_->keyCount() : 0));
+    for (const auto& [k, e] : db.db_) kv.emplace_back(k, db.values_[e.val]);
+    if (db.image_)
+        for (size_t i = 0; i < db.image_->keyCount(); ++i) {
+            string_view k = db.image_->keyAt(i);
+            if (!db.shadowed_.contains(k)) kv.emplace_back(k, db.image_->valueAt(i).val);
+        }
+    sort(kv.begin(), kv.end());
+    if (kv.size() >= 0xFFFFFFFFu) throw length_error("checkpoint: too many keys");
+
+    FlatHashMap<string_view, uint32_t> valueIdx;
+    vector<string_view>                vals;
+    vector<uint64_t>                   counts;
+    vector<uint32_t>                   keyVal(kv.size());
+    uint64_t                           blobBytes = 0;
+    for (size_t i = 0; i < kv.size(); ++i) {
+        auto [it, fresh] = valueIdx.try_emplace(kv[i].second, static_cast<uint32_t>(vals.size()));
+        if (fresh) {
+            vals.push_back(kv[i].second);
+            counts.push_back(0);
+            blobBytes += kv[i].second.size();
+        }
+        ++counts[it->second];
+        keyVal[i] = it->second;
+        blobBytes += kv[i].first.size();
+    }
+
+    Header h{};
+    memcpy(h.magic, kMagic, sizeof kMagic);
+    h.version      = kVersion;
+    h.headerSize   = kHeaderSize;
+    h.keyCount     = kv.size();
+    h.valueCount   = vals.size();
+    h.keyBuckets   = bucketsFor(kv.size());
+    h.valueBuckets = bucketsFor(vals.size());
+    Offsets o = layoutFor(h.keyCount, h.valueCount, h.keyBuckets, h.valueBuckets);
+    h.valueDirOff   = o.valueDir;
+    h.keyDirOff     = o.keyDir;
+    h.keyIndexOff   = o.keyIndex;
+    h.valueIndexOff = o.valueIndex;
+    h.blobOff       = o.blob;
+    h.fileSize      = o.blob + blobBytes;
+
+    const string tmp = path + ".tmp";
+    {
+        ofstream out(tmp, ios::binary | ios::trunc);
+        if (!out) throw runtime_error("cannot create checkpoint " + tmp);
+        put(out, h);
+
+        uint64_t off = o.blob;                  // blob: keys in order, then values
+        for (auto& [k, v] : kv) off += k.size();
+        vector<uint64_t> hashes(vals.size());
+        for (size_t i = 0; i < vals.size(); ++i) {
+            put(out, ValueRec{ off, static_cast<uint32_t>(vals[i].size()), 0, counts[i] });
+            off += vals[i].size();
+            hashes[i] = formatHash(vals[i]);
+        }
+        auto valueIndex = buildIndex(hashes, h.valueBuckets);
+
+        off = o.blob;
+        hashes.resize(kv.size());
+        for (size_t i = 0; i < kv.size(); ++i) {
+            put(out, KeyRec{ off, static_cast<uint32_t>(kv[i].first.size()), keyVal[i] });
+            off += kv[i].first.size();
+            hashes[i] = formatHash(kv[i].first);
+        }
+        auto keyIndex = buildIndex(hashes, h.keyBuckets);
+
+        out.write(reinterpret_cast<const char*>(keyIndex.data()),
+                  static_cast<streamsize>(keyIndex.size() * 8));
+        out.write(reinterpret_cast<const char*>(valueIndex.data()),
+                  static_cast<streamsize>(valueIndex.size() * 8));
+        for (auto& [k, v] : kv) out.write(k.data(), static_cast<streamsize>(k.size()));
+        for (auto v : vals)     out.write(v.data(), static_cast<streamsize>(v.size()));
+        if (!out.flush()) throw runtime_error("checkpoint write failed: " + tmp);
+    }
+    syncFile(tmp);
+    filesystem::rename(tmp, path);              // atomic replace
+}
+
+/* ─────────────────── open ─────────────────── */
+shared_ptr<const Checkpoint> Checkpoint::open(const string& path) {
+    shared_ptr<Checkpoint> cp(new Checkpoint(MappedFile(path, MappedFile::Access::Random)));
+
+    auto bad = [&](const char* why) { return runtime_error("checkpoint " + path + ": " + why); };
+    if (cp->size_ < kHeaderSize) throw bad("truncated header");
+    const Header& h = cp->header();
+    if (memcmp(h.magic, kMagic, sizeof kMagic) != 0) throw bad("bad magic");
+    if (h.version != kVersion || h.headerSize != kHeaderSize) throw bad("unsupported version");
+    if (h.fileSize != cp->size_) throw bad("size mismatch");
+    if (h.keyCount > cp->size_ / kKeyRecSize || h.valueCount > cp->size_ / kValueRecSize
+        || !has_single_bit(h.keyBuckets) || h.keyBuckets > cp->size_ / 8 || h.keyBuckets <= h.keyCount
+        || !has_single_bit(h.valueBuckets) || h.valueBuckets > cp->size_ / 8
+        || h.valueBuckets <= h.valueCount)
+        throw bad("bad counts");
+    Offsets o = layoutFor(h.keyCount, h.valueCount, h.keyBuckets, h.valueBuckets);
+    if (h.valueDirOff != o.valueDir || h.keyDirOff != o.keyDir || h.keyIndexOff != o.keyIndex
+        || h.valueIndexOff != o.valueIndex || h.blobOff != o.blob || o.blob > h.fileSize)
+        throw bad("bad section offsets");
+    return cp;
+}
+
+/* ─────────────────── lookups ─────────────────── */
+auto Checkpoint::valueRec(size_t i) const -> const ValueRec& {
+    return reinterpret_cast<const ValueRec*>(base_ + header().valueDirOff)[i];
+}
+
+auto Checkpoint::keyRec(size_t i) const -> const KeyRec& {
+    return reinterpret_cast<const KeyRec*>(base_ + header().keyDirOff)[i];
+}
+
+string_view Checkpoint::bytes(uint64_t off, uint32_t len) const {
+    if (off > size_ || len > size_ - off) throw runtime_error("corrupt checkpoint record");
+    return { base_ + off, len };
+}
+
+size_t Checkpoint::keyCount()   const { return static_cast<size_t>(header().keyCount); }
+size_t Checkpoint::valueCount() const { return static_cast<size_t>(header().valueCount); }
+
+string_view Checkpoint::keyAt(size_t i) const {
+    const KeyRec& r = keyRec(i);
+    return bytes(r.off, r.len);
+}
+
+size_t Checkpoint::lowerBound(string_view key) const {
+    size_t lo = 0, hi = keyCount();
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (keyAt(mid) < key) lo = mid + 1;
+        else                  hi = mid;
+    }
+    return lo;
+}
+
+Checkpoint::Hit Checkpoint::valueAt(size_t i) const {
+    uint32_t v = keyRec(i).valueIdx;
+    if (v >= header().valueCount) throw runtime_error("corrupt checkpoint record");
+    const ValueRec& r = valueRec(v);
+    return { bytes(r.off, r.len), v };
+}
+
+uint64_t Checkpoint::count(uint32_t valueIdx) const { return valueRec(valueIdx).count; }
+
+optional<Checkpoint::Hit> Checkpoint::find(string_view key) const {
+    const Header& h = header();
+    auto i = probe(reinterpret_cast<const uint64_t*>(base_ + h.keyIndexOff), h.keyBuckets,
+                   h.keyCount, formatHash(key), [&](size_t k) { return keyAt(k) == key; });
+    return i ? optional<Hit>(valueAt(*i)) : nullopt;
+}
+
+optional<uint32_t> Checkpoint::findValue(string_view val) const {
+    const Header& h = header();
+    auto i = probe(reinterpret_cast<const uint64_t*>(base_ + h.valueIndexOff), h.valueBuckets,
+                   h.valueCount, formatHash(val), [&](size_t v) {
+                       const ValueRec& r = valueRec(v);
+                       return bytes(r.off, r.len) == val;
+                   });
+    return i ? optional<uint32_t>(static_cast<uint32_t>(*i)) : nullopt;
+}
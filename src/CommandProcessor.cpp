@@ -0,0 +1,224 @@
+#include "CommandProcessor.h"
+#include "MappedFile.h"
+
+#include <charconv>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#ifdef _WIN32
+#  include <io.h>
+#else
+#  include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+long long readSome(int fd, char* p, size_t n) {
+#ifdef _WIN32
+    return _read(fd, p, static_cast<unsigned>(n));
+#else
+    return ::read(fd, p, n);
+#endif
+}
+
+void writeAll(int fd, const char* p, size_t n) {
+    while (n) {
+#ifdef _WIN32
+        long long w = _write(fd, p, static_cast<unsigned>(n > 0x40000000 ? 0x40000000 : n));
+#else
+        long long w = ::write(fd, p, n);
+#endif
+        if (w <= 0) throw runtime_error("command output write failed");
+        p += w;
+        n -= static_cast<size_t>(w);
+    }
+}
+
+/* split on spaces / tabs; views point into line */
+void tokenize(string_view line, vector<string_view>& out) {
+    out.clear();
+    const char* p   = line.data();
+    const char* end = p + line.size();
+    for (;;) {
+        while (p < end && (*p == ' ' || *p == '\t')) ++p;
+        if (p == end) return;
+        const char* b = p;
+        while (p < end && *p != ' ' && *p != '\t') ++p;
+        out.emplace_back(b, static_cast<size_t>(p - b));
+    }
+}
+
+bool parseInt64(string_view s, int64_t& v) {
+    auto r = from_chars(s.data(), s.data() + s.size(), v);
+    return r.ec == errc() && r.ptr == s.data() + s.size();
+}
+
+} // namespace
+
+CommandProcessor::CommandProcessor(InMemoryDB& db, int outFd) : db_(db), outFd_(outFd) {
+    out_.reserve(1u << 17);
+}
+
+CommandProcessor::~CommandProcessor() {
+    try { flush(); } catch (...) {}               // never throw from a destructor
+}
+
+void CommandProcessor::flush() {
+    if (outFd_ < 0 || out_.empty()) return;
+    writeAll(outFd_, out_.data(), out_.size());
+    out_.clear();
+}
+
+void CommandProcessor::error(string_view why) {
+    ++errors_;
+    out_ += "ERR ";
+    out_ += why;
+    out_ += '\n';
+}
+
+/* ─────────────────── dispatch ─────────────────── */
+void CommandProcessor::executeLine(string_view line) {
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    tokenize(line, tokens_);
+    if (tokens_.empty() || tokens_[0][0] == '#') return;
+    ++commands_;
+
+    const size_t args = tokens_.size() - 1;
+    auto arity = [&](size_t n) {
+        if (args == n) return true;
+        error("wrong number of arguments");
+        return false;
+    };
+
+    const Opcode op = opcodeOf(tokens_[0]);
+    switch (op) {
+    case Opcode::Set:
+        if (arity(2)) db_.set(tokens_[1], tokens_[2]);
+        break;
+    case Opcode::Get:
+        if (!arity(1)) break;
+        if (auto v = db_.getView(tokens_[1])) out_ += *v;
+        else                                  out_ += "NULL";
+        out_ += '\n';
+        break;
+    case Opcode::Delete:
+        if (arity(1)) db_.del(tokens_[1]);
+        break;
+    case Opcode::Count: {
+        if (!arity(1)) break;
+        char buf[24];
+        auto r = to_chars(buf, buf + sizeof buf, db_.count(tokens_[1]));
+        out_.append(buf, r.ptr);
+        out_ += '\n';
+        break;
+    }
+    case Opcode::Begin:
+        if (arity(0)) db_.begin();
+        break;
+    case Opcode::Rollback:
+        if (arity(0) && db_.rollback() == TxnStatus::NoTransaction) out_ += "NO TRANSACTION\n";
+        break;
+    case Opcode::Commit:
+        if (arity(0) && db_.commit() == TxnStatus::NoTransaction) out_ += "NO TRANSACTION\n";
+        break;
+    case Opcode::Release:
+        if (arity(0) && db_.release() == TxnStatus::NoTransaction) out_ += "NO TRANSACTION\n";
+        break;
+    case Opcode::Incr:
+    case Opcode::Decr:
+    case Opcode::IncrBy: {
+        if (!arity(op == Opcode::IncrBy ? 2 : 1)) break;
+        int64_t delta = op == Opcode::Decr ? -1 : 1;
+        optional<int64_t> n;
+        if (op != Opcode::IncrBy || parseInt64(tokens_[2], delta)) n = db_.incr(tokens_[1], delta);
+        if (!n) { error("value is not an integer or out of range"); break; }
+        char buf[24];
+        out_.append(buf, to_chars(buf, buf + sizeof buf, *n).ptr);
+        out_ += '\n';
+        break;
+    }
+    case Opcode::MSet:
+        if (args == 0 || args % 2) { error("wrong number of arguments"); break; }
+        pairs_.clear();
+        for (size_t i = 1; i < tokens_.size(); i += 2) pairs_.emplace_back(tokens_[i], tokens_[i + 1]);
+        db_.mset(pairs_);
+        break;
+    case Opcode::MGet: {
+        if (args == 0) { error("wrong number of arguments"); break; }
+        auto keys = span<const string_view>(tokens_).subspan(1);
+        views_.resize(keys.size());
+        db_.mgetView(keys, views_);
+        for (size_t i = 0; i < views_.size(); ++i) {
+            if (i) out_ += ' ';
+            if (views_[i]) out_ += *views_[i];
+            else           out_ += "NULL";
+        }
+        out_ += '\n';
+        break;
+    }
+    case Opcode::MDel:
+        if (args == 0) { error("wrong number of arguments"); break; }
+        db_.mdel(span<const string_view>(tokens_).subspan(1));
+        break;
+    case Opcode::Unknown:
+        error("unknown command");
+        break;
+    }
+    maybeFlush();
+}
+
+/* ─────────────────── input ─────────────────── */
+size_t CommandProcessor::execute(string_view text) {
+    const size_t before = commands_;
+    while (!text.empty()) {
+        size_t nl = text.find('\n');
+        if (nl == string_view::npos) nl = text.size();
+        executeLine(text.substr(0, nl));
+        text.remove_prefix(nl < text.size() ? nl + 1 : nl);
+    }
+    return commands_ - before;
+}
+
+size_t CommandProcessor::runFd(int inFd) {
+    constexpr size_t kChunk = 1u << 20;
+    size_t cap  = kChunk;
+    auto   buf  = make_unique<char[]>(cap);
+    size_t have = 0;                                // bytes of the unfinished line
+    const size_t before = commands_;
+
+    for (;;) {
+        if (have == cap) {                          // one line longer than the buffer
+            auto bigger = make_unique<char[]>(cap * 2);
+            memcpy(bigger.get(), buf.get(), have);
+            buf = std::move(bigger);
+            cap *= 2;
+        }
+        long long n = readSome(inFd, buf.get() + have, cap - have);
+        if (n < 0) throw runtime_error("command input read failed");
+        if (n == 0) break;
+
+        const size_t old = have;                    // the tail holds no '\n'
+        have += static_cast<size_t>(n);
+        size_t done = 0;                            // through the last '\n'
+        for (size_t i = have; i > old; --i)
+            if (buf[i - 1] == '\n') { done = i; break; }
+        if (!done) continue;
+
+        execute(string_view(buf.get(), done));
+        memmove(buf.get(), buf.get() + done, have - done);
+        have -= done;
+    }
+    if (have) executeLine(string_view(buf.get(), have));
+    flush();
+    return commands_ - before;
+}
+
+size_t CommandProcessor::runFile(const string& path) {
+    MappedFile file(path, MappedFile::Access::Sequential);
+    size_t n = execute(file.view());
+    flush();
+    return n;
+}
@@ -0,0 +1,434 @@
+#include "DbServer.h"
+#include "CommandProcessor.h"
+
+#include <stdexcept>
+
+#ifdef __linux__
+#  include <cerrno>
+#  include <charconv>
+#  include <cstring>
+#  include <arpa/inet.h>
+#  include <netinet/in.h>
+#  include <netinet/tcp.h>
+#  include <sys/epoll.h>
+#  include <sys/eventfd.h>
+#  include <sys/socket.h>
+#  include <sys/un.h>
+#  include <unistd.h>
+#endif
+
+using namespace std;
+
+#ifndef __linux__
+
+struct DbServer::Conn {};
+
+DbServer::DbServer(InMemoryDB& db, ServerOptions opts) : db_(db), opts_(std::move(opts)) {
+    throw runtime_error("DbServer requires Linux (epoll)");
+}
+DbServer::~DbServer() = default;
+void DbServer::run() {}
+void DbServer::stop() {}
+
+#else
+
+struct DbServer::Conn {
+    int         fd;
+    string      in;                 // unparsed bytes start at rpos
+    size_t      rpos     = 0;
+    string      out;                // unsent bytes start at wpos
+    size_t      wpos     = 0;
+    int         depth    = 0;       // open BEGINs
+    uint32_t    events   = 0;       // current epoll interest
+    bool        parked   = false;
+    bool        peerDone = false;   // EOF / read error
+    bool        closing  = false;   // protocol error: close once drained
+};
+
+/* ─────────────────── framing ─────────────────── */
+namespace {
+
+constexpr size_t kReadChunk    = 64 * 1024;
+constexpr size_t kMaxInline    = 64 * 1024;
+constexpr size_t kMaxArgs      = 1 << 20;
+constexpr size_t kMaxBulk      = 512u << 20;
+constexpr int    kExpireTickMs = 10;           // epoll timeout while keys have TTLs
+
+enum class Frame { Complete, Incomplete, Malformed };
+
+[[noreturn]] void fail(const char* what) {
+    throw runtime_error(string("DbServer: ") + what + ": " + strerror(errno));
+}
+
+/* "<digits>\r\n" at p; advances p past it */
+Frame readInt(const char*& p, const char* end, size_t limit, size_t& v) {
+    const char* cr = static_cast<const char*>(memchr(p, '\r', static_cast<size_t>(end - p)));
+    if (!cr || cr + 1 == end) return Frame::Incomplete;
+    auto r = from_chars(p, cr, v);
+    if (r.ptr != cr || r.ec != errc() || cr[1] != '\n' || v > limit) return Frame::Malformed;
+    p = cr + 2;
+    return Frame::Complete;
+}
+
+/* one request from buf; args point into buf */
+Frame parseFrame(string_view buf, size_t& used, vector<string_view>& args) {
+    args.clear();
+    const char* p   = buf.data();
+    const char* end = p + buf.size();
+    if (p == end) return Frame::Incomplete;
+
+    if (*p != '*') {                                    // inline command
+        const char* nl = static_cast<const char*>(memchr(p, '\n', buf.size()));
+        if (!nl) return buf.size() > kMaxInline ? Frame::Malformed : Frame::Incomplete;
+        used = static_cast<size_t>(nl - p) + 1;
+        const char* e = nl > p && nl[-1] == '\r' ? nl - 1 : nl;
+        while (p < e) {
+            while (p < e && (*p == ' ' || *p == '\t')) ++p;
+            const char* b = p;
+            while (p < e && *p != ' ' && *p != '\t') ++p;
+            if (p > b) args.emplace_back(b, static_cast<size_t>(p - b));
+        }
+        return Frame::Complete;
+    }
+
+    ++p;
+    size_t n;
+    if (Frame f = readInt(p, end, kMaxArgs, n); f != Frame::Complete) return f;
+    for (size_t i = 0; i < n; ++i) {
+        if (p == end) return Frame::Incomplete;
+        if (*p++ != '$') return Frame::Malformed;
+        size_t len;
+        if (Frame f = readInt(p, end, kMaxBulk, len); f != Frame::Complete) return f;
+        if (static_cast<size_t>(end - p) < len + 2) return Frame::Incomplete;
+        if (p[len] != '\r' || p[len + 1] != '\n') return Frame::Malformed;
+        args.emplace_back(p, len);
+        p += len + 2;
+    }
+    used = static_cast<size_t>(p - buf.data());
+    return Frame::Complete;
+}
+
+template <class Int>
+void appendInt(string& out, char tag, Int v) {
+    char buf[24];
+    auto r = to_chars(buf, buf + sizeof buf, v);
+    out += tag;
+    out.append(buf, r.ptr);
+    out += "\r\n";
+}
+
+bool parseInt64(string_view s, int64_t& v) {
+    auto r = from_chars(s.data(), s.data() + s.size(), v);
+    return r.ec == errc() && r.ptr == s.data() + s.size();
+}
+
+void appendBulk(string& out, optional<string_view> v) {
+    if (!v) { out += "$-1\r\n"; return; }
+    appendInt(out, '$', v->size());
+    out += *v;
+    out += "\r\n";
+}
+
+} // namespace
+
+/* ─────────────────── setup ─────────────────── */
+DbServer::DbServer(InMemoryDB& db, ServerOptions opts)
+    : db_(db), opts_(std::move(opts)), scratch_(make_unique<char[]>(kReadChunk)) {
+    if (opts_.unixPath.empty()) {
+        listenFd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listenFd_ < 0) fail("socket");
+        int one = 1;
+        ::setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port   = htons(opts_.port);
+        if (::inet_pton(AF_INET, opts_.host.c_str(), &addr.sin_addr) != 1)
+            throw runtime_error("DbServer: bad IPv4 address " + opts_.host);
+        if (::bind(listenFd_, reinterpret_cast<sockaddr*>(&addr), sizeof addr) < 0) fail("bind");
+        socklen_t len = sizeof addr;
+        ::getsockname(listenFd_, reinterpret_cast<sockaddr*>(&addr), &len);
+        port_ = ntohs(addr.sin_port);
+    } else {
+        sockaddr_un addr{};
+        if (opts_.unixPath.size() >= sizeof addr.sun_path)
+            throw runtime_error("DbServer: unix socket path too long");
+        listenFd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listenFd_ < 0) fail("socket");
+        addr.sun_family = AF_UNIX;
+        memcpy(addr.sun_path, opts_.unixPath.c_str(), opts_.unixPath.size() + 1);
+        ::unlink(opts_.unixPath.c_str());
+        if (::bind(listenFd_, reinterpret_cast<sockaddr*>(&addr), sizeof addr) < 0) fail("bind");
+    }
+    if (::listen(listenFd_, opts_.backlog) < 0) fail("listen");
+
+    epollFd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    wakeFd_  = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollFd_ < 0 || wakeFd_ < 0) fail("epoll/eventfd");
+    for (int fd : { listenFd_, wakeFd_ }) {
+        epoll_event ev{};
+        ev.events  = EPOLLIN;
+        ev.data.fd = fd;
+        ::epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev);
+    }
+}
+
+DbServer::~DbServer() {
+    for (auto& c : conns_)
+        if (c) close(*c);
+    if (listenFd_ >= 0) ::close(listenFd_);
+    if (epollFd_ >= 0)  ::close(epollFd_);
+    if (wakeFd_ >= 0)   ::close(wakeFd_);
+    if (!opts_.unixPath.empty()) ::unlink(opts_.unixPath.c_str());
+}
+
+void DbServer::stop() {
+    uint64_t one = 1;
+    [[maybe_unused]] auto r = ::write(wakeFd_, &one, sizeof one);
+}
+
+/* ─────────────────── event loop ─────────────────── */
+void DbServer::run() {
+    epoll_event evs[256];
+    for (;;) {
+        // expiring keys need the wheel turned even when no client talks
+        int n = ::epoll_wait(epollFd_, evs, 256, db_.expiringKeys() ? kExpireTickMs : -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            fail("epoll_wait");
+        }
+        for (int i = 0; i < n; ++i) {
+            const int fd = evs[i].data.fd;
+            if (fd == wakeFd_) {
+                uint64_t v;
+                [[maybe_unused]] auto r = ::read(wakeFd_, &v, sizeof v);
+                return;
+            }
+            if (fd == listenFd_) { accept(); continue; }
+
+            Conn* c = static_cast<size_t>(fd) < conns_.size() ? conns_[fd].get() : nullptr;
+            if (!c) continue;                               // closed earlier in this batch
+            if (evs[i].events & (EPOLLERR | EPOLLHUP)) { close(*c); continue; }
+            if (evs[i].events & EPOLLOUT) flush(*c);
+            if (evs[i].events & EPOLLIN)  onReadable(*c);
+            settle(*c);
+        }
+        if (!owner_) resumeParked();
+        if (db_.expiringKeys()) db_.expire();
+    }
+}
+
+void DbServer::accept() {
+    for (;;) {
+        int fd = ::accept4(listenFd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;                                 // EAGAIN, or EMFILE: retry later
+        if (opts_.unixPath.empty()) {
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+        }
+        if (static_cast<size_t>(fd) >= conns_.size()) conns_.resize(static_cast<size_t>(fd) + 1);
+        conns_[fd] = make_unique<Conn>();
+        conns_[fd]->fd     = fd;
+        conns_[fd]->events = EPOLLIN;
+        epoll_event ev{};
+        ev.events  = EPOLLIN;
+        ev.data.fd = fd;
+        ::epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev);
+        ++open_;
+    }
+}
+
+void DbServer::watch(Conn& c) {
+    uint32_t want = (c.parked || c.peerDone ? 0u : uint32_t(EPOLLIN))
+                  | (c.wpos < c.out.size() ? uint32_t(EPOLLOUT) : 0u);
+    if (want == c.events) return;
+    epoll_event ev{};
+    ev.events  = want;                                      // 0 still reports ERR / HUP
+    ev.data.fd = c.fd;
+    ::epoll_ctl(epollFd_, EPOLL_CTL_MOD, c.fd, &ev);
+    c.events = want;
+}
+
+void DbServer::onReadable(Conn& c) {
+    for (;;) {
+        ssize_t n = ::read(c.fd, scratch_.get(), kReadChunk);
+        if (n > 0) {
+            c.in.append(scratch_.get(), static_cast<size_t>(n));
+            if (static_cast<size_t>(n) < kReadChunk) break;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) c.peerDone = true;
+        break;
+    }
+    process(c);
+}
+
+/* ─────────────────── requests ─────────────────── */
+void DbServer::process(Conn& c) {
+    while (!c.closing) {
+        if (owner_ && owner_ != &c) {                       // someone else is in a txn
+            if (c.rpos < c.in.size() && !c.parked) {
+                c.parked = true;
+                parked_.push_back(c.fd);
+            }
+            break;
+        }
+        size_t used = 0;
+        Frame f = parseFrame(string_view(c.in).substr(c.rpos), used, args_);
+        if (f == Frame::Incomplete) break;
+        if (f == Frame::Malformed) {
+            c.out += "-ERR protocol error\r\n";
+            c.closing = true;
+            break;
+        }
+        if (!args_.empty()) {
+            execute(c);
+            commands_.fetch_add(1, memory_order_relaxed);
+        }
+        c.rpos += used;
+        if (c.out.size() - c.wpos >= (1u << 20)) flush(c); // bound memory for deep pipelines
+    }
+    if (c.rpos == c.in.size()) {
+        c.in.clear();
+        c.rpos = 0;
+    } else if (c.rpos > c.in.size() / 2) {
+        c.in.erase(0, c.rpos);
+        c.rpos = 0;
+    }
+    flush(c);
+}
+
+void DbServer::execute(Conn& c) {
+    const size_t args = args_.size() - 1;
+    auto arity = [&](bool ok) {
+        if (!ok) c.out += "-ERR wrong number of arguments\r\n";
+        return ok;
+    };
+
+    const Opcode op = opcodeOf(args_[0]);
+    switch (op) {
+    case Opcode::Set:
+        if (arity(args == 2)) { db_.set(args_[1], args_[2]); c.out += "+OK\r\n"; }
+        break;
+    case Opcode::Get:
+        if (arity(args == 1)) appendBulk(c.out, db_.getView(args_[1]));
+        break;
+    case Opcode::Delete:
+        if (arity(args == 1)) { db_.del(args_[1]); c.out += "+OK\r\n"; }
+        break;
+    case Opcode::Count:
+        if (arity(args == 1)) appendInt(c.out, ':', db_.count(args_[1]));
+        break;
+    case Opcode::Begin:
+        if (!arity(args == 0)) break;
+        db_.begin();
+        ++c.depth;
+        owner_ = &c;
+        c.out += "+OK\r\n";
+        break;
+    case Opcode::Rollback:
+        if (!arity(args == 0)) break;
+        if (c.depth == 0) { c.out += "-NO TRANSACTION\r\n"; break; }
+        db_.rollback();
+        if (--c.depth == 0) owner_ = nullptr;
+        c.out += "+OK\r\n";
+        break;
+    case Opcode::Release:                                   // like ROLLBACK, keeping the writes
+        if (!arity(args == 0)) break;
+        if (c.depth == 0) { c.out += "-NO TRANSACTION\r\n"; break; }
+        db_.release();
+        if (--c.depth == 0) owner_ = nullptr;
+        c.out += "+OK\r\n";
+        break;
+    case Opcode::Commit:                                    // commits every open level
+        if (!arity(args == 0)) break;
+        if (c.depth == 0) { c.out += "-NO TRANSACTION\r\n"; break; }
+        db_.commit();
+        c.depth = 0;
+        owner_  = nullptr;
+        c.out += "+OK\r\n";
+        break;
+    case Opcode::Incr:
+    case Opcode::Decr:
+    case Opcode::IncrBy: {
+        if (!arity(args == (op == Opcode::IncrBy ? 2u : 1u))) break;
+        int64_t delta = op == Opcode::Decr ? -1 : 1;
+        optional<int64_t> n;
+        if (op != Opcode::IncrBy || parseInt64(args_[2], delta)) n = db_.incr(args_[1], delta);
+        if (n) appendInt(c.out, ':', *n);
+        else   c.out += "-ERR value is not an integer or out of range\r\n";
+        break;
+    }
+    case Opcode::MSet:
+        if (!arity(args > 0 && args % 2 == 0)) break;
+        pairs_.clear();
+        for (size_t i = 1; i < args_.size(); i += 2) pairs_.emplace_back(args_[i], args_[i + 1]);
+        db_.mset(pairs_);
+        c.out += "+OK\r\n";
+        break;
+    case Opcode::MGet: {
+        if (!arity(args > 0)) break;
+        auto keys = span<const string_view>(args_).subspan(1);
+        views_.resize(keys.size());
+        db_.mgetView(keys, views_);
+        appendInt(c.out, '*', views_.size());
+        for (auto& v : views_) appendBulk(c.out, v);
+        break;
+    }
+    case Opcode::MDel:
+        if (arity(args > 0)) appendInt(c.out, ':', db_.mdel(span<const string_view>(args_).subspan(1)));
+        break;
+    case Opcode::Unknown:
+        c.out += "-ERR unknown command\r\n";
+        break;
+    }
+}
+
+/* ─────────────────── output / lifetime ─────────────────── */
+void DbServer::flush(Conn& c) {
+    while (c.wpos < c.out.size()) {
+        ssize_t n = ::send(c.fd, c.out.data() + c.wpos, c.out.size() - c.wpos, MSG_NOSIGNAL);
+        if (n > 0) { c.wpos += static_cast<size_t>(n); continue; }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        c.peerDone = c.closing = true;                      // peer gone: drop the replies
+        c.out.clear();
+        c.wpos = 0;
+        break;
+    }
+    if (c.wpos == c.out.size()) {
+        c.out.clear();
+        c.wpos = 0;
+    }
+    watch(c);
+}
+
+void DbServer::settle(Conn& c) {
+    const bool drained = c.wpos == c.out.size();
+    if (drained && (c.closing || (c.peerDone && !c.parked))) close(c);   // rest is a torn frame
+}
+
+void DbServer::close(Conn& c) {
+    if (&c == owner_) {                                     // abandoned transaction
+        while (c.depth-- > 0) db_.rollback();
+        owner_ = nullptr;
+    }
+    ::epoll_ctl(epollFd_, EPOLL_CTL_DEL, c.fd, nullptr);
+    ::close(c.fd);
+    --open_;
+    conns_[c.fd].reset();                                   // c is gone after this
+}
+
+void DbServer::resumeParked() {
+    while (!owner_ && !parked_.empty()) {
+        int fd = parked_.front();
+        parked_.pop_front();
+        Conn* c = static_cast<size_t>(fd) < conns_.size() ? conns_[fd].get() : nullptr;
+        if (!c || !c->parked) continue;                     // closed (fd may be reused)
+        c->parked = false;
+        process(*c);                                        // may park again or own
+        settle(*c);
+    }
+}
+
+#endif
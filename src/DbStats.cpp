@@ -0,0 +1,70 @@
+#include "DbStats.h"
+
+#include <cmath>
+#include <sstream>
+
+using namespace std;
+
+void LatencyHistogram::merge(const LatencyHistogram& o) {
+    for (size_t b = 0; b < kBuckets; ++b)
+        if (uint64_t n = load(o.counts_[b])) bump(counts_[b], n);
+    bump(count_, o.count());
+    bump(sum_, load(o.sum_));
+    if (o.max() > max()) atomic_ref<uint64_t>(max_).store(o.max(), memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::percentile(double p) const {
+    const uint64_t n = count();
+    if (n == 0) return 0;
+    /* rank of the quantile, 1-based: the first bucket whose running total
+       reaches it holds the value */
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(ceil(clamp(p, 0.0, 1.0) * double(n))));
+    uint64_t seen = 0;
+    for (size_t b = 0; b < kBuckets; ++b) {
+        seen += load(counts_[b]);
+        if (seen >= rank) return std::min(bucketTop(b), max());
+    }
+    return max();                               // counters raced with a recorder
+}
+
+void DbStats::merge(const DbStats& o) {
+    for (size_t i = 0; i < kDbOps; ++i) {
+        ops[i].calls += o.ops[i].calls;
+        ops[i].latency.merge(o.ops[i].latency);
+    }
+    keys        += o.keys;
+    slots       += o.slots;
+    txnDepth    += o.txnDepth;
+    undoBytes   += o.undoBytes;
+    memoryBytes += o.memoryBytes;
+}
+
+string DbStats::text() const {
+    ostringstream out;
+    for (size_t i = 0; i < kDbOps; ++i) {
+        const LatencyHistogram& h = ops[i].latency;
+        out << kDbOpNames[i] << string(9 - kDbOpNames[i].size(), ' ')
+            << "calls=" << ops[i].calls << " sampled=" << h.count()
+            << " mean=" << static_cast<uint64_t>(h.mean()) << "ns"
+            << " p50=" << h.percentile(0.50) << "ns"
+            << " p99=" << h.percentile(0.99) << "ns"
+            << " p999=" << h.percentile(0.999) << "ns"
+            << " max=" << h.max() << "ns\n";
+    }
+    out << "keys=" << keys << '\n'
+        << "slots=" << slots << '\n'
+        << "txn_depth=" << txnDepth << '\n'
+        << "undo_bytes=" << undoBytes << '\n'
+        << "memory_bytes=" << memoryBytes << '\n';
+    return out.str();
+}
+
+#if INMEMORYDB_STATS
+void OpRecorder::copyTo(DbStats& st) const {
+    for (size_t i = 0; i < kDbOps; ++i) {
+        st.ops[i].calls = atomic_ref<uint64_t>(ops_[i].calls).load(memory_order_relaxed);
+        st.ops[i].latency = LatencyHistogram();
+        st.ops[i].latency.merge(ops_[i].latency);
+    }
+}
+#endif
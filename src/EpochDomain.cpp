@@ -0,0 +1,115 @@
+#include "EpochDomain.h"
+
+#include <algorithm>
+#include <mutex>
+#include <utility>
+
+using namespace std;
+
+/* Domains alive right now, by id.  A thread's record cache outlives the
+   domains it used; at thread exit only records of live domains are handed
+   back, under this lock so a domain cannot be destroyed meanwhile. */
+namespace {
+
+mutex               g_domainsMu;
+vector<uint64_t>    g_liveDomains;
+atomic<uint64_t>    g_nextId{1};
+
+struct ThreadRecords {
+    vector<pair<uint64_t, EpochDomain::Reader*>> list;   // (domain id, record)
+    ~ThreadRecords() {
+        lock_guard lock(g_domainsMu);
+        for (auto& [id, r] : list)
+            if (find(g_liveDomains.begin(), g_liveDomains.end(), id) != g_liveDomains.end())
+                r->inUse.store(false, memory_order_release);
+    }
+};
+
+thread_local ThreadRecords t_records;
+
+}   // namespace
+
+EpochDomain::EpochDomain() : id_(g_nextId.fetch_add(1, memory_order_relaxed)) {
+    lock_guard lock(g_domainsMu);
+    g_liveDomains.push_back(id_);
+}
+
+EpochDomain::~EpochDomain() {
+    {
+        lock_guard lock(g_domainsMu);
+        g_liveDomains.erase(find(g_liveDomains.begin(), g_liveDomains.end(), id_));
+    }
+    for (Reader* r = head_.load(memory_order_acquire); r;) {
+        Reader* next = r->next;
+        delete r;
+        r = next;
+    }
+}
+
+EpochDomain::Reader& EpochDomain::reader() {
+    for (auto& [id, r] : t_records.list)
+        if (id == id_) return *r;
+    Reader* r = acquire();
+    {
+        lock_guard lock(g_domainsMu);           // drop entries of dead domains
+        erase_if(t_records.list, [](const auto& e) {
+            return find(g_liveDomains.begin(), g_liveDomains.end(), e.first) == g_liveDomains.end();
+        });
+    }
+    t_records.list.emplace_back(id_, r);
+    return *r;
+}
+
+/* reuse a record handed back by an exited thread, else link a new one */
+EpochDomain::Reader* EpochDomain::acquire() {
+    for (Reader* r = head_.load(memory_order_acquire); r; r = r->next) {
+        bool free = false;
+        if (!r->inUse.load(memory_order_relaxed)
+            && r->inUse.compare_exchange_strong(free, true, memory_order_acq_rel))
+            return r;
+    }
+    Reader* r = new Reader;
+    r->inUse.store(true, memory_order_relaxed);
+    r->next = head_.load(memory_order_relaxed);
+    while (!head_.compare_exchange_weak(r->next, r, memory_order_release, memory_order_relaxed)) {}
+    return r;
+}
+
+bool EpochDomain::tryAdvance() {
+    uint64_t e = global_.load(memory_order_seq_cst);
+    atomic_thread_fence(memory_order_seq_cst);
+    for (Reader* r = head_.load(memory_order_acquire); r; r = r->next) {
+        const uint64_t pinned = r->epoch.load(memory_order_acquire);
+        if (pinned != 0 && pinned != e) return false;   // still in an older epoch
+    }
+    return global_.compare_exchange_strong(e, e + 1, memory_order_seq_cst);
+}
+
+uint64_t EpochDomain::sum(size_t i) const {
+    uint64_t n = 0;
+    for (Reader* r = head_.load(memory_order_acquire); r; r = r->next)
+        n += r->counters[i].load(memory_order_relaxed);
+    return n;
+}
+
+RetireList::~RetireList() {
+    for (auto& it : items_) it.del(it.p);
+}
+
+void RetireList::retire(EpochDomain& d, void* p, Deleter del) {
+    atomic_thread_fence(memory_order_seq_cst);  // the unlink is ordered before the tag
+    items_.push_back({ d.global_.load(memory_order_seq_cst), p, del });
+    if (++sinceCollect_ >= kCollectEvery) collect(d);
+}
+
+void RetireList::collect(EpochDomain& d) {
+    sinceCollect_ = 0;
+    if (items_.empty()) return;
+    d.tryAdvance();
+    const uint64_t now = d.epoch();
+    if (now < 2) return;
+    auto safe = find_if(items_.begin(), items_.end(),
+                        [&](const Item& it) { return it.epoch > now - 2; });
+    for (auto it = items_.begin(); it != safe; ++it) it->del(it->p);
+    items_.erase(items_.begin(), safe);
+}
@@ -0,0 +1,64 @@
+#include "MappedFile.h"
+
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+#ifndef _WIN32
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+using namespace std;
+
+MappedFile::MappedFile(const string& path, Access access) {
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) throw runtime_error("cannot open " + path);
+    struct stat st{};
+    if (::fstat(fd, &st) == 0 && st.st_size > 0) {     // mmap rejects length 0
+        size_ = static_cast<size_t>(st.st_size);
+        void* p = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        if (p != MAP_FAILED) {
+            ::madvise(p, size_, access == Access::Random ? MADV_RANDOM : MADV_SEQUENTIAL);
+            data_   = static_cast<const char*>(p);
+            mapped_ = true;
+        }
+    }
+    ::close(fd);
+#else
+    (void)access;
+#endif
+    if (mapped_) return;
+
+    ifstream in(path, ios::binary | ios::ate);     // no mmap: read it all
+    if (!in) throw runtime_error("cannot open " + path);
+    size_  = static_cast<size_t>(in.tellg());
+    owned_ = make_unique<uint64_t[]>(size_ / 8 + 1);
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(owned_.get()), static_cast<streamsize>(size_));
+    data_ = reinterpret_cast<const char*>(owned_.get());
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+    if (mapped_) ::munmap(const_cast<char*>(data_), size_);
+#endif
+}
+
+MappedFile::MappedFile(MappedFile&& o) noexcept
+    : data_(std::exchange(o.data_, nullptr)), size_(std::exchange(o.size_, 0)),
+      mapped_(std::exchange(o.mapped_, false)), owned_(std::move(o.owned_)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& o) noexcept {
+    if (this != &o) {
+        MappedFile tmp(std::move(o));
+        std::swap(data_, tmp.data_);
+        std::swap(size_, tmp.size_);
+        std::swap(mapped_, tmp.mapped_);
+        std::swap(owned_, tmp.owned_);
+    }
+    return *this;
+}
@@ -0,0 +1,274 @@
+#include "MvccInMemoryDB.h"
+
+using namespace std;
+
+/* a version that reads the same as no version at all */
+static bool isTombstone(const optional<string>& v) { return !v; }
+static bool isTombstone(size_t count)               { return count == 0; }
+
+/* ─────────────────── version chains ─────────────────── */
+template <class T>
+MvccInMemoryDB::Chain<T>::~Chain() {
+    Version<T>* v = head.load(memory_order_relaxed);
+    while (v) {
+        Version<T>* n = v->next.load(memory_order_relaxed);
+        delete v;
+        v = n;
+    }
+}
+
+template <class T>
+auto MvccInMemoryDB::VersionedMap<T>::shardFor(string_view key) const -> Shard& {
+    uint64_t h = flat_detail::mix(StringHash{}(key));
+    return shards_[static_cast<size_t>(h >> 58)];          // top 6 bits → 64 shards
+}
+
+template <class T>
+auto MvccInMemoryDB::VersionedMap<T>::find(string_view key) const -> Chain<T>* {
+    Shard& s = shardFor(key);
+    shared_lock lock(s.mu);                                 // held for one probe only
+    auto it = s.chains.find(key);
+    return it == s.chains.end() ? nullptr : it->second.get();
+}
+
+/* newest version with ts ≤ snapshot; the caller holds an EpochDomain::Guard,
+   since collectGarbage() may retire the chain once find() has returned */
+template <class T>
+const T* MvccInMemoryDB::VersionedMap<T>::read(string_view key, Timestamp ts) const {
+    Chain<T>* c = find(key);
+    if (!c) return nullptr;
+    for (auto* v = c->head.load(memory_order_acquire); v; v = v->next.load(memory_order_acquire))
+        if (v->ts <= ts) return &v->val;
+    return nullptr;
+}
+
+template <class T>
+const T* MvccInMemoryDB::VersionedMap<T>::latest(string_view key) const {
+    Chain<T>* c = find(key);
+    Version<T>* v = c ? c->head.load(memory_order_relaxed) : nullptr;
+    return v ? &v->val : nullptr;
+}
+
+template <class T>
+auto MvccInMemoryDB::VersionedMap<T>::install(string_view key, Timestamp ts, T val) -> Chain<T>* {
+    Chain<T>* c = find(key);
+    if (!c) {                                               // first version of this key
+        Shard& s = shardFor(key);
+        unique_lock lock(s.mu);
+        auto& slot = s.chains.try_emplace(key).first->second;
+        slot = make_unique<Chain<T>>();
+        c = slot.get();
+    }
+    auto* v = new Version<T>{ ts, std::move(val) };
+    v->next.store(c->head.load(memory_order_relaxed), memory_order_relaxed);
+    c->head.store(v, memory_order_release);                 // publish
+    return c;
+}
+
+/* keep versions newer than horizon + the first one at/below it */
+template <class T>
+size_t MvccInMemoryDB::VersionedMap<T>::trim(Chain<T>& c, Timestamp horizon) {
+    Version<T>* v = c.head.load(memory_order_relaxed);
+    while (v && v->ts > horizon) v = v->next.load(memory_order_relaxed);
+    if (!v) return 0;
+    Version<T>* dead = v->next.load(memory_order_relaxed);
+    v->next.store(nullptr, memory_order_release);
+    size_t freed = 0;
+    while (dead) {
+        Version<T>* n = dead->next.load(memory_order_relaxed);
+        delete dead;
+        dead = n;
+        ++freed;
+    }
+    return freed;
+}
+
+/* trim every chain, then unlink the ones left holding a single tombstone
+   at/below the horizon.  Only the writer changes the directory, so the
+   iterators collected under the shared lock are still valid under the
+   unique one. */
+template <class T>
+size_t MvccInMemoryDB::VersionedMap<T>::trimAll(Timestamp horizon, EpochDomain& d,
+                                                RetireList& retired) {
+    size_t freed = 0;
+    vector<typename FlatStringMap<unique_ptr<Chain<T>>>::iterator> dead;
+    for (size_t i = 0; i < kShards; ++i) {
+        Shard& s = shards_[i];
+        dead.clear();
+        {
+            shared_lock lock(s.mu);
+            for (auto it = s.chains.begin(); it != s.chains.end(); ++it) {
+                freed += trim(*it->second, horizon);
+                const Version<T>* v = it->second->head.load(memory_order_relaxed);
+                if (v && v->ts <= horizon && isTombstone(v->val)) dead.push_back(it);
+            }
+        }
+        if (dead.empty()) continue;
+        unique_lock lock(s.mu);
+        for (auto it : dead) {
+            retired.retire(d, it->second.release(),
+                           [](void* p) { delete static_cast<Chain<T>*>(p); });
+            s.chains.erase(it);
+        }
+        freed += dead.size();
+    }
+    return freed;
+}
+
+template <class T>
+size_t MvccInMemoryDB::VersionedMap<T>::versionCount() const {
+    size_t n = 0;
+    for (size_t i = 0; i < kShards; ++i) {
+        shared_lock lock(shards_[i].mu);
+        for (auto& kv : shards_[i].chains)
+            for (auto* v = kv.second->head.load(memory_order_relaxed); v;
+                 v = v->next.load(memory_order_relaxed))
+                ++n;
+    }
+    return n;
+}
+
+template <class T>
+size_t MvccInMemoryDB::VersionedMap<T>::chainCount() const {
+    size_t n = 0;
+    for (size_t i = 0; i < kShards; ++i) {
+        shared_lock lock(shards_[i].mu);
+        n += shards_[i].chains.size();
+    }
+    return n;
+}
+
+/* ─────────────────── commit → versions ─────────────────── */
+MvccInMemoryDB::MvccInMemoryDB(TxnMode mode) : head_(mode) {
+    head_.setCommitObserver(this);
+}
+
+MvccInMemoryDB::~MvccInMemoryDB() { head_.setCommitObserver(nullptr); }
+
+void MvccInMemoryDB::onCommit(span<const CommittedChange> changes) {
+    const Timestamp ts = commitTs_.load(memory_order_relaxed) + 1;
+
+    FlatStringMap<ptrdiff_t>                      delta;       // value → ΔCOUNT
+    vector<Chain<optional<string>>*>              touchedKeys;
+    for (const auto& c : changes) {
+        const auto* prev = keys_.latest(c.key);
+        optional<string_view> before;
+        if (prev && *prev) before = **prev;
+        if (before == c.val) continue;                          // net no-op
+        if (before) --delta.try_emplace(*before, 0).first->second;
+        if (c.val)  ++delta.try_emplace(*c.val, 0).first->second;
+        touchedKeys.push_back(keys_.install(c.key, ts,
+                                            c.val ? optional<string>(*c.val) : nullopt));
+    }
+    if (touchedKeys.empty()) return;
+
+    vector<Chain<size_t>*> touchedCounts;
+    for (const auto& [val, d] : delta) {
+        if (d == 0) continue;
+        const size_t* cur = counts_.latest(val);
+        ptrdiff_t n = static_cast<ptrdiff_t>(cur ? *cur : 0) + d;
+        touchedCounts.push_back(counts_.install(val, ts, static_cast<size_t>(n)));
+    }
+
+    commitTs_.store(ts, memory_order_release);                 // commit becomes visible
+
+    Timestamp h = horizon();
+    for (auto* c : touchedKeys)   VersionedMap<optional<string>>::trim(*c, h);
+    for (auto* c : touchedCounts) VersionedMap<size_t>::trim(*c, h);
+}
+
+MvccInMemoryDB::Timestamp MvccInMemoryDB::horizon() const {
+    lock_guard lock(registryMu_);
+    return snapshots_.empty() ? commitTs_.load(memory_order_acquire)
+                              : snapshots_.begin()->first;
+}
+
+void MvccInMemoryDB::release(Timestamp ts) const {
+    lock_guard lock(registryMu_);
+    auto it = snapshots_.find(ts);
+    if (--it->second == 0) snapshots_.erase(it);
+}
+
+size_t MvccInMemoryDB::collectGarbage() {
+    lock_guard lock(writerMu_);
+    Timestamp h = horizon();
+    size_t freed = keys_.trimAll(h, epochs_, retired_) + counts_.trimAll(h, epochs_, retired_);
+    retired_.collect(epochs_);
+    return freed;
+}
+
+size_t MvccInMemoryDB::versionCount() const {
+    lock_guard lock(writerMu_);
+    return keys_.versionCount() + counts_.versionCount();
+}
+
+size_t MvccInMemoryDB::chainCount() const {
+    lock_guard lock(writerMu_);
+    return keys_.chainCount() + counts_.chainCount();
+}
+
+/* ─────────────────── read side ─────────────────── */
+MvccInMemoryDB::Snapshot MvccInMemoryDB::snapshot() const {
+    lock_guard lock(registryMu_);
+    Timestamp ts = commitTs_.load(memory_order_acquire);
+    ++snapshots_[ts];
+    return Snapshot(this, ts);
+}
+
+optional<string_view> MvccInMemoryDB::Snapshot::get(string_view key) const {
+    EpochDomain::Guard g(db_->epochs_);
+    const auto* v = db_->keys_.read(key, ts_);
+    return v && *v ? optional<string_view>(**v) : nullopt;
+}
+
+size_t MvccInMemoryDB::Snapshot::count(string_view val) const {
+    EpochDomain::Guard g(db_->epochs_);
+    const size_t* n = db_->counts_.read(val, ts_);
+    return n ? *n : 0;
+}
+
+/* ─────────────────── write side ─────────────────── */
+void MvccInMemoryDB::set(string_view key, string_view val) {
+    lock_guard lock(writerMu_);
+    head_.set(key, val);
+}
+
+optional<string> MvccInMemoryDB::get(string_view key) const {
+    lock_guard lock(writerMu_);
+    return head_.get(key);
+}
+
+void MvccInMemoryDB::del(string_view key) {
+    lock_guard lock(writerMu_);
+    head_.del(key);
+}
+
+size_t MvccInMemoryDB::count(string_view val) const {
+    lock_guard lock(writerMu_);
+    return head_.count(val);
+}
+
+optional<int64_t> MvccInMemoryDB::incr(string_view key, int64_t delta) {
+    lock_guard lock(writerMu_);
+    return head_.incr(key, delta);
+}
+
+void MvccInMemoryDB::begin() {
+    lock_guard lock(writerMu_);
+    head_.begin();
+}
+
+TxnStatus MvccInMemoryDB::rollback() {
+    lock_guard lock(writerMu_);
+    return head_.rollback();
+}
+
+TxnStatus MvccInMemoryDB::commit() {
+    lock_guard lock(writerMu_);
+    return head_.commit();
+}
+
+TxnStatus MvccInMemoryDB::release() {
+    lock_guard lock(writerMu_);
+    return head_.release();
+}
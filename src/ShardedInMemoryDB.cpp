@@ -0,0 +1,347 @@
+#include "ShardedInMemoryDB.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <new>
+
+using namespace std;
+
+namespace {
+
+/* Immutable once published, apart from the two atomics.  Key and value
+   bytes follow the struct in the same allocation. */
+struct Node {
+    uint64_t                 hash;
+    uint32_t                 keyLen, valLen;
+    atomic<uint64_t>         count{0};          // value table: keys holding the value
+    mutable atomic<uint8_t>  ref{0};            // key table: read since the hand passed
+
+    const char* bytes() const { return reinterpret_cast<const char*>(this + 1); }
+    string_view key()   const { return { bytes(), keyLen }; }
+    string_view val()   const { return { bytes() + keyLen, valLen }; }
+    size_t      size()  const { return sizeof(Node) + keyLen + valLen; }
+
+    static Node* make(uint64_t h, string_view k, string_view v) {
+        Node* n = new (::operator new(sizeof(Node) + k.size() + v.size()))
+            Node{ h, static_cast<uint32_t>(k.size()), static_cast<uint32_t>(v.size()) };
+        char* b = reinterpret_cast<char*>(n + 1);
+        if (!k.empty()) memcpy(b, k.data(), k.size());
+        if (!v.empty()) memcpy(b + k.size(), v.data(), v.size());
+        return n;
+    }
+    static void destroy(void* p) {
+        static_cast<Node*>(p)->~Node();
+        ::operator delete(p);
+    }
+};
+
+Node g_tomb{};                                  // erased slot; probes continue past it
+
+/* capacity (a power of two) slots of atomic<Node*> after the header */
+struct Table {
+    size_t mask;
+
+    atomic<Node*>*       slots()       { return reinterpret_cast<atomic<Node*>*>(this + 1); }
+    const atomic<Node*>* slots() const { return reinterpret_cast<const atomic<Node*>*>(this + 1); }
+    size_t bytes() const { return sizeof(Table) + (mask + 1) * sizeof(atomic<Node*>); }
+
+    static Table* make(size_t cap) {
+        Table* t = new (::operator new(sizeof(Table) + cap * sizeof(atomic<Node*>))) Table{ cap - 1 };
+        for (size_t i = 0; i < cap; ++i) new (&t->slots()[i]) atomic<Node*>(nullptr);
+        return t;
+    }
+    static void destroy(void* p) { ::operator delete(p); }   // atomics: trivial
+};
+
+/* Open addressing, linear probing, one writer.  Readers stop at a null
+   slot; the writer keeps (live + tombstones) ≤ 7/8 of the slots and
+   rebuilds – into a table sized for the live nodes – when it would not. */
+class NodeTable {
+    atomic<Table*> table_;
+    size_t         live_ = 0, used_ = 0;        // used_ includes tombstones
+    size_t         nodeBytes_ = 0;
+
+public:
+    static constexpr size_t npos = size_t(-1);
+
+    NodeTable() : table_(Table::make(16)) {}
+    ~NodeTable() {                              // no reader may be left
+        Table* t = table_.load(memory_order_relaxed);
+        for (size_t i = 0; i <= t->mask; ++i) {
+            Node* n = t->slots()[i].load(memory_order_relaxed);
+            if (n && n != &g_tomb) Node::destroy(n);
+        }
+        Table::destroy(t);
+    }
+    NodeTable(const NodeTable&) = delete;
+    NodeTable& operator=(const NodeTable&) = delete;
+
+    /* readers (pinned) and the writer */
+    const Node* find(string_view key, uint64_t h) const {
+        const Table* t = table_.load(memory_order_acquire);
+        for (size_t i = h & t->mask;; i = (i + 1) & t->mask) {
+            const Node* n = t->slots()[i].load(memory_order_acquire);
+            if (!n) return nullptr;
+            if (n != &g_tomb && n->hash == h && n->key() == key) return n;
+        }
+    }
+
+    /* writer only */
+    size_t slotOf(string_view key, uint64_t h) const {
+        const Table* t = table_.load(memory_order_relaxed);
+        for (size_t i = h & t->mask;; i = (i + 1) & t->mask) {
+            const Node* n = t->slots()[i].load(memory_order_relaxed);
+            if (!n) return npos;
+            if (n != &g_tomb && n->hash == h && n->key() == key) return i;
+        }
+    }
+    Node* at(size_t i) const { return table_.load(memory_order_relaxed)->slots()[i].load(memory_order_relaxed); }
+
+    /* publish n in slot i (from slotOf) in place of the node there */
+    void replace(size_t i, Node* n, EpochDomain& d, RetireList& retired) {
+        Node* old = at(i);
+        nodeBytes_ += n->size();
+        nodeBytes_ -= old->size();
+        table_.load(memory_order_relaxed)->slots()[i].store(n, memory_order_release);
+        retired.retire(d, old, Node::destroy);
+    }
+    /* publish n, whose key is absent */
+    void insert(Node* n, EpochDomain& d, RetireList& retired) {
+        Table* t = table_.load(memory_order_relaxed);
+        if ((used_ + 1) * 8 > (t->mask + 1) * 7) t = rebuild(d, retired);
+        size_t i = n->hash & t->mask;
+        Node* cur;
+        while ((cur = t->slots()[i].load(memory_order_relaxed)) && cur != &g_tomb) i = (i + 1) & t->mask;
+        if (!cur) ++used_;
+        ++live_;
+        nodeBytes_ += n->size();
+        t->slots()[i].store(n, memory_order_release);
+    }
+    void erase(size_t i, EpochDomain& d, RetireList& retired) {
+        Node* old = at(i);
+        --live_;
+        nodeBytes_ -= old->size();
+        table_.load(memory_order_relaxed)->slots()[i].store(&g_tomb, memory_order_release);
+        retired.retire(d, old, Node::destroy);
+    }
+
+    size_t bytes() const { return nodeBytes_ + table_.load(memory_order_relaxed)->bytes(); }
+
+private:
+    Table* rebuild(EpochDomain& d, RetireList& retired) {
+        Table* old = table_.load(memory_order_relaxed);
+        Table* t   = Table::make(bit_ceil(max<size_t>(16, 2 * (live_ + 1))));
+        for (size_t i = 0; i <= old->mask; ++i) {
+            Node* n = old->slots()[i].load(memory_order_relaxed);
+            if (!n || n == &g_tomb) continue;
+            size_t j = n->hash & t->mask;
+            while (t->slots()[j].load(memory_order_relaxed)) j = (j + 1) & t->mask;
+            t->slots()[j].store(n, memory_order_relaxed);
+        }
+        table_.store(t, memory_order_release);  // nodes carry over; only the array is retired
+        retired.retire(d, old, Table::destroy);
+        used_ = live_;
+        return t;
+    }
+};
+
+uint64_t hashOf(string_view s) { return flat_detail::mix(StringHash{}(s)); }
+
+/* owner-written tallies in each EpochDomain::Reader */
+enum Counter : size_t { kHits, kMisses, kCounts };
+
+}   // namespace
+
+/* key → value and value → count of one shard, kept by its InMemoryDB's
+   commit notifications; written under the shard lock, read lock-free */
+class ShardedInMemoryDB::ReadIndex final : public CommitObserver {
+public:
+    explicit ReadIndex(EpochDomain& d) : epochs_(d) {}
+
+    void onCommit(span<const CommittedChange> changes) override {
+        for (const auto& c : changes) apply(c.key, c.val);
+    }
+
+    /* pinned readers */
+    const Node* find(string_view key, uint64_t h) const { return keys_.find(key, h); }
+    uint64_t count(string_view val, uint64_t h) const {
+        const Node* n = values_.find(val, h);
+        return n ? n->count.load(memory_order_relaxed) : 0;
+    }
+
+    /* writer: CLOCK asks whether a lock-free GET read the key since */
+    bool takeRef(string_view key) {
+        size_t i = keys_.slotOf(key, hashOf(key));
+        if (i == NodeTable::npos) return false;
+        const Node* n = keys_.at(i);
+        if (!n->ref.load(memory_order_relaxed)) return false;
+        n->ref.store(0, memory_order_relaxed);
+        return true;
+    }
+
+    size_t bytes() const { return sizeof(*this) + keys_.bytes() + values_.bytes(); }
+
+private:
+    EpochDomain& epochs_;
+    NodeTable    keys_, values_;
+    RetireList   retired_;                      // destroyed first: frees replaced nodes
+
+    void apply(string_view key, optional<string_view> val) {
+        const uint64_t h = hashOf(key);
+        const size_t   i = keys_.slotOf(key, h);
+        const Node*  old = i == NodeTable::npos ? nullptr : keys_.at(i);
+        if (old && val && old->val() == *val) return;
+        if (old) add(old->val(), -1);           // old stays valid: retired, not freed
+        if (!val) {
+            if (old) keys_.erase(i, epochs_, retired_);
+            return;
+        }
+        add(*val, +1);
+        Node* n = Node::make(h, key, *val);
+        if (old) {
+            n->ref.store(old->ref.load(memory_order_relaxed), memory_order_relaxed);
+            keys_.replace(i, n, epochs_, retired_);
+        } else {
+            keys_.insert(n, epochs_, retired_);
+        }
+    }
+
+    void add(string_view val, int d) {
+        const uint64_t h = hashOf(val);
+        const size_t   i = values_.slotOf(val, h);
+        if (i == NodeTable::npos) {             // d > 0: the first holder
+            Node* n = Node::make(h, val, {});
+            n->count.store(1, memory_order_relaxed);
+            values_.insert(n, epochs_, retired_);
+            return;
+        }
+        Node* n = values_.at(i);
+        const uint64_t c = n->count.load(memory_order_relaxed) + static_cast<uint64_t>(d);
+        if (c == 0) values_.erase(i, epochs_, retired_);
+        else        n->count.store(c, memory_order_relaxed);
+    }
+};
+
+ShardedInMemoryDB::ShardedInMemoryDB(size_t shards)
+    : shardCount_(bit_ceil(shards ? shards : 1))
+    , shift_(64u - static_cast<unsigned>(countr_zero(shardCount_)))
+{
+    shards_ = make_unique<Shard[]>(shardCount_);
+    for (size_t i = 0; i < shardCount_; ++i) {
+        Shard& s = shards_[i];
+        s.index = make_unique<ReadIndex>(epochs_);
+        s.db.setCommitObserver(s.index.get());
+        s.db.setReferenceHook([idx = s.index.get()](string_view key) { return idx->takeRef(key); });
+    }
+}
+
+ShardedInMemoryDB::~ShardedInMemoryDB() = default;
+
+ShardedInMemoryDB::Shard& ShardedInMemoryDB::shardFor(string_view key) const {
+    return shardOf(hashOf(key));
+}
+
+ShardedInMemoryDB::Shard& ShardedInMemoryDB::shardOf(uint64_t h) const {
+    if (shardCount_ == 1) return shards_[0];            // shift by 64 is UB
+    return shards_[static_cast<size_t>(h >> shift_)];
+}
+
+void ShardedInMemoryDB::fitLimit(Shard& s) {
+    if (!s.limit) return;
+    const size_t idx = s.index->bytes();
+    s.db.setMemoryLimit(s.limit > idx ? s.limit - idx : 1);
+}
+
+void ShardedInMemoryDB::set(string_view key, string_view val) {
+    Shard& s = shardFor(key);
+    lock_guard lock(s.mu);
+    s.db.set(key, val);
+    fitLimit(s);
+}
+
+optional<string> ShardedInMemoryDB::get(string_view key) const {
+    const uint64_t h = hashOf(key);
+    const Shard&   s = shardOf(h);
+    EpochDomain::Guard g(epochs_);
+    const Node* n = s.index->find(key, h);
+    if (!n) {
+        g.reader().bump(kMisses);
+        return nullopt;
+    }
+    if (!n->ref.load(memory_order_relaxed)) n->ref.store(1, memory_order_relaxed);
+    g.reader().bump(kHits);
+    return string(n->val());
+}
+
+void ShardedInMemoryDB::del(string_view key) {
+    Shard& s = shardFor(key);
+    lock_guard lock(s.mu);
+    s.db.del(key);
+    fitLimit(s);
+}
+
+optional<int64_t> ShardedInMemoryDB::incr(string_view key, int64_t delta) {
+    Shard& s = shardFor(key);
+    lock_guard lock(s.mu);
+    auto n = s.db.incr(key, delta);
+    fitLimit(s);
+    return n;
+}
+
+size_t ShardedInMemoryDB::count(string_view val) const {
+    const uint64_t h = hashOf(val);
+    uint64_t total = 0;
+    EpochDomain::Guard g(epochs_);
+    for (size_t i = 0; i < shardCount_; ++i) total += shards_[i].index->count(val, h);
+    g.reader().bump(kCounts);
+    return static_cast<size_t>(total);
+}
+
+void ShardedInMemoryDB::setMemoryLimit(size_t bytes) {
+    const size_t share = bytes ? max<size_t>(1, bytes / shardCount_) : 0;
+    for (size_t i = 0; i < shardCount_; ++i) {
+        Shard& s = shards_[i];
+        lock_guard lock(s.mu);
+        s.limit = share;
+        if (share) fitLimit(s);
+        else       s.db.setMemoryLimit(0);
+    }
+}
+
+size_t ShardedInMemoryDB::memoryUsage() const {
+    size_t total = 0;
+    for (size_t i = 0; i < shardCount_; ++i) {
+        lock_guard lock(shards_[i].mu);
+        total += shards_[i].db.memoryUsage() + shards_[i].index->bytes();
+    }
+    return total;
+}
+
+CacheStats ShardedInMemoryDB::cacheStats() const {
+    CacheStats total;
+    total.hits   = epochs_.sum(kHits);
+    total.misses = epochs_.sum(kMisses);
+    for (size_t i = 0; i < shardCount_; ++i) {
+        lock_guard lock(shards_[i].mu);
+        CacheStats st = shards_[i].db.cacheStats();
+        total.hits      += st.hits;
+        total.misses    += st.misses;
+        total.evictions += st.evictions;
+    }
+    return total;
+}
+
+DbStats ShardedInMemoryDB::stats() const {
+    DbStats total;
+    for (size_t i = 0; i < shardCount_; ++i) {
+        lock_guard lock(shards_[i].mu);
+        total.merge(shards_[i].db.stats());
+    }
+    if constexpr (DbStats::enabled) {           // lock-free reads: counted, not timed
+        total.ops[static_cast<size_t>(DbOp::Get)].calls   += epochs_.sum(kHits) + epochs_.sum(kMisses);
+        total.ops[static_cast<size_t>(DbOp::Count)].calls += epochs_.sum(kCounts);
+    }
+    return total;
+}
@@ -0,0 +1,311 @@
+#include "WriteAheadLog.h"
+#include "MappedFile.h"
+
+#include <array>
+#include <filesystem>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+#ifdef _WIN32
+#  include <fcntl.h>
+#  include <io.h>
+#  include <sys/stat.h>
+#else
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+using namespace std;
+
+/* ─────────────────── platform file ops ─────────────────── */
+namespace {
+
+int openAppend(const string& path) {
+#ifdef _WIN32
+    return _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    return ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+#endif
+}
+
+void writeAll(int fd, const char* p, size_t n) {
+    while (n) {
+#ifdef _WIN32
+        int w = _write(fd, p, static_cast<unsigned>(n > 0x40000000 ? 0x40000000 : n));
+#else
+        ssize_t w = ::write(fd, p, n);
+#endif
+        if (w <= 0) throw runtime_error("WAL write failed");
+        p += w;
+        n -= static_cast<size_t>(w);
+    }
+}
+
+void syncFd(int fd) {
+#ifdef _WIN32
+    const int r = _commit(fd);
+#elif defined(__APPLE__)
+    const int r = ::fsync(fd);
+#else
+    const int r = ::fdatasync(fd);
+#endif
+    if (r != 0) throw runtime_error("WAL fsync failed");
+}
+
+void closeFd(int fd) {
+#ifdef _WIN32
+    _close(fd);
+#else
+    ::close(fd);
+#endif
+}
+
+/* ─────────────────── encoding helpers ─────────────────── */
+const array<uint32_t, 256>& crcTable() {
+    static const array<uint32_t, 256> table = [] {
+        array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    return table;
+}
+
+uint32_t crc32(const char* p, size_t n) {
+    const auto& t = crcTable();
+    uint32_t c = 0xFFFFFFFFu;
+    for (size_t i = 0; i < n; ++i)
+        c = t[(c ^ static_cast<unsigned char>(p[i])) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
+
+void putU32(string& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+}
+
+uint32_t getU32(const char* p) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) v |= uint32_t(static_cast<unsigned char>(p[i])) << (8 * i);
+    return v;
+}
+
+void putVarint(string& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+/* false on truncated / overlong input */
+bool getVarint(const char*& p, const char* end, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        auto b = static_cast<unsigned char>(*p++);
+        v |= uint64_t(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+bool getBytes(const char*& p, const char* end, string_view& out) {
+    uint64_t n;
+    if (!getVarint(p, end, n) || n > static_cast<uint64_t>(end - p)) return false;
+    out = string_view(p, static_cast<size_t>(n));
+    p += n;
+    return true;
+}
+
+void encodeRecord(string& out, span<const CommittedChange> changes) {
+    size_t header = out.size();
+    out.append(8, '\0');                                // len + crc, patched below
+    putVarint(out, changes.size());
+    for (const auto& c : changes) {
+        out.push_back(static_cast<char>(c.val ? 1 : 0));
+        putVarint(out, c.key.size());
+        out.append(c.key);
+        if (c.val) {
+            putVarint(out, c.val->size());
+            out.append(*c.val);
+        }
+    }
+    size_t len = out.size() - header - 8;
+    string hdr;
+    putU32(hdr, static_cast<uint32_t>(len));
+    putU32(hdr, crc32(out.data() + header + 8, len));
+    out.replace(header, 8, hdr);
+}
+
+} // namespace
+
+/* ─────────────────── log ─────────────────── */
+WriteAheadLog::WriteAheadLog(const string& path, WalOptions opts) : opts_(opts) {
+    fd_ = openAppend(path);
+    if (fd_ < 0) throw runtime_error("cannot open WAL " + path);
+    if (opts_.durability == Durability::Async || opts_.durability == Durability::Group)
+        flusher_ = thread(&WriteAheadLog::flusherLoop, this);
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    {
+        lock_guard lock(mu_);
+        stop_ = true;
+    }
+    flushCv_.notify_all();
+    if (flusher_.joinable()) flusher_.join();
+    if (!buf_.empty() && !failure_) {                   // None / PerCommit leftovers
+        writeOut(buf_, opts_.durability != Durability::None);
+        buf_.clear();
+    }
+    closeFd(fd_);
+}
+
+void WriteAheadLog::writeOut(const string& bytes, bool doSync) {
+    writeAll(fd_, bytes.data(), bytes.size());
+    if (doSync) syncFd(fd_);
+}
+
+void WriteAheadLog::onCommit(span<const CommittedChange> changes) {
+    thread_local string rec;                            // encode outside the lock
+    rec.clear();
+    encodeRecord(rec, changes);
+
+    unique_lock lock(mu_);
+    if (failure_) rethrow_exception(failure_);
+    buf_ += rec;
+    const uint64_t lsn = ++appended_;
+
+    switch (opts_.durability) {
+    case Durability::None:
+        if (buf_.size() >= (1u << 20)) {
+            writeOut(buf_, false);
+            buf_.clear();
+        }
+        break;
+    case Durability::PerCommit:
+        writeOut(buf_, true);
+        buf_.clear();
+        durable_ = lsn;
+        ++fsyncs_;
+        break;
+    case Durability::Async:
+        if (buf_.size() >= (1u << 20)) flushCv_.notify_one();
+        break;
+    case Durability::Group:
+        flushCv_.notify_one();
+        durableCv_.wait(lock, [&] { return durable_ >= lsn || failure_; });
+        if (durable_ < lsn) rethrow_exception(failure_);
+        break;
+    }
+}
+
+void WriteAheadLog::flusherLoop() {
+    unique_lock lock(mu_);
+    for (;;) {
+        if (opts_.durability == Durability::Async)
+            flushCv_.wait_for(lock, opts_.flushInterval.count() ? opts_.flushInterval
+                                                                : chrono::microseconds(1000),
+                              [&] { return stop_ || flushNow_ || buf_.size() >= (1u << 20); });
+        else
+            flushCv_.wait(lock, [&] { return stop_ || !buf_.empty(); });
+
+        if (opts_.durability == Durability::Group && opts_.flushInterval.count()
+            && !stop_ && !flushNow_) {
+            lock.unlock();                              // let more commits join
+            this_thread::sleep_for(opts_.flushInterval);
+            lock.lock();
+        }
+
+        flushNow_ = false;
+        if (!buf_.empty()) {
+            string batch;
+            batch.swap(buf_);
+            const uint64_t upTo = appended_;
+            lock.unlock();
+            try {
+                writeOut(batch, true);                  // one fsync for the whole batch
+            } catch (...) {                             // hand it to the committers
+                lock.lock();
+                failure_ = current_exception();
+                durableCv_.notify_all();
+                return;
+            }
+            lock.lock();
+            durable_ = upTo;
+            ++fsyncs_;
+            durableCv_.notify_all();
+        }
+        if (stop_ && buf_.empty()) return;
+    }
+}
+
+void WriteAheadLog::sync() {
+    unique_lock lock(mu_);
+    if (failure_) rethrow_exception(failure_);
+    if (flusher_.joinable()) {                          // the flusher owns the fd
+        const uint64_t upTo = appended_;
+        flushNow_ = true;                               // do not wait out the timer
+        flushCv_.notify_one();
+        durableCv_.wait(lock, [&] { return durable_ >= upTo || failure_; });
+        if (durable_ < upTo) rethrow_exception(failure_);
+        return;
+    }
+    writeOut(buf_, true);
+    buf_.clear();
+    durable_ = appended_;
+    ++fsyncs_;
+}
+
+uint64_t WriteAheadLog::records() const { lock_guard lock(mu_); return appended_; }
+uint64_t WriteAheadLog::fsyncs()  const { lock_guard lock(mu_); return fsyncs_; }
+
+/* ─────────────────── replay ─────────────────── */
+/* a record is decoded in full before any of it is applied, so one that
+   fails to decode leaves db as of the record before it */
+size_t WriteAheadLog::replay(const string& path, InMemoryDB& db) {
+    error_code ec;
+    if (!filesystem::exists(path, ec)) return 0;
+    uintmax_t good = 0, size = 0;
+    size_t applied = 0;
+    {
+        MappedFile file(path, MappedFile::Access::Sequential);   // no copy of a big log
+        const char* const begin = file.data();
+        const char* p   = begin;
+        const char* end = p + file.size();
+        vector<CommittedChange> changes;                // reused across records
+
+        while (end - p >= 8) {
+            uint32_t len = getU32(p);
+            uint32_t crc = getU32(p + 4);
+            if (len > static_cast<size_t>(end - p - 8) || crc32(p + 8, len) != crc) break;
+
+            const char* q    = p + 8;
+            const char* qend = q + len;
+            uint64_t n;
+            if (!getVarint(q, qend, n)) break;
+            changes.clear();
+            bool ok = true;
+            for (uint64_t i = 0; i < n && ok; ++i) {    // checksum passed ⇒ well formed
+                char op = q < qend ? *q++ : -1;
+                string_view key, val;
+                ok = getBytes(q, qend, key) && (op == 0 || (op == 1 && getBytes(q, qend, val)));
+                if (ok) changes.push_back({ key, op == 1 ? optional<string_view>(val) : nullopt });
+            }
+            if (!ok) break;
+            for (const auto& c : changes) {
+                if (c.val) db.set(c.key, *c.val);
+                else       db.del(c.key);
+            }
+            p = qend;
+            ++applied;
+        }
+        good = static_cast<uintmax_t>(p - begin);
+        size = file.size();
+    }                                                   // unmapped before truncating
+    if (good != size) filesystem::resize_file(path, good);   // drop torn tail
+    return applied;
+}
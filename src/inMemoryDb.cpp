@@ -1,91 +1,1308 @@
 #include "inMemoryDb.h"
+#include "Checkpoint.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <stdexcept>
 
 using namespace std;
 
-/* ─────────────────── helpers ─────────────────── */
-void InMemoryDB::inc(const string& v) { ++valCount_[v]; }
+/* heap bytes owned by a stored string (0 while it fits the SSO buffer) */
+static size_t stringHeap(const string& s) {
+    static const size_t sso = string().capacity();
+    return s.capacity() > sso ? s.capacity() + 1 : 0;
+}
+
+/* s as a counter: canonical decimal int64 only, so the text incr() writes
+   back is the text it read */
+static bool parseCounter(string_view s, int64_t& n) {
+    if (s.empty() || s == "-0") return false;
+    const size_t lead = s[0] == '-';
+    if (s.size() > lead + 1 && s[lead] == '0') return false;
+    auto r = from_chars(s.data(), s.data() + s.size(), n);
+    return r.ec == errc() && r.ptr == s.data() + s.size();
+}
+
+/* n += d; false (n unchanged) on int64 overflow */
+static bool addCounter(int64_t& n, int64_t d) {
+    if (d > 0 ? n > INT64_MAX - d : n < INT64_MIN - d) return false;
+    n += d;
+    return true;
+}
+
+InMemoryDB::InMemoryDB(shared_ptr<const Checkpoint> image, TxnMode mode)
+    : mode_(mode), image_(std::move(image)) {}
 
-void InMemoryDB::dec(const string& v) {
-    auto it = valCount_.find(v);
-    if (it != valCount_.end() && --(it->second) == 0)
-        valCount_.erase(it);
+/* ─────────────────── value pool ─────────────────── */
+InMemoryDB::ValueId InMemoryDB::intern(string_view v) {
+    auto it = valueIds_.find(v);
+    if (it != valueIds_.end()) return it->second;
+
+    ValueId id;
+    if (!freeIds_.empty()) {                // reuse a reclaimed slot
+        id = freeIds_.back();
+        freeIds_.pop_back();
+        values_[id].assign(v);
+    } else {
+        id = static_cast<ValueId>(values_.size());
+        values_.emplace_back(v);
+        valCount_.push_back(0);
+        valRefs_.push_back(0);
+    }
+    valueIds_.try_emplace(v, id);
+    heap_ += stringHeap(values_[id]) + heapBytes(v.size());
+    return id;
 }
 
-/* register first-time change inside the **current** transaction */
-void InMemoryDB::record(const string& key) {
+void InMemoryDB::pin(ValueId id) { ++valRefs_[id]; }
+
+void InMemoryDB::unpin(ValueId id) {
+    if (--valRefs_[id] != 0) return;
+    valueIds_.erase(values_[id]);           // last holder gone → reclaim
+    heap_ -= stringHeap(values_[id]) + heapBytes(values_[id].size());
+    string().swap(values_[id]);
+    freeIds_.push_back(id);
+}
+
+/* false (nothing changed) if another id already holds v */
+bool InMemoryDB::rename(ValueId id, string_view v) {
+    string& s = values_[id];
+    valueIds_.erase(s);                     // first: the insert must not grow the table
+    if (!valueIds_.try_emplace(v, id).second) {
+        valueIds_.try_emplace(s, id);
+        return false;
+    }
+    heap_ += heapBytes(v.size()) - heapBytes(s.size()) - stringHeap(s);
+    s.assign(v);
+    heap_ += stringHeap(s);
+    return true;
+}
+
+void InMemoryDB::inc(ValueId id, string_view key) {
+    ++valCount_[id];
+    pin(id);
+    if (byValue_) holderAdd(id, key);
+}
+
+void InMemoryDB::dec(ValueId id, string_view key) {
+    if (byValue_) holderDrop(id, key);
+    --valCount_[id];
+    unpin(id);
+}
+
+/* ─────────────────── value → keys index ─────────────────── */
+/*
+ * Value index (optional, setValueIndex)
+ *
+ *  byValue_     : keys : value-id → keys of db_ holding it (unordered)
+ *                 pos  : key → its position in that list
+ *
+ *                 inc() / dec() – the only places a db_ key starts or
+ *                 stops holding a value, ROLLBACK and eviction included –
+ *                 append the key or swap-remove it (the last key moves
+ *                 into the hole), so upkeep is O(1) amortized and
+ *                 keys[id].size() == valCount_[id] at all times.
+ *
+ *  keysWithValue() walks that list – O(COUNT) – and, like COUNT, adds
+ *  the keys of open overlay levels (O(#keys they wrote)) and of the image
+ *  (a walk of its keyDir, only if the image still shows the value).  Each
+ *  key is reported once, exactly when GET would return the value.
+ *  Without the index the db_ part is a walk of db_ – O(N).
+ */
+void InMemoryDB::holderAdd(ValueId id, string_view key) {
+    auto& ix = *byValue_;
+    if (id >= ix.keys.size()) ix.keys.resize(values_.size());
+    auto& list = ix.keys[id];
+    const size_t cap = list.capacity();
+    ix.pos.try_emplace(key, static_cast<uint32_t>(list.size()));
+    list.emplace_back(key);
+    ix.bytes += (list.capacity() - cap) * sizeof(string) + 2 * heapBytes(key.size());
+}
+
+void InMemoryDB::setValueIndex(bool on) {
+    if (!on) { byValue_.reset(); return; }
+    if (byValue_) return;
+    byValue_.emplace();
+    byValue_->pos.reserve(db_.size());
+    for (auto& [key, e] : db_) holderAdd(e.val, key);
+}
+
+/* one report per visible key; sink(ctx, key) for at most `limit` */
+size_t InMemoryDB::holdersOf(string_view val, size_t limit, KeySink sink, void* ctx) const {
+    size_t n = 0;
+    auto emit = [&](string_view k) {
+        sink(ctx, k);
+        return ++n < limit;
+    };
+    auto shows = [&](string_view k) {           // what GET would return
+        auto v = peek(k);
+        return v && *v == val;
+    };
+    if (limit == 0) return 0;
+
+    /* db_ holders – hidden only by an overlay level that rewrote them */
+    auto id = valueIds_.find(val);
+    const bool pooled = id != valueIds_.end() && valCount_[id->second] > 0;
+    if (pooled) {
+        const ValueId v = id->second;
+        auto each = [&](string_view k) {
+            return (!layers_.empty() && !shows(k)) || pastDeadline(k) || emit(k);
+        };
+        if (byValue_) {
+            for (const auto& k : byValue_->keys[v])
+                if (!each(k)) return n;
+        } else {
+            for (const auto& [k, e] : db_)
+                if (e.val == v && !each(k)) return n;
+        }
+    }
+
+    /* overlay writes: the top-most level that mentions a key decides */
+    auto mentionedAbove = [&](string_view k, size_t level) {
+        for (size_t l = level + 1; l < layers_.size(); ++l)
+            if (layers_[l].writes.contains(k)) return true;
+        return false;
+    };
+    for (size_t l = layers_.size(); l-- > 0;)
+        for (const auto& [k, w] : layers_[l].writes) {
+            if (!w || *w != val || mentionedAbove(k, l)) continue;
+            if (pooled) {                       // reported above already?
+                auto it = db_.find(k);
+                if (it != db_.end() && it->second.val == id->second) continue;
+            }
+            if (!emit(k)) return n;
+        }
+
+    /* image keys nobody has promoted or overwritten */
+    if (!image_) return n;
+    auto iv = image_->findValue(val);
+    if (!iv) return n;
+    auto h = hidden_.find(*iv);
+    if (image_->count(*iv) == (h == hidden_.end() ? 0 : h->second)) return n;
+    for (size_t i = 0, end = image_->keyCount(); i < end; ++i) {
+        if (image_->valueAt(i).valueIdx != *iv) continue;
+        const string_view k = image_->keyAt(i);
+        if (shadowed_.contains(k) || mentionedAbove(k, size_t(-1))) continue;
+        if (!emit(k)) return n;
+    }
+    return n;
+}
+
+vector<string> InMemoryDB::keysWithValue(string_view val, size_t limit) const {
+    vector<string> keys;
+    keysWithValue(val, limit, [&](string_view k) { keys.emplace_back(k); });
+    return keys;
+}
+
+/* swap-remove: the list's last key takes the freed position */
+void InMemoryDB::holderDrop(ValueId id, string_view key) {
+    auto& ix = *byValue_;
+    auto p = ix.pos.find(key);
+    auto& list = ix.keys[id];
+    const uint32_t at = p->second;
+    ix.pos.erase(p);
+    ix.bytes -= 2 * heapBytes(key.size());
+    if (at + 1 != list.size()) {
+        list[at] = std::move(list.back());
+        ix.pos.find(list[at])->second = at;
+    }
+    list.pop_back();
+}
+
+/* register first-time change inside the **current** transaction;
+   e is the key's entry before the write (nullptr ⇒ key absent) */
+void InMemoryDB::record(string_view key, Entry* e) {
     if (txnStack_.empty()) return;      // outside txn
-    auto& log = txnStack_.back();
-    for (auto& c : log)                 // already logged?
-        if (c.key == key) return;
-    auto it = db_.find(key);
-    log.push_back({ key,
-                    it == db_.end() ? nullopt
-                                    : optional<string>(it->second) });
+    auto& top = txnStack_.back();
+    if (!e) {                           // absent: nothing to stamp
+        top.log.push_back({ undoKeys_.copy(key), nullopt, 0 });
+        return;
+    }
+    if (e->stamp == top.epoch) return;  // already logged in this scope
+    pin(e->val);                        // log keeps the old id alive
+    top.log.push_back({ undoKeys_.copy(key), e->val, e->stamp, deadlineOf(key) });
+    e->stamp = top.epoch;
+}
+
+/* ─────────────────── expiration ─────────────────── */
+/*
+ * Expiration (set with a TTL)
+ *
+ *  Time is milliseconds of clock_ (steady_clock unless setClock()).
+ *
+ *    expires_   : key → deadline, only for keys that have a TTL
+ *    wheel_     : TimingWheel of (deadline, key); entries are never
+ *                 removed, a firing entry counts only if expires_ still
+ *                 holds exactly its deadline
+ *
+ *  Active : expire(budget) advances the wheel towards the clock and
+ *           deletes due keys through the normal dec() path, so valCount_
+ *           and the ordered index stay exact.  At most `budget` wheel
+ *           entries are touched per call; a storm of equal deadlines is
+ *           drained over several calls (the wheel's time waits for it).
+ *  Lazy   : a write that meets a key past its deadline deletes it first,
+ *           so SET / DELETE never act on an expired value.  Reads are
+ *           const and cannot delete, so GET, MGET, scans and
+ *           keysWithValue() treat such a key as absent and COUNT leaves
+ *           it out (a walk of expires_, or of the value's holders with
+ *           the value index if that is shorter).  Without TTLs
+ *           (expires_ empty) none of this costs more than a branch.
+ *
+ *  A plain SET removes the TTL; DELETE removes key and TTL.
+ *
+ *  Transactions (UndoLog): an undo record keeps the key's prior deadline.
+ *  Expiry inside a transaction is not logged – an expired key cannot come
+ *  back – and ROLLBACK does not restore a prior version whose deadline
+ *  has passed by then; restored TTLs are scheduled again.  Overlay: time
+ *  stands still while a level is open (expire() does nothing), and a
+ *  layer's TTLs take effect at COMMIT.
+ *
+ *  The observer sees an expiry as a deletion, published when it happens
+ *  (or by the COMMIT, for keys an open transaction has written).  TTLs
+ *  themselves are not part of WAL records or checkpoint images.
+ */
+uint64_t InMemoryDB::now() const {
+    if (clock_) return clock_();
+    return static_cast<uint64_t>(chrono::duration_cast<chrono::milliseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+uint64_t InMemoryDB::deadlineOf(string_view key) const {
+    for (auto l = layers_.rbegin(); l != layers_.rend(); ++l) {
+        if (!l->writes.contains(key)) continue;
+        auto d = l->deadlines.find(key);
+        return d != l->deadlines.end() ? d->second : 0;
+    }
+    if (expires_.empty()) return 0;
+    auto d = expires_.find(key);
+    return d != expires_.end() ? d->second : 0;
+}
+
+void InMemoryDB::setDeadline(string_view key, uint64_t deadline) {
+    if (!deadline) {
+        if (!expires_.empty() && expires_.erase(key)) heap_ -= heapBytes(key.size());
+        return;
+    }
+    auto [d, fresh] = expires_.try_emplace(key, deadline);
+    if (fresh) {
+        heap_ += heapBytes(key.size());
+    } else {
+        if (d->second == deadline) return;      // its wheel entry is still valid
+        d->second = deadline;
+    }
+    if (wheel_.size() == 0) wheel_.seek(max(wheel_.now(), now()));
+    wheel_.schedule(deadline, key);
+}
+
+/* not logged: an expired or evicted key never comes back.  Keys written
+   by an open transaction are published by its COMMIT instead. */
+void InMemoryDB::discard(KeyTable::iterator it, string_view key) {
+    const bool owned = !txnStack_.empty() && it->second.stamp >= txnStack_.front().epoch;
+    preserve(key, it->second);
+    dec(it->second.val, key);
+    db_.erase(it);
+    keyDropped(key);
+    setDeadline(key, 0);
+    if (observer_ && !owned) {
+        CommittedChange c{ key, nullopt };
+        observer_->onCommit({ &c, 1 });
+    }
+}
+
+void InMemoryDB::reap(KeyTable::iterator it, string_view key) {
+    discard(it, key);
+    ++expired_;
+}
+
+bool InMemoryDB::pastDeadline(string_view key) const {
+    if (expires_.empty() || !layers_.empty()) return false;   // overlay: time stands still
+    auto d = expires_.find(key);
+    return d != expires_.end() && d->second <= now();
+}
+
+size_t InMemoryDB::expiredHolders(ValueId id) const {
+    if (expires_.empty() || !layers_.empty() || valCount_[id] == 0) return 0;
+    const uint64_t t = now();
+    size_t n = 0;
+    if (byValue_ && byValue_->keys[id].size() < expires_.size()) {
+        for (const auto& k : byValue_->keys[id]) {
+            auto d = expires_.find(k);
+            n += d != expires_.end() && d->second <= t;
+        }
+    } else {
+        for (const auto& [k, d] : expires_) {
+            if (d > t) continue;
+            auto e = db_.find(k);
+            n += e != db_.end() && e->second.val == id;
+        }
+    }
+    return n;
+}
+
+bool InMemoryDB::reapIfExpired(KeyTable::iterator& it, string_view key) {
+    if (it == db_.end() || expires_.empty()) return false;
+    auto d = expires_.find(key);
+    if (d == expires_.end() || d->second > now()) return false;
+    reap(it, key);
+    it = db_.end();
+    return true;
+}
+
+void InMemoryDB::set(string_view key, string_view val, chrono::milliseconds ttl) {
+    INMEMORYDB_OP(DbOp::Set);
+    const uint64_t deadline = now() + static_cast<uint64_t>(max<chrono::milliseconds::rep>(ttl.count(), 1));
+    if (!layers_.empty()) setOverlay(key, val, deadline);
+    else                  publishAutocommit(key, setBase(key, val, db_.hashKey(key), deadline));
+    enforceLimit();
+}
+
+optional<chrono::milliseconds> InMemoryDB::ttl(string_view key) const {
+    if (!peek(key)) return nullopt;
+    const uint64_t d = deadlineOf(key);
+    if (!d) return nullopt;
+    const uint64_t t = now();
+    return chrono::milliseconds(d > t ? static_cast<chrono::milliseconds::rep>(d - t) : 0);
+}
+
+size_t InMemoryDB::expire(size_t budget) {
+    if (!layers_.empty() || wheel_.size() == 0) return 0;   // overlay: time stands still
+    const size_t before = expired_;
+    wheel_.advance(now(), budget, [&](uint64_t when, string_view key) {
+        auto d = expires_.find(key);
+        if (d == expires_.end() || d->second != when) return;   // rewritten or deleted since
+        auto it = db_.find(key);
+        if (it != db_.end()) reap(it, key);
+        else                 setDeadline(key, 0);
+    });
+    return expired_ - before;
 }
 
 /* ─────────────────── data ops ─────────────────── */
-void InMemoryDB::set(const string& key, const string& val) {
-    record(key);
-    auto it = db_.find(key);
+void InMemoryDB::set(string_view key, string_view val) {
+    INMEMORYDB_OP(DbOp::Set);
+    if (!layers_.empty()) setOverlay(key, val);
+    else                  publishAutocommit(key, setBase(key, val));
+    enforceLimit();
+}
+
+bool InMemoryDB::setBase(string_view key, string_view val) {
+    return setBase(key, val, db_.hashKey(key));
+}
+
+bool InMemoryDB::setBase(string_view key, string_view val, uint64_t h, uint64_t deadline) {
+    auto it = db_.find(key, h);
+    if (it == db_.end() && image_) it = promote(key);
+    reapIfExpired(it, key);
     if (it != db_.end()) {                  // overwrite → fix counts
-        if (it->second == val) return;      // no effective change
-        dec(it->second);
-        it->second = val;
+        const bool sameVal = values_[it->second.val] == val;
+        touch(it->second);
+        if (sameVal && deadlineOf(key) == deadline) return false;   // no effective change
+        record(key, &it->second);
+        if (!sameVal) {
+            preserve(key, it->second);
+            ValueId id = intern(val);
+            dec(it->second.val, key);
+            it->second.val = id;
+            inc(id, key);
+        }
     } else {
-        db_[key] = val;
+        if (memLimit_) makeRoom();
+        record(key, nullptr);
+        ValueId id = intern(val);
+        db_.try_emplace(key, Entry{ .val = id, .snap = phase_, .stamp = currentEpoch() });   // unreferenced
+        keyAdded(key);
+        inc(id, key);
     }
-    inc(val);
+    setDeadline(key, deadline);
+    return true;
+}
+
+optional<string_view> InMemoryDB::lookup(string_view key) const {
+    return lookup(key, db_.hashKey(key));
+}
+
+optional<string_view> InMemoryDB::lookup(string_view key, uint64_t h) const {
+    return resolve(key, h, true);
 }
 
-optional<string> InMemoryDB::get(const string& key) const {
-    auto it = db_.find(key);
-    return it == db_.end() ? nullopt : optional<string>(it->second);
+optional<string_view> InMemoryDB::peek(string_view key) const {
+    return resolve(key, db_.hashKey(key), false);
 }
 
-void InMemoryDB::del(const string& key) {
-    auto it = db_.find(key);
-    if (it == db_.end()) return;            // nothing to do
-    record(key);
-    dec(it->second);
+optional<string_view> InMemoryDB::resolve(string_view key, uint64_t h, bool use) const {
+    for (auto l = layers_.rbegin(); l != layers_.rend(); ++l) {
+        auto w = l->writes.find(key);
+        if (w != l->writes.end())
+            return w->second ? optional<string_view>(*w->second) : nullopt;
+    }
+    auto it = db_.find(key, h);
+    if (it != db_.end()) {
+        if (pastDeadline(key)) return nullopt;
+        if (use) touch(it->second);
+        return values_[it->second.val];
+    }
+    if (!image_ || shadowed_.contains(key)) return nullopt;
+    auto hit = image_->find(key);
+    return hit ? optional<string_view>(hit->val) : nullopt;
+}
+
+/*
+ * Checkpoint image (optional, see Checkpoint.h)
+ *
+ *  A database constructed over a Checkpoint serves reads from the mapped
+ *  file until a key is written; the image itself is never modified.
+ *
+ *    shadowed_  : keys of the image that have been promoted.  A promoted
+ *                 key lives in db_ (or is gone, if deleted) and its image
+ *                 record is ignored from then on.
+ *    hidden_    : image value index → #promoted keys that held it
+ *
+ *  GET    : layers, db_, then the image unless the key is shadowed
+ *  WRITE  : first write to an image key copies it into db_ (stamp 0, so
+ *           the undo log treats it like any committed entry) and marks it
+ *           shadowed.  Promotion does not change the logical state, so
+ *           ROLLBACK never undoes it.
+ *  COUNT  : valCount_ + image count − hidden_
+ */
+
+/* move an unshadowed image key into db_; db_.end() if there is none */
+auto InMemoryDB::promote(string_view key) -> KeyTable::iterator {
+    if (shadowed_.contains(key)) return db_.end();
+    auto hit = image_->find(key);
+    if (!hit) return db_.end();
+    shadowed_.try_emplace(key, true);
+    heap_ += heapBytes(key.size());
+    ++hidden_.try_emplace(hit->valueIdx, 0).first->second;
+    ValueId id = intern(hit->val);
+    inc(id, key);
+    keyAdded(key);
+    if (walk_ && !imageWalked(key)) keep(key, hit->val);   // the image walk will skip it now
+    return db_.try_emplace(key, Entry{ .val = id, .snap = phase_ }).first;
+}
+
+optional<string> InMemoryDB::get(string_view key) const {
+    INMEMORYDB_OP(DbOp::Get);
+    auto v = lookup(key);
+    noteReads(v.has_value(), !v);
+    return v ? optional<string>(*v) : nullopt;
+}
+
+optional<string_view> InMemoryDB::getView(string_view key) const {
+    INMEMORYDB_OP(DbOp::Get);
+    auto v = lookup(key);
+    noteReads(v.has_value(), !v);
+    return v;
+}
+
+void InMemoryDB::del(string_view key) {
+    INMEMORYDB_OP(DbOp::Del);
+    if (!layers_.empty()) delOverlay(key);
+    else                  publishAutocommit(key, delBase(key));
+    enforceLimit();                             // an undo record may have grown the total
+}
+
+bool InMemoryDB::delBase(string_view key) { return delBase(key, db_.hashKey(key)); }
+
+bool InMemoryDB::delBase(string_view key, uint64_t h) {
+    auto it = db_.find(key, h);
+    if (it == db_.end() && image_) it = promote(key);
+    if (reapIfExpired(it, key) || it == db_.end()) return false;   // nothing (left) to do
+    record(key, &it->second);
+    preserve(key, it->second);
+    dec(it->second.val, key);
     db_.erase(it);
+    keyDropped(key);
+    setDeadline(key, 0);
+    return true;
 }
 
-size_t InMemoryDB::count(const string& val) const {
-    auto it = valCount_.find(val);
-    return it == valCount_.end() ? 0 : it->second;
+size_t InMemoryDB::count(string_view val) const {
+    INMEMORYDB_OP(DbOp::Count);
+    auto it = valueIds_.find(val);
+    ptrdiff_t n = it == valueIds_.end() ? 0
+                : static_cast<ptrdiff_t>(valCount_[it->second] - expiredHolders(it->second));
+    if (image_)
+        if (auto iv = image_->findValue(val)) {
+            auto h = hidden_.find(*iv);
+            n += static_cast<ptrdiff_t>(image_->count(*iv))
+               - (h == hidden_.end() ? 0 : static_cast<ptrdiff_t>(h->second));
+        }
+    for (const auto& l : layers_) {
+        auto d = l.countDelta.find(val);
+        if (d != l.countDelta.end()) n += d->second;
+    }
+    return static_cast<size_t>(n);
+}
+
+/*
+ * Counters (incr)
+ *
+ *  A counter is an ordinary value: its canonical decimal text ("-12",
+ *  never "+12" or "012"), so GET, COUNT, scans, snapshots, the WAL and
+ *  checkpoints see nothing new.  What incr() saves is the pool churn of
+ *  the equivalent SET: when the key is the only holder of its value id
+ *  (valRefs_ == 1 – no other key, no undo record), the new number is
+ *  written into that pool slot in place and valueIds_ re-keyed, so
+ *  valCount_, valRefs_ and the value index are left as they are.  The
+ *  text fits the SSO buffer up to 15 digits, so an increment allocates
+ *  nothing.
+ *
+ *  The first incr of a key in a transaction level logs the old id, which
+ *  pins it; that one takes the normal intern path, later ones in the same
+ *  level are in place again.  So does a result another key already holds.
+ *  Overlay levels buffer the new text like any other write.
+ */
+
+optional<int64_t> InMemoryDB::incr(string_view key, int64_t delta) {
+    INMEMORYDB_OP(DbOp::Set);
+    char buf[24];
+    int64_t n = 0;
+    if (!layers_.empty()) {
+        auto cur = lookup(key);
+        if ((cur && !parseCounter(*cur, n)) || !addCounter(n, delta)) return nullopt;
+        setOverlay(key, string_view(buf, to_chars(buf, buf + sizeof buf, n).ptr), deadlineOf(key));
+        enforceLimit();
+        return n;
+    }
+    const uint64_t h = db_.hashKey(key);
+    auto it = db_.find(key, h);
+    if (it == db_.end() && image_) it = promote(key);
+    reapIfExpired(it, key);
+    if (it != db_.end() && !parseCounter(values_[it->second.val], n)) return nullopt;
+    if (!addCounter(n, delta)) return nullopt;
+    const string_view text(buf, to_chars(buf, buf + sizeof buf, n).ptr);
+
+    const bool sole = it != db_.end() && valRefs_[it->second.val] == 1
+                   && (txnStack_.empty() || it->second.stamp == txnStack_.back().epoch);
+    if (sole) preserve(key, it->second);        // before rename() may change the value
+    if (sole && rename(it->second.val, text)) {
+        touch(it->second);
+        publishAutocommit(key, true);
+    } else {
+        publishAutocommit(key, setBase(key, text, h, deadlineOf(key)));
+    }
+    enforceLimit();
+    return n;
+}
+
+/* ─────── overlay writes (TxnMode::Overlay, inside BEGIN) ─────── */
+void InMemoryDB::setOverlay(string_view key, string_view val, uint64_t deadline) {
+    auto cur = lookup(key);
+    const bool sameVal = cur && *cur == val;
+    if (sameVal && deadlineOf(key) == deadline) return;   // no effective change
+    auto& top = layers_.back();
+    if (!sameVal) {
+        if (cur) countDelta(top, *cur, -1);     // before the write: cur may point into top
+        countDelta(top, val, +1);
+    }
+    auto [w, fresh] = top.writes.try_emplace(key);
+    if (fresh)       top.heap += heapBytes(key.size());
+    if (w->second)   top.heap -= stringHeap(*w->second);
+    w->second.emplace(val);
+    top.heap += stringHeap(*w->second);
+    if (deadline) {
+        auto [d, dFresh] = top.deadlines.try_emplace(key, deadline);
+        if (dFresh) top.heap += heapBytes(key.size());
+        else        d->second = deadline;
+    } else if (top.deadlines.erase(key)) {
+        top.heap -= heapBytes(key.size());
+    }
+}
+
+bool InMemoryDB::delOverlay(string_view key) {
+    auto cur = lookup(key);
+    if (!cur) return false;                     // nothing to do
+    auto& top = layers_.back();
+    countDelta(top, *cur, -1);
+    auto [w, fresh] = top.writes.try_emplace(key);
+    if (fresh)     top.heap += heapBytes(key.size());
+    if (w->second) top.heap -= stringHeap(*w->second);
+    w->second.reset();
+    if (top.deadlines.erase(key)) top.heap -= heapBytes(key.size());
+    return true;
+}
+
+void InMemoryDB::countDelta(Layer& l, string_view val, ptrdiff_t d) {
+    auto [c, fresh] = l.countDelta.try_emplace(val, 0);
+    if (fresh) l.heap += heapBytes(val.size());
+    c->second += d;
+}
+
+/* ─────── commit notifications ─────── */
+void InMemoryDB::publishAutocommit(string_view key, bool changed) {
+    if (!observer_ || !changed || !txnStack_.empty()) return;
+    CommittedChange c{ key, peek(key) };
+    observer_->onCommit({ &c, 1 });
+}
+
+/* keys: every key written by the committed levels, duplicates allowed */
+template <class KeyRange>
+void InMemoryDB::publishCommit(const KeyRange& keys) {
+    FlatHashMap<string_view, bool> seen;
+    vector<CommittedChange>        changes;
+    for (string_view k : keys)
+        if (seen.try_emplace(k, true).second)
+            changes.push_back({ k, peek(k) });
+    if (!changes.empty()) observer_->onCommit(changes);
+}
+
+/* ─────── batched ops ─────── */
+/*
+ * Batched commands
+ *
+ *  mget / mset / mdel run the same code per key but keep a sliding window
+ *  of keys in flight (prefetched() below), so one batch pays roughly one
+ *  memory latency per window rather than per key.  Inside a transaction
+ *  the batch grows the undo log once for all its records.
+ */
+/* calls f(i, h_i) for i = 0..n-1 in order; key i+16 is hashed and its
+   control group prefetched, key i+8 gets its slot prefetched */
+template <class KeyAt, class F>
+void InMemoryDB::prefetched(size_t n, KeyAt&& keyAt, F&& f) const {
+    constexpr size_t kAhead = 16, kSlotAhead = 8;
+    uint64_t ring[kAhead];
+    for (size_t i = 0; i < n && i < kAhead; ++i) {
+        ring[i] = db_.hashKey(keyAt(i));
+        db_.prefetch(ring[i]);
+    }
+    for (size_t i = 0; i < n; ++i) {
+        if (i + kSlotAhead < n) db_.prefetchSlot(ring[(i + kSlotAhead) % kAhead]);
+        const uint64_t h = ring[i % kAhead];
+        if (i + kAhead < n) {
+            ring[i % kAhead] = db_.hashKey(keyAt(i + kAhead));
+            db_.prefetch(ring[i % kAhead]);
+        }
+        f(i, h);
+    }
+}
+
+void InMemoryDB::reserveUndo(size_t n) {
+    if (txnStack_.empty()) return;
+    auto& log = txnStack_.back().log;
+    if (log.capacity() - log.size() < n)        // keep growth geometric
+        log.reserve(max(log.size() + n, 2 * log.capacity()));
+}
+
+void InMemoryDB::mgetView(span<const string_view> keys, span<optional<string_view>> out) const {
+    INMEMORYDB_OP_ADD(DbOp::Get, keys.size());
+    size_t hits = 0;
+    prefetched(keys.size(), [&](size_t i) { return keys[i]; }, [&](size_t i, uint64_t h) {
+        out[i] = lookup(keys[i], h);
+        hits += out[i].has_value();
+    });
+    noteReads(hits, keys.size() - hits);
+}
+
+vector<optional<string>> InMemoryDB::mget(span<const string_view> keys) const {
+    INMEMORYDB_OP_ADD(DbOp::Get, keys.size());
+    vector<optional<string>> out(keys.size());
+    size_t hits = 0;
+    prefetched(keys.size(), [&](size_t i) { return keys[i]; }, [&](size_t i, uint64_t h) {
+        if (auto v = lookup(keys[i], h)) {
+            out[i].emplace(*v);
+            ++hits;
+        }
+    });
+    noteReads(hits, keys.size() - hits);
+    return out;
+}
+
+void InMemoryDB::mset(span<const pair<string_view, string_view>> kvs) {
+    INMEMORYDB_OP_ADD(DbOp::Set, kvs.size());
+    if (!layers_.empty()) {                     // overlay: nothing to prefetch in db_
+        for (auto& [k, v] : kvs) setOverlay(k, v);
+        enforceLimit();
+        return;
+    }
+    reserveUndo(kvs.size());
+    const bool publish = observer_ && txnStack_.empty();
+    vector<string_view> changed;
+    prefetched(kvs.size(), [&](size_t i) { return kvs[i].first; }, [&](size_t i, uint64_t h) {
+        if (setBase(kvs[i].first, kvs[i].second, h) && publish) changed.push_back(kvs[i].first);
+    });
+    if (!changed.empty()) publishCommit(changed);
+    enforceLimit();                             // once per batch, after it is published
+}
+
+size_t InMemoryDB::mdel(span<const string_view> keys) {
+    INMEMORYDB_OP_ADD(DbOp::Del, keys.size());
+    size_t removed = 0;
+    if (!layers_.empty()) {
+        for (auto k : keys) removed += delOverlay(k);
+        enforceLimit();
+        return removed;
+    }
+    reserveUndo(keys.size());
+    const bool publish = observer_ && txnStack_.empty();
+    vector<string_view> changed;
+    prefetched(keys.size(), [&](size_t i) { return keys[i]; }, [&](size_t i, uint64_t h) {
+        if (!delBase(keys[i], h)) return;
+        ++removed;
+        if (publish) changed.push_back(keys[i]);
+    });
+    if (!changed.empty()) publishCommit(changed);
+    enforceLimit();
+    return removed;
+}
+
+/* ─────── ordered scans ─────── */
+/*
+ * Ordered index (optional, setOrderedIndex)
+ *
+ *  ordered_     : BPlusTreeSet of the keys in db_.  Every place that adds
+ *                 a key to db_ or erases one (write, delete, promotion and
+ *                 the undo replay of ROLLBACK) updates it too, so it always
+ *                 mirrors db_ and a rollback restores it with the keys.
+ *
+ *  scan / scanRange merge three sorted streams – ordered_, the image's
+ *  keyDir and the keys written by open overlay levels – and resolve each
+ *  candidate with the normal lookup, so a page sees exactly what GET
+ *  would.  Cost is O(log N + page) plus any candidates that turn out to
+ *  be deleted (shadowed image keys, overlay deletes).  Overlay keys are
+ *  gathered per call: O(#keys written by the open levels).
+ *
+ *  Without the index a scan sorts the matching keys of db_ first – O(N).
+ *
+ *  Cursors are keys: a page's `next` is its last key + '\0', the smallest
+ *  key after it, so paging stays correct when keys change in between.
+ */
+void InMemoryDB::setOrderedIndex(bool on) {
+    if (!on) { ordered_.reset(); return; }
+    if (ordered_) return;
+    ordered_.emplace();
+    for (auto& kv : db_) ordered_->insert(kv.first);
+}
+
+ScanPage InMemoryDB::scan(string_view prefix, size_t limit, string_view cursor) const {
+    string to(prefix);                          // smallest string above every extension
+    while (!to.empty() && static_cast<unsigned char>(to.back()) == 0xFF) to.pop_back();
+    if (!to.empty()) to.back() = static_cast<char>(static_cast<unsigned char>(to.back()) + 1);
+    return scanRange(prefix, to, limit, cursor);
+}
+
+ScanPage InMemoryDB::scanRange(string_view from, string_view to, size_t limit, string_view cursor) const {
+    ScanPage page;
+    if (limit == 0) return page;
+    const string_view lo = max(from, cursor);
+    auto below = [&](string_view k) { return to.empty() || k < to; };
+
+    /* stream 1: db_ keys */
+    vector<string_view> unindexed;              // only without ordered_
+    size_t ui = 0;
+    BPlusTreeSet<string>::const_iterator oi;
+    if (ordered_) {
+        oi = ordered_->lower_bound(lo);
+    } else {
+        for (auto& kv : db_)
+            if (kv.first >= lo && below(kv.first)) unindexed.push_back(kv.first);
+        sort(unindexed.begin(), unindexed.end());
+    }
+    auto baseHead = [&]() -> optional<string_view> {
+        if (ordered_) return oi != ordered_->end() ? optional<string_view>(*oi) : nullopt;
+        return ui < unindexed.size() ? optional<string_view>(unindexed[ui]) : nullopt;
+    };
+    auto baseNext = [&] { if (ordered_) ++oi; else ++ui; };
+
+    /* stream 2: image keys (lookup() skips shadowed ones) */
+    size_t ii = image_ ? image_->lowerBound(lo) : 0;
+    const size_t iEnd = image_ ? image_->keyCount() : 0;
+
+    /* stream 3: keys written by open overlay levels */
+    vector<string_view> pending;
+    for (const auto& l : layers_)
+        for (const auto& kv : l.writes)
+            if (kv.first >= lo && below(kv.first)) pending.push_back(kv.first);
+    sort(pending.begin(), pending.end());
+    pending.erase(unique(pending.begin(), pending.end()), pending.end());
+    size_t pi = 0;
+
+    for (;;) {
+        optional<string_view> key = baseHead();
+        if (ii < iEnd && (!key || image_->keyAt(ii) < *key)) key = image_->keyAt(ii);
+        if (pi < pending.size() && (!key || pending[pi] < *key)) key = pending[pi];
+        if (!key || !below(*key)) break;
+
+        const string_view k = *key;            // advance every stream sitting on k
+        if (auto b = baseHead(); b && *b == k) baseNext();
+        if (ii < iEnd && image_->keyAt(ii) == k) ++ii;
+        if (pi < pending.size() && pending[pi] == k) ++pi;
+
+        auto v = lookup(k);
+        if (!v) continue;
+        if (page.items.size() == limit) {       // one more exists → hand out a cursor
+            page.next = page.items.back().first;
+            page.next += '\0';
+            break;
+        }
+        page.items.emplace_back(k, *v);
+    }
+    return page;
 }
 
 /* ─────── transaction ops ─────── */
-void InMemoryDB::begin() { txnStack_.push_back({}); }
+/*
+ * Undo log (TxnMode::UndoLog)
+ *
+ *  txnStack_    : vector< Txn{ epoch, vector<Change>, arena mark } >
+ *                 each level holds the “undo log” of THAT transaction
+ *                 (only the first modification of a key in the scope
+ *                 is stored, so space is proportional to #changes,
+ *                 not #keys → satisfies space constraint).
+ *
+ *                 Frames are recycled: a finished level's log vector is
+ *                 cleared into spareLogs_ and reused by the next BEGIN, and
+ *                 COMMIT swaps the stack with spareStack_ instead of
+ *                 freeing it.  Once warm, BEGIN / ROLLBACK / COMMIT and
+ *                 the logging itself allocate nothing.
+ *
+ *                 Every BEGIN draws a fresh, never-reused epoch.  Logging
+ *                 a key stamps its entry with the current epoch, so
+ *                 “already logged in this scope?” is one compare on the
+ *                 entry we just looked up – O(1) per write at any
+ *                 transaction size.  Keys that are absent have no entry to
+ *                 stamp; a key deleted and re-created within one scope may
+ *                 therefore be logged twice, which reverse replay handles
+ *                 (the older record is applied last).
+ *
+ *  Change       : { key; optional<ValueId> priorValue; priorStamp }
+ *                 key is a view into undoKeys_, a BumpArena shared by all
+ *                 levels: BEGIN takes a mark, ROLLBACK / COMMIT release
+ *                 to it once the log has been replayed or published.
+ *                 priorValue == nullopt  ⇒  key was absent beforehand
+ *                 (a present priorValue pins its id in the pool, so the
+ *                 displaced value moves into the log without a copy)
+ *                 priorStamp restores the entry's stamp on ROLLBACK so the
+ *                 parent scope still sees the key as logged.
+ *
+ *  On RELEASE   : fold the top log into its parent and pop one level.
+ *                 A record whose priorStamp is the parent's epoch describes
+ *                 a key the parent logged first, so it is dropped (and its
+ *                 pin released); every other record moves over and its
+ *                 entry is restamped with the parent's epoch.  The parent
+ *                 thus keeps only its own first-seen prior value per key,
+ *                 at O(#child records).  Moved records keep their keys
+ *                 where they are – above the parent's mark, so the
+ *                 parent's ROLLBACK / COMMIT frees them; if every record
+ *                 was dropped the arena goes back to the child's mark.
+ */
+void InMemoryDB::begin() {
+    INMEMORYDB_OP(DbOp::Begin);
+    if (mode_ == TxnMode::Overlay) {
+        layers_.emplace_back();
+        return;
+    }
+    Txn& t = txnStack_.emplace_back();
+    t.epoch = ++lastEpoch_;
+    t.keys  = undoKeys_.mark();
+    if (!spareLogs_.empty()) {                  // a recycled frame keeps its capacity
+        t.log = std::move(spareLogs_.back());
+        spareLogs_.pop_back();
+    }
+}
 
 TxnStatus InMemoryDB::rollback() {
+    INMEMORYDB_OP(DbOp::Rollback);
+    if (mode_ == TxnMode::Overlay) {
+        if (layers_.empty()) return TxnStatus::NoTransaction;
+        layers_.pop_back();                     // nothing reached db_
+        return TxnStatus::Ok;
+    }
     if (txnStack_.empty()) return TxnStatus::NoTransaction;
 
-    auto log = std::move(txnStack_.back());
+    auto log = std::move(txnStack_.back().log);
+    const BumpArena::Mark keys = txnStack_.back().keys;
     txnStack_.pop_back();
 
+    const uint64_t t = now();
     for (auto it = log.rbegin(); it != log.rend(); ++it) {
-        string current;
         auto curIt = db_.find(it->key);
-        if (curIt != db_.end()) current = curIt->second;
+        // a prior version whose deadline has passed stays expired
+        const bool expired = it->oldVal && it->priorDeadline && it->priorDeadline <= t;
 
-        // restore prior state
-        if (it->oldVal) {                       // had old value
-            if (curIt == db_.end()) db_[it->key] = *it->oldVal;
-            else                    curIt->second = *it->oldVal;
-        } else {                                // key originally absent
-            db_.erase(it->key);
+        // restore prior state (the log's pin keeps old alive until unpin)
+        if (it->oldVal && !expired) {           // had old value
+            ValueId old = *it->oldVal;
+            if (curIt == db_.end()) {
+                db_.try_emplace(it->key, Entry{ .val = old, .snap = phase_, .stamp = it->priorStamp });
+                keyAdded(it->key);
+                inc(old, it->key);
+            } else {
+                if (curIt->second.val != old) {
+                    preserve(it->key, curIt->second);
+                    dec(curIt->second.val, it->key);
+                    inc(old, it->key);
+                    curIt->second.val = old;
+                }
+                curIt->second.stamp = it->priorStamp;
+            }
+            unpin(old);                         // drop the log's reference
+            setDeadline(it->key, it->priorDeadline);
+            continue;
+        }
+        if (curIt != db_.end()) {               // key originally absent (or expired)
+            preserve(it->key, curIt->second);
+            dec(curIt->second.val, it->key);
+            db_.erase(curIt);
+            keyDropped(it->key);
+        }
+        setDeadline(it->key, 0);
+        if (expired) {
+            unpin(*it->oldVal);
+            ++expired_;
+            if (observer_ && txnStack_.empty()) {   // the prior version was committed state
+                CommittedChange c{ it->key, nullopt };
+                observer_->onCommit({ &c, 1 });
+            }
         }
-
-        /* adjust counts */
-        if (!current.empty()) dec(current);
-        if (it->oldVal)       inc(*it->oldVal);
     }
+    log.clear();                                // the frame goes back to the pool
+    spareLogs_.push_back(std::move(log));
+    undoKeys_.release(keys);
+    enforceLimit();                             // restored keys may not fit any more
     return TxnStatus::Ok;
 }
 
 TxnStatus InMemoryDB::commit() {
+    INMEMORYDB_OP(DbOp::Commit);
+    return commitAll();
+}
+
+TxnStatus InMemoryDB::commitAll() {
+    if (mode_ == TxnMode::Overlay) {
+        if (layers_.empty()) return TxnStatus::NoTransaction;
+        auto layers = std::move(layers_);       // base writes must not see layers
+        layers_.clear();
+        for (auto& l : layers)                  // bottom-up: later levels win
+            for (auto& [key, val] : l.writes) {
+                auto d = l.deadlines.find(key);
+                if (val) setBase(key, *val, db_.hashKey(key), d != l.deadlines.end() ? d->second : 0);
+                else     delBase(key);
+            }
+        if (observer_) {
+            vector<string_view> keys;
+            for (auto& l : layers)
+                for (auto& kv : l.writes) keys.push_back(kv.first);
+            publishCommit(keys);
+        }
+        enforceLimit();
+        return TxnStatus::Ok;
+    }
     if (txnStack_.empty()) return TxnStatus::NoTransaction;
-    txnStack_.clear();                          // all changes are already in db_
+    auto& stack = spareStack_;                  // observers see a txn-free db
+    stack.swap(txnStack_);
+    if (observer_) {
+        vector<string_view> keys;
+        for (auto& txn : stack)
+            for (auto& c : txn.log) keys.push_back(c.key);
+        publishCommit(keys);
+    }
+    for (auto& txn : stack) {                   // changes are already in db_;
+        for (auto& c : txn.log)                 // only the pins must go
+            if (c.oldVal) unpin(*c.oldVal);
+        txn.log.clear();
+        spareLogs_.push_back(std::move(txn.log));
+    }
+    undoKeys_.release(stack.front().keys);
+    stack.clear();
+    return TxnStatus::Ok;
+}
+
+TxnStatus InMemoryDB::release() {
+    INMEMORYDB_OP(DbOp::Release);
+    if (mode_ == TxnMode::Overlay) {
+        if (layers_.size() < 2) return commitAll();
+        Layer top = std::move(layers_.back());
+        layers_.pop_back();
+        Layer& into = layers_.back();
+        for (auto& [key, val] : top.writes) {   // top's writes are the newer ones
+            auto [w, fresh] = into.writes.try_emplace(key);
+            if (fresh)     into.heap += heapBytes(key.size());
+            if (w->second) into.heap -= stringHeap(*w->second);
+            w->second = std::move(val);
+            if (w->second) into.heap += stringHeap(*w->second);
+            auto d = top.deadlines.find(key);   // a write without TTL clears one below
+            if (d != top.deadlines.end()) {
+                auto [e, eFresh] = into.deadlines.try_emplace(key, d->second);
+                if (eFresh) into.heap += heapBytes(key.size());
+                else        e->second = d->second;
+            } else if (into.deadlines.erase(key)) {
+                into.heap -= heapBytes(key.size());
+            }
+        }
+        for (auto& [val, d] : top.countDelta) countDelta(into, val, d);
+        return TxnStatus::Ok;
+    }
+    if (txnStack_.size() < 2) return commitAll();
+
+    auto log = std::move(txnStack_.back().log);
+    const Epoch child = txnStack_.back().epoch;
+    const BumpArena::Mark keys = txnStack_.back().keys;
+    txnStack_.pop_back();
+    Txn& parent = txnStack_.back();
+    for (auto& c : log) {                       // the entries now belong to the parent
+        auto it = db_.find(c.key);
+        if (it != db_.end() && it->second.stamp == child) it->second.stamp = parent.epoch;
+    }
+    if (parent.log.empty()) {                   // nothing to dedupe against
+        swap(parent.log, log);
+    } else {
+        const size_t had = parent.log.size();
+        for (auto& c : log) {
+            if (c.oldVal && c.priorStamp == parent.epoch) {   // the parent logged it first
+                unpin(*c.oldVal);
+                continue;
+            }
+            parent.log.push_back(c);
+        }
+        if (parent.log.size() == had) undoKeys_.release(keys);   // no moved record needs them
+    }
+    log.clear();
+    spareLogs_.push_back(std::move(log));
     return TxnStatus::Ok;
 }
+
+/* ─────── memory limit ─────── */
+/*
+ * Memory limit (optional, setMemoryLimit)
+ *
+ *  memoryUsage() is the sum of the bytes the database has asked for:
+ *  every table's slot and control arrays, the heap of every key and value
+ *  string (db_, value pool, expires_, shadowed_), the ordered index nodes,
+ *  the timing wheel's buffers and the undo logs / overlay layers.  String
+ *  heaps are tracked as they change, so the sum costs O(depth), not O(N).
+ *  Allocator headers and the mapped image are not counted.
+ *
+ *  After each write that leaves the total above the limit, a CLOCK hand
+ *  sweeps db_'s slots: a key read or overwritten since the hand last
+ *  passed (Entry::ref set) gets a second chance, any other key is
+ *  evicted.  New keys start unreferenced, so write-once traffic is the
+ *  first to go and cannot flush a working set that is being read.  The
+ *  database's own reads (publishing to the observer, TTL and value-index
+ *  checks) go through peek(), which leaves ref alone.
+ *  Reads set ref with a relaxed atomic store – const reads may run side
+ *  by side under a caller's shared lock – and only when a limit is set.
+ *  The hit / miss counters are relaxed load + store pairs for the same
+ *  reason; racing readers may drop a count, never a key.
+ *
+ *  Reads that bypass this object (ShardedInMemoryDB's lock-free GET) keep
+ *  their own bits; setReferenceHook() lets the hand consult them.
+ *
+ *  Keys an open transaction has written are pinned: UndoLog entries
+ *  stamped by an open level and keys in an overlay layer.  Two sweeps
+ *  clear every ref bit, so after 2·capacity slots without an eviction
+ *  only pinned keys are left and the hand stops.
+ *
+ *  Tables never shrink, so db_ must not resize past the limit: before a
+ *  new key would make it allocate a new table, keys are evicted while
+ *  that table would not fit – until the insert finds room.  A limit
+ *  below db_'s current slot array empties it.
+ *
+ *  An eviction is a deletion outside the undo log: ROLLBACK does not bring
+ *  the key back and the observer is told at once, as for an expiry.
+ */
+size_t InMemoryDB::memoryUsage() const {
+    size_t n = sizeof(*this)
+             + db_.memoryBytes() + keyHeap_
+             + valueIds_.memoryBytes() + values_.capacity() * sizeof(string)
+             + (valCount_.capacity() + valRefs_.capacity()) * sizeof(size_t)
+             + freeIds_.capacity() * sizeof(ValueId)
+             + expires_.memoryBytes() + wheel_.memoryBytes()
+             + shadowed_.memoryBytes() + hidden_.memoryBytes()
+             + heap_;
+    if (ordered_) n += ordered_->memoryBytes() + keyHeap_;     // a copy of every key
+    if (byValue_)
+        n += byValue_->keys.capacity() * sizeof(vector<string>) + byValue_->pos.memoryBytes()
+           + byValue_->bytes;
+    n += (txnStack_.capacity() + spareStack_.capacity()) * sizeof(Txn)
+       + layers_.capacity() * sizeof(Layer) + undoBytes()
+       + undoKeys_.capacity() - undoKeys_.used() + spareLogs_.capacity() * sizeof(vector<Change>);
+    for (const auto& l : spareLogs_) n += l.capacity() * sizeof(Change);   // idle frames
+    return n;
+}
+
+void InMemoryDB::setMemoryLimit(size_t bytes) {
+    memLimit_ = bytes;
+    enforceLimit();
+}
+
+CacheStats InMemoryDB::cacheStats() const {
+    CacheStats st;
+    st.hits      = atomic_ref<uint64_t>(hits_).load(memory_order_relaxed);
+    st.misses    = atomic_ref<uint64_t>(misses_).load(memory_order_relaxed);
+    st.evictions = evicted_;
+    return st;
+}
+
+/* ─────── statistics ─────── */
+size_t InMemoryDB::undoBytes() const {
+    size_t n = 0;
+    for (const auto& t : txnStack_) n += t.log.capacity() * sizeof(Change);
+    n += undoKeys_.used();                      // only open levels' keys are below the cursor
+    for (const auto& l : layers_)
+        n += l.writes.memoryBytes() + l.countDelta.memoryBytes() + l.deadlines.memoryBytes() + l.heap;
+    return n;
+}
+
+DbStats InMemoryDB::stats() const {
+    DbStats st;
+#if INMEMORYDB_STATS
+    opStats_.copyTo(st);
+#endif
+    st.keys        = db_.size();
+    st.slots       = db_.capacity();
+    st.txnDepth    = txnStack_.size() + layers_.size();   // one of them is always empty
+    st.undoBytes   = undoBytes();
+    st.memoryBytes = memoryUsage();
+    return st;
+}
+
+void InMemoryDB::resetStats() {
+#if INMEMORYDB_STATS
+    opStats_.reset();
+#endif
+}
+
+bool InMemoryDB::pinned(string_view key, const Entry& e) const {
+    if (!txnStack_.empty() && e.stamp >= txnStack_.front().epoch) return true;
+    for (const auto& l : layers_)
+        if (l.writes.contains(key)) return true;
+    return false;
+}
+
+/* CLOCK: clear set ref bits until an unpinned key is found clear and evict
+   it; false once two sweeps found nothing (only pinned keys are left) */
+bool InMemoryDB::evictOne() {
+    size_t left = 2 * db_.capacity();
+    while (left && !db_.empty()) {
+        if (hand_ >= db_.capacity()) hand_ = 0;
+        auto it = db_.fromSlot(hand_);
+        const size_t slot = it == db_.end() ? db_.capacity() : it.slotIndex();
+        left -= min(left, slot - hand_ + 1);
+        hand_ = slot + 1;
+        if (it == db_.end()) continue;
+        Entry& e = it->second;
+        if (e.ref) { e.ref = 0; continue; }     // second chance
+        if (pinned(it->first, e)) continue;
+        if (refHook_ && refHook_(it->first)) continue;
+        const string key(it->first);
+        discard(it, key);
+        ++evicted_;
+        return true;
+    }
+    return false;
+}
+
+void InMemoryDB::evict() {
+    while (memoryUsage() > memLimit_ && evictOne()) {}
+}
+
+/* a new key must not double db_ past the limit: the doubled slot array
+   alone could exceed it, and every later write would sweep in vain */
+void InMemoryDB::makeRoom() {
+    while (db_.growsOnInsert() && memoryUsage() + db_.resizeBytes() > memLimit_ && evictOne()) {}
+}
+
+/* ─────── snapshots ─────── */
+/*
+ * Snapshots (beginSnapshot / snapshotStep; BackgroundSnapshot.h)
+ *
+ *  A snapshot freezes the committed state at beginSnapshot() and hands it
+ *  out in steps while writes go on in between.  Nothing is copied up
+ *  front; a write copies only the entry it is about to change.
+ *
+ *    Entry::snap : phase_ once the entry was handed out, saved, or created
+ *                  after the snapshot began.  beginSnapshot() flips
+ *                  phase_, which makes every existing entry unvisited in
+ *                  O(1).  Outside a snapshot every entry is at phase_.
+ *    saved       : (key, value) copies of unvisited entries that a write
+ *                  changed or erased – SET, DELETE, COMMIT, ROLLBACK,
+ *                  expiry and eviction all go through preserve()
+ *    pending     : unvisited entries left in db_
+ *
+ *  snapshotStep() hands out the saved pairs first, then walks db_ in slot
+ *  order from a cursor, marking what it hands out.  A resize can move
+ *  unvisited entries behind the cursor; the walk wraps around until
+ *  pending reaches 0.  Image keys come last, in keyDir order, skipping
+ *  shadowed ones.  A key promoted before the walk reaches it is saved at
+ *  promotion.  Each key is handed out exactly once.
+ *
+ *  Extra memory is the saved pairs: O(#distinct keys written while the
+ *  walk runs), drained at every step.  They are reported by
+ *  snapshotBytes(), not memoryUsage(): with a limit set, evicting a key
+ *  only moves its bytes into the snapshot, and counting them would evict
+ *  the whole table.  TTLs are not part of a snapshot.
+ */
+void InMemoryDB::beginSnapshot() {
+    if (walk_) throw logic_error("InMemoryDB::beginSnapshot while a snapshot runs");
+    if (!txnStack_.empty() || !layers_.empty())
+        throw logic_error("InMemoryDB::beginSnapshot with an open transaction");
+    phase_ ^= 1;                                // every entry is unvisited now
+    walk_.emplace();
+    walk_->pending = db_.size();
+}
+
+void InMemoryDB::save(string_view key, Entry& e) {
+    e.snap = phase_;
+    --walk_->pending;
+    keep(key, values_[e.val]);
+}
+
+void InMemoryDB::keep(string_view key, string_view val) {
+    auto& w = *walk_;
+    w.saved.emplace_back(key, val);
+    w.heap += heapBytes(key.size()) + heapBytes(val.size());
+}
+
+bool InMemoryDB::imageWalked(string_view key) const {
+    const size_t next = walk_->imageNext;
+    return next == image_->keyCount() || key < image_->keyAt(next);   // keyDir is sorted
+}
+
+bool InMemoryDB::snapshotStep(size_t budget, PairSink sink, void* ctx) {
+    if (!walk_) return false;
+    auto& w = *walk_;
+    size_t n = 0;
+    for (; n < budget && !w.saved.empty(); ++n) {
+        auto& [k, v] = w.saved.back();
+        sink(ctx, k, v);
+        w.heap -= heapBytes(k.size()) + heapBytes(v.size());
+        w.saved.pop_back();
+    }
+    /* db_ in slot order; entries a resize moved behind the cursor are
+       found by the next lap.  `slots` bounds the scan of a sparse table. */
+    for (size_t slots = 16 * budget; n < budget && w.pending && slots;) {
+        if (w.cursor >= db_.capacity()) w.cursor = 0;
+        auto it = db_.fromSlot(w.cursor);
+        const size_t slot = it == db_.end() ? db_.capacity() : it.slotIndex();
+        slots -= min(slots, slot - w.cursor + 1);
+        w.cursor = slot + 1;
+        if (it == db_.end() || it->second.snap == phase_) continue;
+        it->second.snap = phase_;
+        --w.pending;
+        sink(ctx, it->first, values_[it->second.val]);
+        ++n;
+    }
+    if (image_)
+        for (const size_t end = image_->keyCount(); n < budget && !w.pending && w.imageNext < end;
+             ++w.imageNext) {
+            const string_view k = image_->keyAt(w.imageNext);
+            if (shadowed_.contains(k)) continue;
+            sink(ctx, k, image_->valueAt(w.imageNext).val);
+            ++n;
+        }
+    if (!w.saved.empty() || w.pending || (image_ && w.imageNext < image_->keyCount())) return true;
+    walk_.reset();
+    return false;
+}
+
+void InMemoryDB::endSnapshot() {
+    if (!walk_) return;
+    if (walk_->pending)                         // restore "every entry at phase_"
+        for (auto& kv : db_) kv.second.snap = phase_;
+    walk_.reset();
+}
+
+size_t InMemoryDB::snapshotBytes() const {
+    return walk_ ? walk_->saved.capacity() * sizeof(pair<string, string>) + walk_->heap : 0;
+}
@@ -0,0 +1,93 @@
+/*
+ * InMemoryDbServer – runs DbServer as a daemon (Linux).
+ *
+ *   InMemoryDbServer [--port N] [--host A] [--unix PATH]
+ *                    [--checkpoint FILE] [--wal FILE] [--maxmemory MB]
+ *
+ * --checkpoint maps an image written by Checkpoint::write as the starting
+ * state; --wal replays that log on top and then appends every commit to
+ * it (Async durability, 1 ms).  SIGINT / SIGTERM stop the event loop
+ * cleanly so the log is flushed before exit.  --maxmemory caps the
+ * database's accounted memory; keys beyond it are evicted (CLOCK) and the
+ * eviction count and hit ratio are printed on exit, followed by the
+ * database's operation statistics (DbStats::text) when built with them.
+ */
+#include "Checkpoint.h"
+#include "DbServer.h"
+#include "WriteAheadLog.h"
+
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+static DbServer* g_server = nullptr;
+
+extern "C" void onSignal(int) {
+    if (g_server) g_server->stop();
+}
+
+int main(int argc, char** argv) try {
+    ServerOptions opts;
+    opts.port = 6380;
+    std::string checkpoint, wal;
+    std::size_t maxMemoryMb = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::runtime_error("missing value for " + a);
+            return argv[++i];
+        };
+        if      (a == "--port")       opts.port = static_cast<std::uint16_t>(std::stoul(next()));
+        else if (a == "--host")       opts.host = next();
+        else if (a == "--unix")       opts.unixPath = next();
+        else if (a == "--checkpoint") checkpoint = next();
+        else if (a == "--wal")        wal = next();
+        else if (a == "--maxmemory")  maxMemoryMb = std::stoul(next());
+        else throw std::runtime_error("unknown option " + a);
+    }
+
+    std::unique_ptr<InMemoryDB> db = checkpoint.empty()
+        ? std::make_unique<InMemoryDB>()
+        : std::make_unique<InMemoryDB>(Checkpoint::open(checkpoint));
+
+    std::unique_ptr<WriteAheadLog> log;
+    if (!wal.empty()) {
+        std::size_t n = WriteAheadLog::replay(wal, *db);
+        std::cerr << "replayed " << n << " commits from " << wal << '\n';
+        log = std::make_unique<WriteAheadLog>(
+            wal, WalOptions{ Durability::Async, std::chrono::milliseconds(1) });
+        db->setCommitObserver(log.get());
+    }
+
+    db->setMemoryLimit(maxMemoryMb << 20);       // after attaching: evictions reach the log
+
+    DbServer server(*db, opts);
+    g_server = &server;
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    if (opts.unixPath.empty())
+        std::cerr << "listening on " << opts.host << ':' << server.port() << '\n';
+    else
+        std::cerr << "listening on " << opts.unixPath << '\n';
+
+    server.run();
+    g_server = nullptr;
+    db->setCommitObserver(nullptr);
+    if (log) log->sync();
+    std::cerr << "served " << server.commands() << " commands\n";
+    if (maxMemoryMb) {
+        CacheStats st = db->cacheStats();
+        std::cerr << "evicted " << st.evictions << " keys, hit ratio " << st.hitRatio() << '\n';
+    }
+    if constexpr (DbStats::enabled) std::cerr << db->stats().text();
+    return 0;
+} catch (const std::exception& e) {
+    std::cerr << "InMemoryDbServer: " << e.what() << '\n';
+    return 1;
+}